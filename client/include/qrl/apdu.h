@@ -0,0 +1,81 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// APDU encoding for the QRL app. Values mirror src/app_main.h and src/lib/qrl_types.h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace qrl {
+
+const uint8_t CLA = 0x77;
+
+const uint8_t INS_VERSION = 0x00;
+const uint8_t INS_GETSTATE = 0x01;
+const uint8_t INS_PUBLIC_KEY = 0x03;
+const uint8_t INS_SIGN = 0x04;
+const uint8_t INS_SIGN_NEXT = 0x05;
+const uint8_t INS_SETIDX = 0x06;
+const uint8_t INS_NEXT_PAGE = 0x09;
+const uint8_t INS_SWITCH_TREE = 0x0A;
+const uint8_t INS_GET_TREES = 0x0B;
+
+const uint8_t APPMODE_NOT_INITIALIZED = 0x00;
+const uint8_t APPMODE_KEYGEN_RUNNING = 0x01;
+const uint8_t APPMODE_READY = 0x02;
+
+const uint16_t SW_OK = 0x9000;
+
+const size_t APDU_HEADER_SIZE = 5;
+const size_t APDU_MAX_DATA = 255;
+const size_t APDU_MAX_SIZE = APDU_HEADER_SIZE + APDU_MAX_DATA;
+const size_t REPLY_MAX_SIZE = 260;          // IO_APDU_BUFFER_SIZE, status word included
+
+const size_t PK_SIZE = 67;                  // descriptor, root, pub seed
+const size_t SIG_SIZE = 2436;               // XMSS_SIGSIZE for height 8
+const size_t SIG_CHUNKS = 11;               // INS_SIGN_NEXT replies per signature
+const uint16_t SIG_MAX_INDEX = 256;
+
+const size_t CHAIN_PAGE_HEADER = 2;         // page index, page count
+const size_t TREE_INFO_HEADER = 2;          // tree count, current tree
+const size_t TREE_INFO_SIZE = 70;           // mode, xmss index, pk
+
+/// Size of every INS_SIGN_NEXT reply, see xmss_sign_incremental
+extern const uint16_t SIG_CHUNK_SIZE[SIG_CHUNKS];
+
+struct Apdu {
+    uint16_t size;
+    uint8_t bytes[APDU_MAX_SIZE];
+};
+
+/// Commands without payload, encoded once
+extern const Apdu APDU_GETSTATE;
+extern const Apdu APDU_PUBLIC_KEY;
+extern const Apdu APDU_SIGN_NEXT;
+extern const Apdu APDU_SWITCH_TREE;
+extern const Apdu APDU_GET_TREES;
+
+Apdu encode(uint8_t ins, uint8_t p1, uint8_t p2, const uint8_t *data, size_t len);
+
+/// Splits a serialized qrltx_t into INS_SIGN packets. Packets end on subitem
+/// boundaries and carry at most as many subitems as the app keeps in RAM, a tx
+/// that fits in one APDU is sent as a single packet (P2 = 0).
+/// Throws std::invalid_argument if the tx is malformed or too long.
+std::vector<Apdu> encode_sign(const uint8_t *tx, size_t tx_len);
+
+}
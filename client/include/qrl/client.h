@@ -0,0 +1,132 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "qrl/apdu.h"
+#include "qrl/transport.h"
+
+namespace qrl {
+
+/// Status word other than SW_OK
+class DeviceError : public std::runtime_error {
+public:
+    DeviceError(uint8_t ins, uint16_t sw);
+    uint16_t sw() const { return sw_; }
+
+private:
+    uint16_t sw_;
+};
+
+struct State {
+    uint8_t mode;
+    uint16_t index;                         // next xmss index to be used
+};
+
+typedef std::array<uint8_t, PK_SIZE> PublicKey;
+
+struct TreeInfo {
+    State state;
+    PublicKey pk;                           // zero unless the tree is ready
+};
+
+struct Trees {
+    uint8_t current;
+    std::vector<TreeInfo> trees;            // two per seed, Switch Tree moves to current ^ 1
+};
+
+/// Signatures are received in place, chunk by chunk. The spare bytes take the
+/// status word of the last chunk.
+struct Signature {
+    uint8_t bytes[SIG_SIZE + 2];
+};
+
+/// Synchronous client for one device
+class Client {
+public:
+    explicit Client(Transport &transport) : transport_(transport) {}
+
+    State get_state();
+    PublicKey public_key();
+
+    /// State and public key of every tree, without switching
+    Trees get_trees();
+
+    /// Switches to the other tree of the seed once confirmed on the device.
+    /// Returns the state of the new tree
+    State switch_tree();
+
+    /// Signs a tx encoded with encode_sign. Every packet is reviewed on the
+    /// device, then the signature chunks are pipelined if the transport allows it
+    void sign(const std::vector<Apdu> &packets, Signature &sig);
+
+    void sign(const uint8_t *tx, size_t tx_len, Signature &sig) {
+        sign(encode_sign(tx, tx_len), sig);
+    }
+
+private:
+    State read_state(const Apdu &cmd);
+
+    // Returns the reply size without the status word, throws DeviceError if it is not SW_OK
+    size_t exchange(const Apdu &cmd, uint8_t *resp, size_t resp_cap);
+    void receive_chunks(Signature &sig);
+
+    Transport &transport_;
+    uint8_t reply_[REPLY_MAX_SIZE];
+};
+
+/// Queues requests for one device and runs them on a worker thread, so callers
+/// can submit without waiting and the device never idles between requests
+class AsyncClient {
+public:
+    explicit AsyncClient(Transport &transport);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    std::future<State> get_state();
+    std::future<PublicKey> public_key();
+
+    /// sig must stay valid until the future is ready
+    std::future<void> sign(std::vector<Apdu> packets, Signature *sig);
+
+    /// Requests submitted and not finished yet
+    size_t pending() const;
+
+private:
+    void submit(std::function<void()> job);
+    void run();
+
+    Client client_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    size_t running_;
+    bool stop_;
+    std::thread worker_;
+};
+
+}
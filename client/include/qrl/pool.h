@@ -0,0 +1,121 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// Signing pool over several devices. Tree capacity is read with
+// INS_GET_TREES, or INS_GETSTATE on older apps. Requests go to the idle
+// device whose current tree has the most signatures left, so the load is
+// spread and the trees run out evenly. Idle devices whose tree is about to run out switch to
+// the other tree of their seed ahead of time, so the confirmation on the
+// device does not hold up a request.
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "qrl/client.h"
+
+namespace qrl {
+
+struct PoolResult {
+    size_t device;
+    uint16_t index;                         // xmss index used
+    PublicKey pk;                           // tree that signed
+};
+
+struct TreeStatus {
+    uint8_t mode;
+    uint16_t index;
+
+    uint16_t remaining() const {
+        return mode == APPMODE_READY && index < SIG_MAX_INDEX ? SIG_MAX_INDEX - index : 0;
+    }
+};
+
+struct DeviceStatus {
+    bool starting;                          // first INS_GETSTATE not answered yet
+    bool online;
+    bool busy;
+    TreeStatus current;
+    TreeStatus other;                       // valid once other_known
+    bool other_known;
+    bool rollover_refused;
+    uint32_t signatures;
+    uint32_t rollovers;
+};
+
+class Pool {
+public:
+    /// Transports must outlive the pool. Idle devices roll over once their
+    /// tree has rollover_at signatures left or fewer.
+    explicit Pool(const std::vector<Transport *> &transports, uint16_t rollover_at = 16);
+    ~Pool();
+
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    /// sig must stay valid until the future is ready. The future fails if no
+    /// device has signatures left.
+    std::future<PoolResult> sign(std::vector<Apdu> packets, Signature *sig);
+
+    std::vector<DeviceStatus> status() const;
+
+    /// Signatures left on the known trees of the online devices
+    uint32_t capacity() const;
+
+    /// Blocks until queued requests and rollovers are done
+    void wait_idle();
+
+private:
+    struct Job {
+        std::shared_ptr<std::vector<Apdu>> packets;
+        Signature *sig;
+        std::promise<PoolResult> result;
+    };
+
+    struct Device {
+        explicit Device(Transport &transport) : client(transport) {}
+
+        Client client;
+        DeviceStatus status;
+        PublicKey pk;
+        std::thread worker;
+    };
+
+    void run(size_t d);
+    void refresh(size_t d);
+    void sign_job(size_t d, Job &job, std::unique_lock<std::mutex> &lock);
+    void rollover(size_t d, std::unique_lock<std::mutex> &lock);
+
+    // The following are called with the lock held
+    size_t best_idle() const;
+    bool can_roll_over(size_t d) const;
+    bool wants_rollover(size_t d) const;
+    void fail_if_stranded();
+
+    const uint16_t rollover_at_;
+    std::vector<std::unique_ptr<Device>> devices_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stop_;
+};
+
+}
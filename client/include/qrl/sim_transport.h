@@ -0,0 +1,35 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+#include "qrl/apdu.h"
+#include "qrl/transport.h"
+
+namespace qrl {
+
+/// The app linked into this process through the host simulator. The simulator
+/// has a single device per process, set up with sim_init or sim_snapshot_load.
+class SimTransport : public Transport {
+public:
+    void send(const uint8_t *cmd, size_t cmd_len) override;
+    size_t receive(uint8_t *resp, size_t resp_cap) override;
+
+private:
+    uint16_t cmd_len_ = 0;
+    uint8_t cmd_[APDU_MAX_SIZE];
+};
+
+}
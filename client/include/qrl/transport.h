@@ -0,0 +1,90 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// Transports carry APDUs to a device. They may let several commands be in
+// flight, replies then come back in order.
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace qrl {
+
+class TransportError : public std::runtime_error {
+public:
+    explicit TransportError(const std::string &what) : std::runtime_error(what) {}
+};
+
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /// Sends one command
+    virtual void send(const uint8_t *cmd, size_t cmd_len) = 0;
+
+    /// Receives the reply to the oldest command in flight into resp, status
+    /// word included. Returns its size
+    virtual size_t receive(uint8_t *resp, size_t resp_cap) = 0;
+
+    /// Commands that can be sent before the first reply is received
+    virtual size_t max_in_flight() const { return 1; }
+
+    size_t exchange(const uint8_t *cmd, size_t cmd_len, uint8_t *resp, size_t resp_cap) {
+        send(cmd, cmd_len);
+        return receive(resp, resp_cap);
+    }
+};
+
+/// Simulator or speculos on a TCP port. Commands are pipelined on the socket
+class TcpTransport : public Transport {
+public:
+    TcpTransport(const std::string &host, uint16_t port);
+    ~TcpTransport() override;
+
+    TcpTransport(const TcpTransport &) = delete;
+    TcpTransport &operator=(const TcpTransport &) = delete;
+
+    void send(const uint8_t *cmd, size_t cmd_len) override;
+    size_t receive(uint8_t *resp, size_t resp_cap) override;
+    size_t max_in_flight() const override { return 16; }
+
+private:
+    int fd_;
+};
+
+/// Ledger device on a Linux hidraw node
+class HidTransport : public Transport {
+public:
+    explicit HidTransport(const std::string &path);
+    ~HidTransport() override;
+
+    HidTransport(const HidTransport &) = delete;
+    HidTransport &operator=(const HidTransport &) = delete;
+
+    /// hidraw nodes of the connected Ledger devices
+    static std::vector<std::string> enumerate();
+
+    void send(const uint8_t *cmd, size_t cmd_len) override;
+    size_t receive(uint8_t *resp, size_t resp_cap) override;
+
+private:
+    int fd_;
+};
+
+}
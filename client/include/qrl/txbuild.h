@@ -0,0 +1,89 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// Host builder for the INS_SIGN payloads, laid out as qrltx_t in src/lib/qrl_types.h.
+// Every tx is checked with the app's own get_qrltx_size, so a tx that is built here
+// is one the device accepts as a single INS_SIGN packet.
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace qrl {
+
+const uint8_t TX_TRANSFER = 0;              // QRLTX_TX
+const uint8_t TX_TOKEN = 1;                 // QRLTX_TXTOKEN
+const uint8_t TX_SLAVE = 2;                 // QRLTX_SLAVE
+const uint8_t TX_MESSAGE = 3;               // QRLTX_MESSAGE
+
+const size_t TX_ADDRESS_SIZE = 39;
+const size_t TX_SLAVE_PK_SIZE = 35;
+const size_t TX_TOKEN_HASH_SIZE = 32;
+const size_t TX_HASH_SIZE = 32;
+
+/// Amounts, fees and access types are sent big endian
+struct TxDest {
+    uint8_t address[TX_ADDRESS_SIZE];
+    uint64_t amount;
+};
+
+struct TxSlave {
+    uint8_t pk[TX_SLAVE_PK_SIZE];
+    uint64_t access;
+};
+
+/// A tx the app rejects: unknown or disabled type, no items or too many of them
+class TxError : public std::invalid_argument {
+public:
+    using std::invalid_argument::invalid_argument;
+};
+
+/// Serialized txs kept back to back in a buffer allocated once. Adding past the
+/// capacity throws std::length_error, nothing is reallocated.
+class TxArena {
+public:
+    TxArena(size_t max_txs, size_t max_bytes);
+
+    /// Each returns the index of the new tx
+    size_t add_transfer(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const TxDest *dst, size_t count);
+    size_t add_token(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee,
+                     const uint8_t token_hash[TX_TOKEN_HASH_SIZE], const TxDest *dst, size_t count);
+    size_t add_slave(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const TxSlave *slaves, size_t count);
+    size_t add_message(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const uint8_t *message, size_t len);
+
+    size_t size() const { return offsets_.size(); }
+    const uint8_t *tx(size_t i) const { return &buf_[offsets_[i]]; }
+    size_t tx_size(size_t i) const { return (i + 1 < offsets_.size() ? offsets_[i + 1] : used_) - offsets_[i]; }
+
+    /// Hashes every tx as get_qrltx_hash does, txs of the same length go through
+    /// the multi-buffer SHA-256 together. hashes takes TX_HASH_SIZE bytes per tx.
+    void hash(uint8_t *hashes) const;
+
+    void clear();
+
+private:
+    uint8_t *begin(uint8_t type, size_t items);
+    size_t commit(const uint8_t *end);
+
+    std::vector<uint8_t> buf_;
+    std::vector<uint32_t> offsets_;
+    size_t max_txs_;
+    size_t used_ = 0;
+};
+
+}
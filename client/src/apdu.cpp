@@ -0,0 +1,120 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/apdu.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace qrl {
+
+const uint16_t SIG_CHUNK_SIZE[SIG_CHUNKS] = {
+        164, 224, 224, 224, 224, 224, 224, 224, 224, 224, 256
+};
+
+const Apdu APDU_GETSTATE = {5, {CLA, INS_GETSTATE, 0, 0, 0}};
+const Apdu APDU_PUBLIC_KEY = {5, {CLA, INS_PUBLIC_KEY, 0, 0, 0}};
+const Apdu APDU_SIGN_NEXT = {5, {CLA, INS_SIGN_NEXT, 0, 0, 0}};
+const Apdu APDU_SWITCH_TREE = {5, {CLA, INS_SWITCH_TREE, 0, 0, 0}};
+const Apdu APDU_GET_TREES = {5, {CLA, INS_GET_TREES, 0, 0, 0}};
+
+namespace {
+
+// qrltx_schemas in src/lib/qrl_types.c
+struct TxSchema {
+    uint8_t type;
+    uint8_t items_offset;
+    uint8_t item_size;
+    uint8_t item_max;                       // subitems held in RAM per packet
+};
+
+const TxSchema TX_SCHEMAS[] = {
+        {0, 49, 47, 3},                     // QRLTX_TX
+        {1, 81, 47, 3},                     // QRLTX_TXTOKEN
+        {2, 49, 43, 3},                     // QRLTX_SLAVE
+        {3, 49, 1, 80},                     // QRLTX_MESSAGE
+};
+
+const TxSchema *find_schema(uint8_t type) {
+    for (const auto &s : TX_SCHEMAS) {
+        if (s.type == type) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+Apdu encode(uint8_t ins, uint8_t p1, uint8_t p2, const uint8_t *data, size_t len) {
+    if (len > APDU_MAX_DATA) {
+        throw std::invalid_argument("apdu data too long");
+    }
+    Apdu apdu;
+    apdu.bytes[0] = CLA;
+    apdu.bytes[1] = ins;
+    apdu.bytes[2] = p1;
+    apdu.bytes[3] = p2;
+    apdu.bytes[4] = static_cast<uint8_t>(len);
+    if (len > 0) {
+        memcpy(apdu.bytes + APDU_HEADER_SIZE, data, len);
+    }
+    apdu.size = static_cast<uint16_t>(APDU_HEADER_SIZE + len);
+    return apdu;
+}
+
+std::vector<Apdu> encode_sign(const uint8_t *tx, size_t tx_len) {
+    const TxSchema *schema = tx_len >= 2 ? find_schema(tx[0]) : nullptr;
+    if (schema == nullptr || tx[1] == 0 ||
+        tx_len != schema->items_offset + static_cast<size_t>(schema->item_size) * tx[1]) {
+        throw std::invalid_argument("malformed tx");
+    }
+
+    if (tx_len <= APDU_MAX_DATA && tx[1] <= schema->item_max) {
+        return std::vector<Apdu>(1, encode(INS_SIGN, 0, 0, tx, tx_len));
+    }
+
+    // The first packet carries the header, every packet as many subitems as fit
+    size_t per_packet = (APDU_MAX_DATA - schema->items_offset) / schema->item_size;
+    size_t first = per_packet < schema->item_max ? per_packet : schema->item_max;
+    per_packet = APDU_MAX_DATA / schema->item_size;
+    if (per_packet > schema->item_max) {
+        per_packet = schema->item_max;
+    }
+
+    const size_t items = tx[1];
+    const size_t count = 1 + (items - first + per_packet - 1) / per_packet;
+    if (first == 0 || count > 255) {
+        throw std::invalid_argument("tx too long");
+    }
+
+    std::vector<Apdu> packets;
+    packets.reserve(count);
+
+    size_t offset = 0;
+    size_t end = schema->items_offset + first * schema->item_size;
+    for (size_t i = 1; i <= count; i++) {
+        packets.push_back(encode(INS_SIGN, static_cast<uint8_t>(i), static_cast<uint8_t>(count),
+                                 tx + offset, end - offset));
+        offset = end;
+        end += per_packet * schema->item_size;
+        if (end > tx_len) {
+            end = tx_len;
+        }
+    }
+    return packets;
+}
+
+}
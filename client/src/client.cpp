@@ -0,0 +1,235 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/client.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace qrl {
+
+namespace {
+
+uint16_t status_word(const uint8_t *resp, size_t len) {
+    if (len < 2) {
+        throw TransportError("reply without status word");
+    }
+    return static_cast<uint16_t>(resp[len - 2] << 8 | resp[len - 1]);
+}
+
+std::string describe(uint8_t ins, uint16_t sw) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "INS 0x%02X failed with SW 0x%04X", ins, sw);
+    return buf;
+}
+
+}
+
+DeviceError::DeviceError(uint8_t ins, uint16_t sw) : std::runtime_error(describe(ins, sw)), sw_(sw) {}
+
+size_t Client::exchange(const Apdu &cmd, uint8_t *resp, size_t resp_cap) {
+    const size_t len = transport_.exchange(cmd.bytes, cmd.size, resp, resp_cap);
+    const uint16_t sw = status_word(resp, len);
+    if (sw != SW_OK) {
+        throw DeviceError(cmd.bytes[1], sw);
+    }
+    return len - 2;
+}
+
+State Client::get_state() {
+    return read_state(APDU_GETSTATE);
+}
+
+State Client::switch_tree() {
+    return read_state(APDU_SWITCH_TREE);
+}
+
+State Client::read_state(const Apdu &cmd) {
+    if (exchange(cmd, reply_, sizeof(reply_)) < 3) {
+        throw TransportError("short state reply");
+    }
+    State state;
+    state.mode = reply_[0];
+    state.index = static_cast<uint16_t>(reply_[1] << 8 | reply_[2]);
+    return state;
+}
+
+PublicKey Client::public_key() {
+    if (exchange(APDU_PUBLIC_KEY, reply_, sizeof(reply_)) < PK_SIZE) {
+        throw TransportError("short INS_PUBLIC_KEY reply");
+    }
+    PublicKey pk;
+    std::copy(reply_, reply_ + PK_SIZE, pk.begin());
+    return pk;
+}
+
+Trees Client::get_trees() {
+    std::vector<uint8_t> data;
+    size_t len = exchange(APDU_GET_TREES, reply_, sizeof(reply_));
+
+    for (uint8_t page = 1;; page++) {
+        if (len < CHAIN_PAGE_HEADER || reply_[0] != page) {
+            throw TransportError("unexpected INS_GET_TREES page");
+        }
+        data.insert(data.end(), reply_ + CHAIN_PAGE_HEADER, reply_ + len);
+        if (page == reply_[1]) {
+            break;
+        }
+        const Apdu next = encode(INS_NEXT_PAGE, static_cast<uint8_t>(page + 1), 0, nullptr, 0);
+        len = exchange(next, reply_, sizeof(reply_));
+    }
+
+    if (data.size() < TREE_INFO_HEADER || data.size() != TREE_INFO_HEADER + data[0] * TREE_INFO_SIZE) {
+        throw TransportError("short INS_GET_TREES reply");
+    }
+
+    Trees trees;
+    trees.current = data[1];
+    for (size_t i = 0; i < data[0]; i++) {
+        const uint8_t *p = data.data() + TREE_INFO_HEADER + i * TREE_INFO_SIZE;
+        TreeInfo info;
+        info.state.mode = p[0];
+        info.state.index = static_cast<uint16_t>(p[1] << 8 | p[2]);
+        std::copy(p + 3, p + 3 + PK_SIZE, info.pk.begin());
+        trees.trees.push_back(info);
+    }
+    return trees;
+}
+
+void Client::sign(const std::vector<Apdu> &packets, Signature &sig) {
+    for (const auto &packet : packets) {
+        exchange(packet, reply_, sizeof(reply_));
+    }
+    receive_chunks(sig);
+}
+
+void Client::receive_chunks(Signature &sig) {
+    const size_t window = transport_.max_in_flight() < SIG_CHUNKS ? transport_.max_in_flight() : SIG_CHUNKS;
+
+    size_t sent = 0;
+    while (sent < window) {
+        transport_.send(APDU_SIGN_NEXT.bytes, APDU_SIGN_NEXT.size);
+        sent++;
+    }
+
+    size_t offset = 0;
+    uint16_t error = SW_OK;
+    bool bad_size = false;
+
+    // After an error the chunks already in flight are drained, so the
+    // transport stays in step with the device
+    for (size_t received = 0; received < sent; received++) {
+        const bool ok = error == SW_OK && !bad_size;
+
+        // Chunks land in place, the status word where the next one starts
+        uint8_t *out = ok ? sig.bytes + offset : reply_;
+        const size_t cap = ok ? sizeof(sig.bytes) - offset : sizeof(reply_);
+        const size_t len = transport_.receive(out, cap);
+
+        if (ok && sent < SIG_CHUNKS) {
+            transport_.send(APDU_SIGN_NEXT.bytes, APDU_SIGN_NEXT.size);
+            sent++;
+        }
+        if (!ok) {
+            continue;
+        }
+
+        error = status_word(out, len);
+        bad_size = error == SW_OK && len - 2 != SIG_CHUNK_SIZE[received];
+        offset += len - 2;
+    }
+
+    if (error != SW_OK) {
+        throw DeviceError(INS_SIGN_NEXT, error);
+    }
+    if (bad_size) {
+        throw TransportError("unexpected signature chunk size");
+    }
+}
+
+////////////////////////////////////////////////
+
+AsyncClient::AsyncClient(Transport &transport)
+        : client_(transport), running_(0), stop_(false), worker_(&AsyncClient::run, this) {}
+
+AsyncClient::~AsyncClient() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+std::future<State> AsyncClient::get_state() {
+    auto task = std::make_shared<std::packaged_task<State()>>([this] { return client_.get_state(); });
+    auto future = task->get_future();
+    submit([task] { (*task)(); });
+    return future;
+}
+
+std::future<PublicKey> AsyncClient::public_key() {
+    auto task = std::make_shared<std::packaged_task<PublicKey()>>([this] { return client_.public_key(); });
+    auto future = task->get_future();
+    submit([task] { (*task)(); });
+    return future;
+}
+
+std::future<void> AsyncClient::sign(std::vector<Apdu> packets, Signature *sig) {
+    auto request = std::make_shared<std::vector<Apdu>>(std::move(packets));
+    auto task = std::make_shared<std::packaged_task<void()>>([this, request, sig] {
+        client_.sign(*request, *sig);
+    });
+    auto future = task->get_future();
+    submit([task] { (*task)(); });
+    return future;
+}
+
+size_t AsyncClient::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size() + running_;
+}
+
+void AsyncClient::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void AsyncClient::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        // Requests already queued are completed before stopping
+        if (queue_.empty()) {
+            return;
+        }
+
+        std::function<void()> job = std::move(queue_.front());
+        queue_.pop_front();
+        running_++;
+
+        lock.unlock();
+        job();
+        lock.lock();
+        running_--;
+    }
+}
+
+}
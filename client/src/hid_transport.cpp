@@ -0,0 +1,160 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/transport.h"
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace qrl {
+
+// Ledger HID framing. APDUs are split in 64 byte reports:
+//   [channel, 2 bytes] [tag 0x05] [sequence, 2 bytes] [length, 2 bytes, first report only] [data]
+
+namespace {
+
+const size_t HID_REPORT_SIZE = 64;
+const uint16_t HID_CHANNEL = 0x0101;
+const uint8_t HID_TAG_APDU = 0x05;
+const char LEDGER_VID[] = "00002C97";
+
+size_t frame_header(uint8_t *report, uint16_t seq) {
+    report[0] = HID_CHANNEL >> 8;
+    report[1] = HID_CHANNEL & 0xFF;
+    report[2] = HID_TAG_APDU;
+    report[3] = static_cast<uint8_t>(seq >> 8);
+    report[4] = static_cast<uint8_t>(seq);
+    return 5;
+}
+
+}
+
+HidTransport::HidTransport(const std::string &path) : fd_(::open(path.c_str(), O_RDWR)) {
+    if (fd_ < 0) {
+        throw TransportError("hid: cannot open " + path);
+    }
+}
+
+HidTransport::~HidTransport() {
+    ::close(fd_);
+}
+
+std::vector<std::string> HidTransport::enumerate() {
+    std::vector<std::string> paths;
+
+    DIR *dir = opendir("/sys/class/hidraw");
+    if (dir == nullptr) {
+        return paths;
+    }
+
+    while (dirent *e = readdir(dir)) {
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+
+        // Only the first interface carries APDUs
+        std::ifstream uevent(std::string("/sys/class/hidraw/") + e->d_name + "/device/uevent");
+        std::string line;
+        bool ledger = false;
+        bool apdu = false;
+        while (std::getline(uevent, line)) {
+            if (line.compare(0, 7, "HID_ID=") == 0 && line.find(LEDGER_VID) != std::string::npos) {
+                ledger = true;
+            }
+            if (line.compare(0, 9, "HID_PHYS=") == 0 && line.size() >= 6 &&
+                line.compare(line.size() - 6, 6, "input0") == 0) {
+                apdu = true;
+            }
+        }
+        if (ledger && apdu) {
+            paths.push_back(std::string("/dev/") + e->d_name);
+        }
+    }
+    closedir(dir);
+    return paths;
+}
+
+void HidTransport::send(const uint8_t *cmd, size_t cmd_len) {
+    if (cmd_len > 0xFFFF) {
+        throw TransportError("hid: command too long");
+    }
+
+    // hidraw expects the report id first
+    uint8_t report[1 + HID_REPORT_SIZE];
+    size_t sent = 0;
+    for (uint16_t seq = 0; seq == 0 || sent < cmd_len; seq++) {
+        memset(report, 0, sizeof(report));
+        uint8_t *p = report + 1;
+        size_t pos = frame_header(p, seq);
+        if (seq == 0) {
+            p[pos++] = static_cast<uint8_t>(cmd_len >> 8);
+            p[pos++] = static_cast<uint8_t>(cmd_len);
+        }
+
+        size_t n = HID_REPORT_SIZE - pos;
+        if (n > cmd_len - sent) {
+            n = cmd_len - sent;
+        }
+        memcpy(p + pos, cmd + sent, n);
+        sent += n;
+
+        if (::write(fd_, report, sizeof(report)) != static_cast<ssize_t>(sizeof(report))) {
+            throw TransportError("hid: write failed");
+        }
+    }
+}
+
+size_t HidTransport::receive(uint8_t *resp, size_t resp_cap) {
+    uint8_t report[HID_REPORT_SIZE];
+    size_t len = 0;
+    size_t received = 0;
+
+    for (uint16_t seq = 0; seq == 0 || received < len; seq++) {
+        ssize_t n;
+        do {
+            n = ::read(fd_, report, sizeof(report));
+        } while (n < 0 && errno == EINTR);
+        if (n != static_cast<ssize_t>(sizeof(report))) {
+            throw TransportError("hid: read failed");
+        }
+
+        uint8_t expected[5];
+        size_t pos = frame_header(expected, seq);
+        if (memcmp(report, expected, pos) != 0) {
+            throw TransportError("hid: unexpected report");
+        }
+        if (seq == 0) {
+            len = static_cast<size_t>(report[pos]) << 8 | report[pos + 1];
+            pos += 2;
+            if (len > resp_cap) {
+                throw TransportError("hid: reply too long");
+            }
+        }
+
+        size_t chunk = HID_REPORT_SIZE - pos;
+        if (chunk > len - received) {
+            chunk = len - received;
+        }
+        memcpy(resp + received, report + pos, chunk);
+        received += chunk;
+    }
+    return len;
+}
+
+}
@@ -0,0 +1,316 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/pool.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace qrl {
+
+namespace {
+
+const size_t NONE = std::numeric_limits<size_t>::max();
+
+TreeStatus tree_status(const State &state) {
+    TreeStatus t;
+    t.mode = state.mode;
+    t.index = state.index;
+    return t;
+}
+
+}
+
+Pool::Pool(const std::vector<Transport *> &transports, uint16_t rollover_at)
+        : rollover_at_(rollover_at), stop_(false) {
+    for (Transport *t : transports) {
+        std::unique_ptr<Device> dev(new Device(*t));
+        dev->status = DeviceStatus();
+        dev->status.starting = true;
+        devices_.push_back(std::move(dev));
+    }
+    for (size_t d = 0; d < devices_.size(); d++) {
+        devices_[d]->worker = std::thread(&Pool::run, this, d);
+    }
+}
+
+Pool::~Pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &dev : devices_) {
+        dev->worker.join();
+    }
+}
+
+std::future<PoolResult> Pool::sign(std::vector<Apdu> packets, Signature *sig) {
+    Job job;
+    job.packets = std::make_shared<std::vector<Apdu>>(std::move(packets));
+    job.sig = sig;
+    std::future<PoolResult> future = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+        fail_if_stranded();
+    }
+    cv_.notify_all();
+    return future;
+}
+
+std::vector<DeviceStatus> Pool::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DeviceStatus> out;
+    for (const auto &dev : devices_) {
+        out.push_back(dev->status);
+    }
+    return out;
+}
+
+uint32_t Pool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t total = 0;
+    for (const auto &dev : devices_) {
+        if (!dev->status.online) {
+            continue;
+        }
+        total += dev->status.current.remaining();
+        if (dev->status.other_known) {
+            total += dev->status.other.remaining();
+        }
+    }
+    return total;
+}
+
+void Pool::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] {
+        if (!queue_.empty()) {
+            return false;
+        }
+        for (size_t d = 0; d < devices_.size(); d++) {
+            const DeviceStatus &s = devices_[d]->status;
+            if (s.starting || s.busy || wants_rollover(d)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+////////////////////////////////////////////////
+
+void Pool::run(size_t d) {
+    refresh(d);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    Device &dev = *devices_[d];
+    for (;;) {
+        cv_.wait(lock, [this, d, &dev] {
+            return (stop_ && queue_.empty()) || !dev.status.online ||
+                   (!queue_.empty() && best_idle() == d) || wants_rollover(d);
+        });
+
+        if (!dev.status.online) {
+            return;
+        }
+
+        if (!queue_.empty() && best_idle() == d) {
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            sign_job(d, job, lock);
+        } else if (wants_rollover(d)) {
+            rollover(d, lock);
+        } else if (stop_) {
+            return;
+        }
+
+        fail_if_stranded();
+        cv_.notify_all();
+    }
+}
+
+void Pool::refresh(size_t d) {
+    Device &dev = *devices_[d];
+    State state = State();
+    PublicKey pk = PublicKey();
+    bool other_known = false;
+    State other = State();
+    bool online = true;
+
+    try {
+        // Both trees of the seed at once, older apps only report the current one
+        try {
+            const Trees trees = dev.client.get_trees();
+            const TreeInfo &cur = trees.trees.at(trees.current);
+            state = cur.state;
+            pk = cur.pk;
+            other = trees.trees.at(trees.current ^ 1).state;
+            other_known = true;
+        } catch (const DeviceError &) {
+            state = dev.client.get_state();
+            if (state.mode == APPMODE_READY) {
+                pk = dev.client.public_key();
+            }
+        }
+    } catch (const std::exception &) {
+        online = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dev.status.starting = false;
+        dev.status.online = online;
+        dev.status.current = tree_status(state);
+        dev.status.other = tree_status(other);
+        dev.status.other_known = other_known;
+        dev.pk = pk;
+        fail_if_stranded();
+    }
+    cv_.notify_all();
+}
+
+void Pool::sign_job(size_t d, Job &job, std::unique_lock<std::mutex> &lock) {
+    Device &dev = *devices_[d];
+    dev.status.busy = true;
+    const PublicKey pk = dev.pk;
+    lock.unlock();
+
+    bool online = true;
+    bool signed_ok = false;
+    State state = State();
+    PoolResult result;
+
+    try {
+        dev.client.sign(*job.packets, *job.sig);
+        signed_ok = true;
+
+        // The signature starts with its xmss index
+        const uint8_t *s = job.sig->bytes;
+        result.device = d;
+        result.index = static_cast<uint16_t>(s[2] << 8 | s[3]);
+        result.pk = pk;
+    } catch (const DeviceError &) {
+        job.result.set_exception(std::current_exception());
+        // The index may have moved on the device, read it again
+        try {
+            state = dev.client.get_state();
+        } catch (const std::exception &) {
+            online = false;
+        }
+    } catch (const std::exception &) {
+        job.result.set_exception(std::current_exception());
+        online = false;
+    }
+
+    lock.lock();
+    dev.status.busy = false;
+    dev.status.online = online;
+    if (signed_ok) {
+        dev.status.current.index = static_cast<uint16_t>(result.index + 1);
+        dev.status.signatures++;
+    } else if (online) {
+        dev.status.current = tree_status(state);
+    }
+    lock.unlock();
+
+    // Outside the lock, the caller may submit again from a continuation
+    if (signed_ok) {
+        job.result.set_value(result);
+    }
+    lock.lock();
+}
+
+void Pool::rollover(size_t d, std::unique_lock<std::mutex> &lock) {
+    Device &dev = *devices_[d];
+    dev.status.busy = true;
+    lock.unlock();
+
+    bool online = true;
+    bool refused = false;
+    State state = State();
+    PublicKey pk = PublicKey();
+
+    try {
+        state = dev.client.switch_tree();
+        if (state.mode == APPMODE_READY) {
+            pk = dev.client.public_key();
+        }
+    } catch (const DeviceError &) {
+        refused = true;
+    } catch (const std::exception &) {
+        online = false;
+    }
+
+    lock.lock();
+    dev.status.busy = false;
+    dev.status.online = online;
+    if (refused) {
+        dev.status.rollover_refused = true;
+    } else if (online) {
+        dev.status.other = dev.status.current;
+        dev.status.other_known = true;
+        dev.status.current = tree_status(state);
+        dev.status.rollovers++;
+        dev.pk = pk;
+    }
+}
+
+size_t Pool::best_idle() const {
+    size_t best = NONE;
+    uint16_t best_remaining = 0;
+    for (size_t d = 0; d < devices_.size(); d++) {
+        const DeviceStatus &s = devices_[d]->status;
+        const uint16_t remaining = s.current.remaining();
+        if (s.online && !s.busy && remaining > best_remaining) {
+            best = d;
+            best_remaining = remaining;
+        }
+    }
+    return best;
+}
+
+bool Pool::can_roll_over(size_t d) const {
+    const DeviceStatus &s = devices_[d]->status;
+    return s.online && !s.rollover_refused && s.current.remaining() <= rollover_at_ &&
+           (!s.other_known || s.other.remaining() > s.current.remaining());
+}
+
+bool Pool::wants_rollover(size_t d) const {
+    // Only when the device would not be given a request anyway
+    return !stop_ && !devices_[d]->status.busy && can_roll_over(d) &&
+           (queue_.empty() || best_idle() != d);
+}
+
+void Pool::fail_if_stranded() {
+    if (queue_.empty()) {
+        return;
+    }
+    for (size_t d = 0; d < devices_.size(); d++) {
+        const DeviceStatus &s = devices_[d]->status;
+        if (s.starting || (s.online && (s.busy || s.current.remaining() > 0 || can_roll_over(d)))) {
+            return;
+        }
+    }
+
+    while (!queue_.empty()) {
+        queue_.front().result.set_exception(
+                std::make_exception_ptr(std::runtime_error("no signatures left in the pool")));
+        queue_.pop_front();
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/sim_transport.h"
+
+#include <cstring>
+
+#include "sim.h"
+
+namespace qrl {
+
+void SimTransport::send(const uint8_t *cmd, size_t cmd_len) {
+    if (cmd_len_ != 0) {
+        throw TransportError("sim: a command is already in flight");
+    }
+    if (cmd_len > sizeof(cmd_)) {
+        throw TransportError("sim: command too long");
+    }
+    memcpy(cmd_, cmd, cmd_len);
+    cmd_len_ = static_cast<uint16_t>(cmd_len);
+}
+
+size_t SimTransport::receive(uint8_t *resp, size_t resp_cap) {
+    if (cmd_len_ == 0) {
+        throw TransportError("sim: no command in flight");
+    }
+
+    // sim_exchange needs room for a full APDU buffer
+    uint8_t buf[REPLY_MAX_SIZE];
+    uint8_t *out = resp_cap >= sizeof(buf) ? resp : buf;
+
+    uint16_t len = 0;
+    const uint16_t sw = sim_exchange(cmd_, cmd_len_, out, &len);
+    cmd_len_ = 0;
+
+    if (sw == 0) {
+        throw TransportError("sim: no reply");
+    }
+    if (len > resp_cap) {
+        throw TransportError("sim: reply too long");
+    }
+    if (out != resp) {
+        memcpy(resp, out, len);
+    }
+    return len;
+}
+
+}
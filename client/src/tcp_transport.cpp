@@ -0,0 +1,124 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/transport.h"
+
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace qrl {
+
+// speculos framing, see sim/server.c
+//   request     [length, 4 bytes BE] [apdu]
+//   reply       [length without the status word, 4 bytes BE] [data] [sw]
+
+namespace {
+
+void read_all(int fd, uint8_t *buf, size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::read(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw TransportError("tcp: connection closed");
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+}
+
+TcpTransport::TcpTransport(const std::string &host, uint16_t port) : fd_(-1) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        throw TransportError("tcp: cannot resolve " + host);
+    }
+
+    for (addrinfo *ai = res; ai != nullptr && fd_ < 0; ai = ai->ai_next) {
+        fd_ = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd_ >= 0 && ::connect(fd_, ai->ai_addr, ai->ai_addrlen) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    freeaddrinfo(res);
+
+    if (fd_ < 0) {
+        throw TransportError("tcp: cannot connect to " + host + ":" + std::to_string(port));
+    }
+
+    const int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+TcpTransport::~TcpTransport() {
+    ::close(fd_);
+}
+
+void TcpTransport::send(const uint8_t *cmd, size_t cmd_len) {
+    uint8_t frame[4 + 260];
+    if (cmd_len > sizeof(frame) - 4) {
+        throw TransportError("tcp: command too long");
+    }
+
+    frame[0] = static_cast<uint8_t>(cmd_len >> 24);
+    frame[1] = static_cast<uint8_t>(cmd_len >> 16);
+    frame[2] = static_cast<uint8_t>(cmd_len >> 8);
+    frame[3] = static_cast<uint8_t>(cmd_len);
+    memcpy(frame + 4, cmd, cmd_len);
+
+    const uint8_t *p = frame;
+    size_t len = 4 + cmd_len;
+    while (len > 0) {
+        const ssize_t n = ::write(fd_, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw TransportError("tcp: write failed");
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+size_t TcpTransport::receive(uint8_t *resp, size_t resp_cap) {
+    uint8_t hdr[4];
+    read_all(fd_, hdr, sizeof(hdr));
+
+    const size_t len = 2 + (static_cast<size_t>(hdr[0]) << 24 | static_cast<size_t>(hdr[1]) << 16 |
+                            static_cast<size_t>(hdr[2]) << 8 | hdr[3]);
+    if (len > resp_cap) {
+        throw TransportError("tcp: reply too long");
+    }
+
+    // Straight into the caller's buffer
+    read_all(fd_, resp, len);
+    return len;
+}
+
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "qrl/txbuild.h"
+
+#include <cstring>
+
+#include "qrl_types.h"
+#include "sha256_mb.h"
+
+namespace qrl {
+
+namespace {
+
+uint8_t *put_be64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = static_cast<uint8_t>(v >> (56 - 8 * i));
+    }
+    return p + 8;
+}
+
+// qrltx_addr_block
+uint8_t *put_addr(uint8_t *p, const uint8_t address[TX_ADDRESS_SIZE], uint64_t amount) {
+    memcpy(p, address, TX_ADDRESS_SIZE);
+    return put_be64(p + TX_ADDRESS_SIZE, amount);
+}
+
+// Txs of one hashed length waiting for a multi-buffer call
+struct Lanes {
+    uint8_t count;
+    const uint8_t *in[SHA256_MB_LANES];
+    uint8_t *out[SHA256_MB_LANES];
+};
+
+}
+
+TxArena::TxArena(size_t max_txs, size_t max_bytes) : buf_(max_bytes), max_txs_(max_txs) {
+    offsets_.reserve(max_txs);
+}
+
+uint8_t *TxArena::begin(uint8_t type, size_t items) {
+    if (items == 0 || items > UINT8_MAX) {
+        throw TxError("tx item count out of range");
+    }
+    if (offsets_.size() == max_txs_ || buf_.size() - used_ < 2) {
+        throw std::length_error("tx arena is full");
+    }
+
+    uint8_t *p = &buf_[used_];
+    p[0] = type;
+    p[1] = static_cast<uint8_t>(items);
+
+    // The app's own rule, schema table and item limits included
+    const int16_t size = get_qrltx_size(reinterpret_cast<const qrltx_t *>(p));
+    if (size < 0) {
+        throw TxError("tx rejected by get_qrltx_size");
+    }
+    if (buf_.size() - used_ < static_cast<size_t>(size)) {
+        throw std::length_error("tx arena is full");
+    }
+    return p + 2;
+}
+
+size_t TxArena::commit(const uint8_t *end) {
+    const uint8_t *p = &buf_[used_];
+    const size_t size = static_cast<size_t>(end - p);
+    if (size != static_cast<size_t>(get_qrltx_size(reinterpret_cast<const qrltx_t *>(p)))) {
+        throw std::logic_error("tx layout differs from qrltx_t");
+    }
+
+    offsets_.push_back(static_cast<uint32_t>(used_));
+    used_ += size;
+    return offsets_.size() - 1;
+}
+
+size_t TxArena::add_transfer(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const TxDest *dst, size_t count) {
+    uint8_t *p = begin(TX_TRANSFER, count);
+    p = put_addr(p, master, fee);
+    for (size_t i = 0; i < count; i++) {
+        p = put_addr(p, dst[i].address, dst[i].amount);
+    }
+    return commit(p);
+}
+
+size_t TxArena::add_token(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee,
+                          const uint8_t token_hash[TX_TOKEN_HASH_SIZE], const TxDest *dst, size_t count) {
+    uint8_t *p = begin(TX_TOKEN, count);
+    p = put_addr(p, master, fee);
+    memcpy(p, token_hash, TX_TOKEN_HASH_SIZE);
+    p += TX_TOKEN_HASH_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        p = put_addr(p, dst[i].address, dst[i].amount);
+    }
+    return commit(p);
+}
+
+size_t TxArena::add_slave(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const TxSlave *slaves, size_t count) {
+    uint8_t *p = begin(TX_SLAVE, count);
+    p = put_addr(p, master, fee);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(p, slaves[i].pk, TX_SLAVE_PK_SIZE);
+        p = put_be64(p + TX_SLAVE_PK_SIZE, slaves[i].access);
+    }
+    return commit(p);
+}
+
+size_t TxArena::add_message(const uint8_t master[TX_ADDRESS_SIZE], uint64_t fee, const uint8_t *message, size_t len) {
+    // for messages the item count is the message length
+    uint8_t *p = begin(TX_MESSAGE, len);
+    p = put_addr(p, master, fee);
+    memcpy(p, message, len);
+    return commit(p + len);
+}
+
+void TxArena::hash(uint8_t *hashes) const {
+    // indexed by hashed length, which is below sizeof(qrltx_t)
+    std::vector<Lanes> pending(sizeof(qrltx_t));
+
+    for (size_t i = 0; i < offsets_.size(); i++) {
+        const uint8_t *p = tx(i);
+        // skip metadata and source address, as get_qrltx_hash
+        const uint8_t hash_offset = get_qrltx_schema(p[0])->hash_offset;
+        const size_t len = tx_size(i) - hash_offset;
+
+        Lanes &l = pending[len];
+        l.in[l.count] = p + hash_offset;
+        l.out[l.count] = hashes + TX_HASH_SIZE * i;
+        if (++l.count == SHA256_MB_LANES) {
+            sha256_mb(l.out, l.in, static_cast<uint16_t>(len), l.count);
+            l.count = 0;
+        }
+    }
+
+    for (size_t len = 0; len < pending.size(); len++) {
+        Lanes &l = pending[len];
+        if (l.count > 0) {
+            sha256_mb(l.out, l.in, static_cast<uint16_t>(len), l.count);
+        }
+    }
+}
+
+void TxArena::clear() {
+    offsets_.clear();
+    used_ = 0;
+}
+
+}
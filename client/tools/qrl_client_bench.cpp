@@ -0,0 +1,235 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// Signs a batch of transfers on one or more devices through the client library
+// and reports the throughput.
+//
+//   qrl_client_bench [--tcp <host:port>]... [--hid] [--sim] [--load <image>] [--count <n>]
+//                    [--pool <rollover at>]
+//
+// --tcp connects to qrl_sim --listen or speculos, --hid to every Ledger found on
+// hidraw and --sim runs the app in this process, keyed with keygen or --load.
+// Without --pool every device signs count transactions, with it the pool
+// schedules count transactions in total and idle devices switch tree once
+// their current one has at most <rollover at> signatures left.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "qrl/client.h"
+#include "qrl/pool.h"
+#include "qrl/sim_transport.h"
+#include "sim.h"
+
+namespace {
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--tcp <host:port>]... [--hid] [--sim] [--load <image>] [--count <n>]\n"
+                    "       [--pool <rollover at>]\n", name);
+}
+
+// Transfer with one destination, as in sim/traces/sign.trace
+std::vector<uint8_t> transfer_tx() {
+    std::vector<uint8_t> tx(2 + 2 * 47, 0);
+    tx[0] = 0;                              // QRLTX_TX
+    tx[1] = 1;
+    memset(&tx[2], 0x01, 39);
+    tx[2 + 39 + 7] = 5;                     // fee
+    memset(&tx[2 + 47], 0x02, 39);
+    tx[2 + 47 + 39 + 4] = 0x3B;             // amount, 1 quanta
+    tx[2 + 47 + 39 + 5] = 0x9A;
+    tx[2 + 47 + 39 + 6] = 0xCA;
+    return tx;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint16_t signature_index(const qrl::Signature &sig) {
+    // The signature starts with its xmss index
+    return static_cast<uint16_t>(sig.bytes[2] << 8 | sig.bytes[3]);
+}
+
+// count signatures on every device, each one with its own queue
+int run_clients(const std::vector<qrl::Transport *> &devices, const std::vector<qrl::Apdu> &packets, int count) {
+    std::vector<std::unique_ptr<qrl::AsyncClient>> clients;
+    std::vector<std::vector<qrl::Signature>> sigs(devices.size(), std::vector<qrl::Signature>(count));
+    std::vector<std::vector<std::future<void>>> done(devices.size());
+    std::vector<uint16_t> first_index(devices.size());
+
+    for (size_t d = 0; d < devices.size(); d++) {
+        clients.emplace_back(new qrl::AsyncClient(*devices[d]));
+        const qrl::State state = clients[d]->get_state().get();
+        if (state.mode != qrl::APPMODE_READY || state.index + count > qrl::SIG_MAX_INDEX) {
+            fprintf(stderr, "device %zu: not ready or not enough signatures left\n", d);
+            return 1;
+        }
+        first_index[d] = state.index;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        for (size_t d = 0; d < clients.size(); d++) {
+            done[d].push_back(clients[d]->sign(packets, &sigs[d][i]));
+        }
+    }
+
+    int failed = 0;
+    for (size_t d = 0; d < clients.size(); d++) {
+        for (int i = 0; i < count; i++) {
+            done[d][i].get();
+            if (signature_index(sigs[d][i]) != first_index[d] + i) {
+                failed++;
+            }
+        }
+    }
+
+    const double elapsed = seconds_since(start);
+    const size_t total = clients.size() * static_cast<size_t>(count);
+    printf("%zu devices, %zu signatures in %.3f s, %.1f signatures/s, %d with a wrong index\n",
+           clients.size(), total, elapsed, static_cast<double>(total) / elapsed, failed);
+    return failed == 0 ? 0 : 1;
+}
+
+// count signatures in total, scheduled by the pool
+int run_pool(const std::vector<qrl::Transport *> &devices, const std::vector<qrl::Apdu> &packets,
+             int count, uint16_t rollover_at) {
+    qrl::Pool pool(devices, rollover_at);
+    std::vector<qrl::Signature> sigs(count);
+    std::vector<std::future<qrl::PoolResult>> done;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        done.push_back(pool.sign(packets, &sigs[i]));
+    }
+
+    // A one time key must never be used twice
+    std::set<std::tuple<size_t, qrl::PublicKey, uint16_t>> used;
+    int failed = 0;
+    int reused = 0;
+    for (int i = 0; i < count; i++) {
+        try {
+            const qrl::PoolResult r = done[i].get();
+            if (r.index != signature_index(sigs[i]) || !used.insert(std::make_tuple(r.device, r.pk, r.index)).second) {
+                reused++;
+            }
+        } catch (const std::exception &) {
+            failed++;
+        }
+    }
+    const double elapsed = seconds_since(start);
+    pool.wait_idle();
+
+    const std::vector<qrl::DeviceStatus> status = pool.status();
+    for (size_t d = 0; d < status.size(); d++) {
+        const qrl::DeviceStatus &s = status[d];
+        printf("device %zu: %s, %u signatures, %u rollovers, %u left on the current tree",
+               d, s.online ? "online" : "offline", s.signatures, s.rollovers, s.current.remaining());
+        if (s.other_known) {
+            printf(", %u on the other", s.other.remaining());
+        }
+        printf("\n");
+    }
+    printf("%zu devices, %d signatures in %.3f s, %.1f signatures/s, %d failed, %d reused or wrong index, %u left\n",
+           devices.size(), count - failed, elapsed, static_cast<double>(count - failed) / elapsed,
+           failed, reused, pool.capacity());
+    return reused == 0 ? 0 : 1;
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::unique_ptr<qrl::Transport>> transports;
+    bool sim = false;
+    const char *image = nullptr;
+    int count = 10;
+    int rollover_at = -1;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc) {
+                const std::string addr = argv[++i];
+                const size_t colon = addr.rfind(':');
+                if (colon == std::string::npos) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                transports.emplace_back(new qrl::TcpTransport(addr.substr(0, colon),
+                                                              static_cast<uint16_t>(atoi(addr.c_str() + colon + 1))));
+            } else if (strcmp(argv[i], "--hid") == 0) {
+                for (const auto &path : qrl::HidTransport::enumerate()) {
+                    transports.emplace_back(new qrl::HidTransport(path));
+                }
+            } else if (strcmp(argv[i], "--sim") == 0) {
+                sim = true;
+            } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+                image = argv[++i];
+            } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+                count = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+                rollover_at = atoi(argv[++i]);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (sim) {
+        if (image != nullptr) {
+            if (sim_snapshot_load(image) != 0) {
+                fprintf(stderr, "cannot load %s\n", image);
+                return 1;
+            }
+        } else {
+            sim_init(nullptr);
+            sim_ux_select("Init Tree");
+        }
+        transports.emplace_back(new qrl::SimTransport());
+    }
+
+    if (transports.empty() || count <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Encoded once for every device and signature
+    const std::vector<uint8_t> tx = transfer_tx();
+    const std::vector<qrl::Apdu> packets = qrl::encode_sign(tx.data(), tx.size());
+
+    std::vector<qrl::Transport *> devices;
+    for (const auto &t : transports) {
+        devices.push_back(t.get());
+    }
+
+    try {
+        return rollover_at >= 0 ? run_pool(devices, packets, count, static_cast<uint16_t>(rollover_at))
+                                : run_clients(devices, packets, count);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// Builds a batch of transfers and messages in a TxArena and hashes them, next to
+// the app's get_qrltx_hash one tx at a time. txbuild_tests checks the hashes.
+//
+//   qrl_txbuild_bench [--count <n>] [--rounds <n>]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "qrl/txbuild.h"
+#include "qrl_types.h"
+
+namespace {
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--count <n>] [--rounds <n>]\n", name);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One transfer with 1 to 3 destinations or one message every fourth tx
+void build(qrl::TxArena &arena, size_t count) {
+    uint8_t master[qrl::TX_ADDRESS_SIZE];
+    qrl::TxDest dst[3];
+    uint8_t message[80];
+
+    for (size_t i = 0; i < count; i++) {
+        memset(master, 0x01, sizeof(master));
+        memcpy(master, &i, sizeof(i));
+        if (i % 4 == 3) {
+            memset(message, 'a' + static_cast<int>(i % 26), sizeof(message));
+            arena.add_message(master, 5, message, 1 + i % sizeof(message));
+            continue;
+        }
+        const size_t n = 1 + i % 3;
+        for (size_t j = 0; j < n; j++) {
+            memset(dst[j].address, 0x02 + static_cast<int>(j), qrl::TX_ADDRESS_SIZE);
+            dst[j].amount = 1000000000ull * (i + j + 1);
+        }
+        arena.add_transfer(master, 5, dst, n);
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    size_t count = 10000;
+    int rounds = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (count == 0 || rounds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    qrl::TxArena arena(count, count * sizeof(qrltx_t));
+    std::vector<uint8_t> hashes(count * qrl::TX_HASH_SIZE);
+
+    double build_s = 0;
+    double hash_s = 0;
+    for (int r = 0; r < rounds; r++) {
+        arena.clear();
+        auto start = std::chrono::steady_clock::now();
+        build(arena, count);
+        build_s += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        arena.hash(hashes.data());
+        hash_s += seconds_since(start);
+    }
+
+    // Reference: one get_qrltx_hash per tx, as the app hashes an INS_SIGN packet
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < arena.size(); i++) {
+        qrltx_t tx;
+        memset(&tx, 0, sizeof(tx));
+        memcpy(&tx, arena.tx(i), arena.tx_size(i));
+        get_qrltx_hash(&tx, &hashes[i * qrl::TX_HASH_SIZE]);
+    }
+    const double ref_s = seconds_since(start);
+
+    const double total = static_cast<double>(count) * rounds;
+    printf("# %zu txs x %d rounds\n", count, rounds);
+    printf("build          %10.0f txs/s\n", total / build_s);
+    printf("hash (mb)      %10.0f txs/s\n", total / hash_s);
+    printf("get_qrltx_hash %10.0f txs/s\n", static_cast<double>(count) / ref_s);
+    return 0;
+}
@@ -31,6 +31,17 @@ typedef struct {
     uint8_t in_use: 1;
 } buffer_state_t;
 
+/// Flash is written in whole pages when flush batching is enabled
+#define BUFFERING_FLASH_PAGE 64
+
+typedef struct {
+    uint8_t *data;
+    uint16_t size;
+    uint16_t head;      // next byte written by the producer
+    uint16_t tail;      // next byte read by the consumer
+    uint16_t used;
+} buffer_ring_t;
+
 /// Initialize buffer
 /// \param ram_buffer
 /// \param ram_buffer_size
@@ -62,6 +73,72 @@ buffer_state_t *buffering_get_flash_buffer();
 /// \return
 buffer_state_t *buffering_get_buffer();
 
+/// Stage flash appends in RAM and write them in whole pages. The flash buffer
+/// should be page aligned and the RAM buffer at least one page. Call it after
+/// buffering_init, which disables it
+/// \param enabled
+void buffering_set_flush_batching(uint8_t enabled);
+
+/// Write the staged partial page, needed before reading flash data
+void buffering_flush();
+
+/// Initialize a ring buffer
+/// \param ring
+/// \param data
+/// \param size
+void buffering_ring_init(buffer_ring_t *ring, uint8_t *data, uint16_t size);
+
+/// Drop all data in a ring buffer
+/// \param ring
+void buffering_ring_reset(buffer_ring_t *ring);
+
+/// buffering_ring_used
+/// \param ring
+/// \return the number of bytes that can be read
+uint16_t buffering_ring_used(const buffer_ring_t *ring);
+
+/// buffering_ring_free
+/// \param ring
+/// \return the number of bytes that can be written
+uint16_t buffering_ring_free(const buffer_ring_t *ring);
+
+/// Append data to a ring buffer, nothing is written if it does not fit
+/// \param ring
+/// \param data
+/// \param length
+/// \return the number of appended bytes
+int buffering_ring_write(buffer_ring_t *ring, const uint8_t *data, int length);
+
+/// Copy data out of a ring buffer and consume it
+/// \param ring
+/// \param out
+/// \param length
+/// \return the number of bytes read, at most length
+int buffering_ring_read(buffer_ring_t *ring, uint8_t *out, int length);
+
+/// Contiguous readable data at the consumer cursor, it stops at the end of the
+/// storage so a wrapped ring needs two spans
+/// \param ring
+/// \param length set to the span length
+/// \return the span, valid until it is consumed
+const uint8_t *buffering_ring_read_span(const buffer_ring_t *ring, uint16_t *length);
+
+/// Advance the consumer cursor
+/// \param ring
+/// \param length clamped to the used bytes
+void buffering_ring_consume(buffer_ring_t *ring, uint16_t length);
+
+/// Contiguous free space at the producer cursor, to be filled in place
+/// \param ring
+/// \param length set to the span length
+/// \return the span
+uint8_t *buffering_ring_write_span(const buffer_ring_t *ring, uint16_t *length);
+
+/// Advance the producer cursor over bytes written into a write span
+/// \param ring
+/// \param length clamped to the free bytes
+void buffering_ring_commit(buffer_ring_t *ring, uint16_t length);
+
 #ifdef __cplusplus
 }
 #endif
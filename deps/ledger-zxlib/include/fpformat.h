@@ -0,0 +1,49 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Decimal digits of an unsigned value, zero terminated
+/// \param dst buffer of at least 21 chars
+/// \param value
+/// \return the number of digits
+size_t uint64_to_dec(char *dst, uint64_t value);
+
+/// Fixed point formatting, same output as fpuint64_to_str
+/// \param dst buffer of at least max(20, decimals) + 3 chars
+/// \param value
+/// \param decimals
+/// \return the length of the string
+size_t fpuint64_format(char *dst, uint64_t value, uint8_t decimals);
+
+/// Formats count values into strings spaced stride chars apart
+/// \param dst
+/// \param stride
+/// \param values
+/// \param count
+/// \param decimals
+void fpuint64_format_batch(char *dst, size_t stride, const uint64_t *values, size_t count, uint8_t decimals);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Encode bytes as uppercase hex, the output is zero terminated
+/// \param dst buffer of at least 2 * count + 1 chars
+/// \param src
+/// \param count
+/// \return the number of chars written, without the terminator
+size_t hex_encode(char *dst, const uint8_t *src, size_t count);
+
+/// Decode hex, upper or lower case
+/// \param dst buffer of at least len / 2 bytes
+/// \param src
+/// \param len number of chars, must be even
+/// \return the number of bytes written or -1 if the input is not hex
+int hex_decode(uint8_t *dst, const char *src, size_t len);
+
+/// Portable versions, used for the tail of the vector kernels
+size_t hex_encode_scalar(char *dst, const uint8_t *src, size_t count);
+int hex_decode_scalar(uint8_t *dst, const char *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -82,6 +82,8 @@ void __logstack();
 #include <inttypes.h>
 #include <stdint.h>
 #include <memory.h>
+#include "hexutils.h"
+#include "fpformat.h"
 
 #define __Z_INLINE inline __attribute__((always_inline)) static
 
@@ -100,12 +102,7 @@ void __logstack();
 #endif
 
 __Z_INLINE void array_to_hexstr(char *dst, const uint8_t *src, uint8_t count) {
-    const char hexchars[] = "0123456789ABCDEF";
-    for (uint8_t i = 0; i < count; i++, src++) {
-        *dst++ = hexchars[*src >> 4];
-        *dst++ = hexchars[*src & 0x0F];
-    }
-    *dst = 0; // terminate string
+    hex_encode(dst, src, count);
 }
 
 __Z_INLINE const char *int64_to_str(char *data, int size, int64_t number) {
@@ -198,26 +195,7 @@ __Z_INLINE int64_t str_to_int64(const char *start, const char *end, char *error)
 }
 
 __Z_INLINE void fpuint64_to_str(char *dst, const uint64_t value, uint8_t decimals) {
-    char buffer[30];
-
-    int64_to_str(buffer, 30, value);
-    size_t digits = strlen(buffer);
-
-    if (digits <= decimals) {
-        *dst++ = '0';
-        *dst++ = '.';
-        for (uint16_t i = 0; i < decimals - digits; i++, dst++)
-            *dst = '0';
-        strcpy(dst, buffer);
-    } else {
-        strcpy(dst, buffer);
-        const size_t shift = digits - decimals;
-        dst = dst + shift;
-        *dst++ = '.';
-
-        char *p = buffer + shift;
-        strcpy(dst, p);
-    }
+    fpuint64_format(dst, value, decimals);
 }
 
 __Z_INLINE uint64_t uint64_from_BEarray(const uint8_t data[8]) {
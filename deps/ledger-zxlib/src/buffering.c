@@ -23,6 +23,7 @@ extern "C" {
 
 buffer_state_t ram;         // Ram
 buffer_state_t flash;       // Flash
+uint8_t flush_batching;     // flash appends are staged in ram
 
 void buffering_init(uint8_t *ram_buffer,
                     uint16_t ram_buffer_size,
@@ -37,6 +38,8 @@ void buffering_init(uint8_t *ram_buffer,
     flash.size = flash_buffer_size;
     flash.pos = 0;
     flash.in_use = 0;
+
+    flush_batching = 0;
 }
 
 void buffering_reset() {
@@ -46,6 +49,39 @@ void buffering_reset() {
     flash.in_use = 0;
 }
 
+// The partial page at the end of flash is kept at the start of the ram buffer,
+// which is unused once the data has moved to flash. Whole pages are written
+// straight from the input
+static void flash_append_batched(const uint8_t *data, int length) {
+    uint16_t staged = flash.pos % BUFFERING_FLASH_PAGE;
+    while (length > 0) {
+        if (staged == 0 && length >= BUFFERING_FLASH_PAGE) {
+            const uint16_t n = (uint16_t) (length - length % BUFFERING_FLASH_PAGE);
+            MEMCPY_NV(flash.data + flash.pos, (void *) data, n);
+            flash.pos += n;
+            data += n;
+            length -= n;
+            continue;
+        }
+
+        uint16_t n = BUFFERING_FLASH_PAGE - staged;
+        if (n > length) {
+            n = (uint16_t) length;
+        }
+        // The first flash append comes from the ram buffer itself
+        MEMMOVE(ram.data + staged, data, n);
+        staged += n;
+        flash.pos += n;
+        data += n;
+        length -= n;
+
+        if (staged == BUFFERING_FLASH_PAGE) {
+            MEMCPY_NV(flash.data + flash.pos - BUFFERING_FLASH_PAGE, ram.data, BUFFERING_FLASH_PAGE);
+            staged = 0;
+        }
+    }
+}
+
 int buffering_append(uint8_t *data, int length) {
     if (ram.in_use) {
         if (ram.size - ram.pos >= length) {
@@ -66,8 +102,12 @@ int buffering_append(uint8_t *data, int length) {
     } else {
         // Flash in use, append to flash
         if (flash.size - flash.pos >= length) {
-            MEMCPY_NV(flash.data + flash.pos, data, length);
-            flash.pos += length;
+            if (flush_batching) {
+                flash_append_batched(data, length);
+            } else {
+                MEMCPY_NV(flash.data + flash.pos, data, length);
+                flash.pos += length;
+            }
         } else {
             return 0;
         }
@@ -90,6 +130,111 @@ buffer_state_t *buffering_get_buffer() {
     return &flash;
 }
 
+void buffering_set_flush_batching(uint8_t enabled) {
+    flush_batching = enabled && ram.size >= BUFFERING_FLASH_PAGE;
+}
+
+void buffering_flush() {
+    const uint16_t staged = flash.pos % BUFFERING_FLASH_PAGE;
+    if (flush_batching && flash.in_use && staged > 0) {
+        MEMCPY_NV(flash.data + flash.pos - staged, ram.data, staged);
+    }
+}
+
+void buffering_ring_init(buffer_ring_t *ring, uint8_t *data, uint16_t size) {
+    ring->data = data;
+    ring->size = size;
+    buffering_ring_reset(ring);
+}
+
+void buffering_ring_reset(buffer_ring_t *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->used = 0;
+}
+
+uint16_t buffering_ring_used(const buffer_ring_t *ring) {
+    return ring->used;
+}
+
+uint16_t buffering_ring_free(const buffer_ring_t *ring) {
+    return ring->size - ring->used;
+}
+
+int buffering_ring_write(buffer_ring_t *ring, const uint8_t *data, int length) {
+    if (length < 0 || length > buffering_ring_free(ring)) {
+        return 0;
+    }
+    int written = 0;
+    while (written < length) {
+        uint16_t n;
+        uint8_t *span = buffering_ring_write_span(ring, &n);
+        if (n > length - written) {
+            n = (uint16_t) (length - written);
+        }
+        MEMCPY(span, data + written, n);
+        buffering_ring_commit(ring, n);
+        written += n;
+    }
+    return length;
+}
+
+int buffering_ring_read(buffer_ring_t *ring, uint8_t *out, int length) {
+    int read = 0;
+    while (read < length && ring->used > 0) {
+        uint16_t n;
+        const uint8_t *span = buffering_ring_read_span(ring, &n);
+        if (n > length - read) {
+            n = (uint16_t) (length - read);
+        }
+        MEMCPY(out + read, span, n);
+        buffering_ring_consume(ring, n);
+        read += n;
+    }
+    return read;
+}
+
+const uint8_t *buffering_ring_read_span(const buffer_ring_t *ring, uint16_t *length) {
+    const uint16_t to_end = ring->size - ring->tail;
+    *length = ring->used < to_end ? ring->used : to_end;
+    return ring->data + ring->tail;
+}
+
+void buffering_ring_consume(buffer_ring_t *ring, uint16_t length) {
+    if (length > ring->used) {
+        length = ring->used;
+    }
+    if (length == 0) {
+        return;
+    }
+    ring->tail = (uint16_t) ((ring->tail + length) % ring->size);
+    ring->used -= length;
+    if (ring->used == 0) {
+        // Empty, start over so the next write span is as long as possible
+        ring->head = 0;
+        ring->tail = 0;
+    }
+}
+
+uint8_t *buffering_ring_write_span(const buffer_ring_t *ring, uint16_t *length) {
+    const uint16_t free_bytes = buffering_ring_free(ring);
+    const uint16_t to_end = ring->size - ring->head;
+    *length = free_bytes < to_end ? free_bytes : to_end;
+    return ring->data + ring->head;
+}
+
+void buffering_ring_commit(buffer_ring_t *ring, uint16_t length) {
+    const uint16_t free_bytes = buffering_ring_free(ring);
+    if (length > free_bytes) {
+        length = free_bytes;
+    }
+    if (length == 0) {
+        return;
+    }
+    ring->head = (uint16_t) ((ring->head + length) % ring->size);
+    ring->used += length;
+}
+
 #ifdef __cplusplus
 }
 #endif
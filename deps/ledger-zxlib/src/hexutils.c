@@ -0,0 +1,183 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "hexutils.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HEX_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HEX_NEON
+#endif
+
+// Both chars of every byte value, so encoding is one lookup per byte
+static const char hex_pairs[513] =
+        "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+        "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+        "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+        "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+        "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+        "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+        "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+        "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static int8_t hex_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return (int8_t) (c - '0');
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return (int8_t) (c - 'a' + 10);
+    }
+    return -1;
+}
+
+size_t hex_encode_scalar(char *dst, const uint8_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const char *p = hex_pairs + 2 * src[i];
+        dst[2 * i] = p[0];
+        dst[2 * i + 1] = p[1];
+    }
+    dst[2 * count] = 0;
+    return 2 * count;
+}
+
+int hex_decode_scalar(uint8_t *dst, const char *src, size_t len) {
+    if (len % 2 != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len / 2; i++) {
+        const int8_t hi = hex_nibble(src[2 * i]);
+        const int8_t lo = hex_nibble(src[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        dst[i] = (uint8_t) ((hi << 4) | lo);
+    }
+    return (int) (len / 2);
+}
+
+#if defined(HEX_SSE2)
+
+// '0' + n, plus 7 more to reach 'A' for n > 9
+static __m128i hex_ascii(__m128i n) {
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(7));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letters);
+}
+
+// Nibble values of 16 chars, *ok gets 0xFF in the lanes that are hex digits
+static __m128i hex_nibbles(__m128i c, __m128i *ok) {
+    const __m128i minus1 = _mm_set1_epi8(-1);
+    const __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i d_ok = _mm_and_si128(_mm_cmpgt_epi8(d, minus1), _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+    const __m128i l_ok = _mm_and_si128(_mm_cmpgt_epi8(l, minus1), _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+    *ok = _mm_or_si128(d_ok, l_ok);
+    return _mm_or_si128(_mm_and_si128(d_ok, d),
+                        _mm_and_si128(l_ok, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+// Pairs of nibbles to bytes, in the low half of each 16-bit lane
+static __m128i hex_join(__m128i n) {
+    const __m128i hi = _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00FF)), 4);
+    return _mm_or_si128(hi, _mm_srli_epi16(n, 8));
+}
+
+size_t hex_encode(char *dst, const uint8_t *src, size_t count) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i hi = hex_ascii(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        const __m128i lo = hex_ascii(_mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return 2 * i + hex_encode_scalar(dst + 2 * i, src + i, count - i);
+}
+
+int hex_decode(uint8_t *dst, const char *src, size_t len) {
+    if (len % 2 != 0) {
+        return -1;
+    }
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m128i ok_a, ok_b;
+        const __m128i a = hex_nibbles(_mm_loadu_si128((const __m128i *) (src + i)), &ok_a);
+        const __m128i b = hex_nibbles(_mm_loadu_si128((const __m128i *) (src + i + 16)), &ok_b);
+        if (_mm_movemask_epi8(_mm_and_si128(ok_a, ok_b)) != 0xFFFF) {
+            return -1;
+        }
+        _mm_storeu_si128((__m128i *) (dst + i / 2), _mm_packus_epi16(hex_join(a), hex_join(b)));
+    }
+    const int tail = hex_decode_scalar(dst + i / 2, src + i, len - i);
+    return tail < 0 ? -1 : (int) (i / 2) + tail;
+}
+
+#elif defined(HEX_NEON)
+
+// Nibble values of 16 chars, *ok gets 0xFF in the lanes that are hex digits
+static uint8x16_t hex_nibbles(uint8x16_t c, uint8x16_t *ok) {
+    const uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));
+    const uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    const uint8x16_t d_ok = vcltq_u8(d, vdupq_n_u8(10));
+    *ok = vorrq_u8(d_ok, vcltq_u8(l, vdupq_n_u8(6)));
+    return vbslq_u8(d_ok, d, vaddq_u8(l, vdupq_n_u8(10)));
+}
+
+size_t hex_encode(char *dst, const uint8_t *src, size_t count) {
+    const uint8x16_t digits = vld1q_u8((const uint8_t *) "0123456789ABCDEF");
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t v = vld1q_u8(src + i);
+        uint8x16x2_t out;
+        out.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(v, 4));
+        out.val[1] = vqtbl1q_u8(digits, vandq_u8(v, vdupq_n_u8(0x0F)));
+        vst2q_u8((uint8_t *) dst + 2 * i, out);
+    }
+    return 2 * i + hex_encode_scalar(dst + 2 * i, src + i, count - i);
+}
+
+int hex_decode(uint8_t *dst, const char *src, size_t len) {
+    if (len % 2 != 0) {
+        return -1;
+    }
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const uint8x16x2_t c = vld2q_u8((const uint8_t *) src + i);
+        uint8x16_t ok_hi, ok_lo;
+        const uint8x16_t hi = hex_nibbles(c.val[0], &ok_hi);
+        const uint8x16_t lo = hex_nibbles(c.val[1], &ok_lo);
+        if (vminvq_u8(vandq_u8(ok_hi, ok_lo)) != 0xFF) {
+            return -1;
+        }
+        vst1q_u8(dst + i / 2, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+    const int tail = hex_decode_scalar(dst + i / 2, src + i, len - i);
+    return tail < 0 ? -1 : (int) (i / 2) + tail;
+}
+
+#else
+
+size_t hex_encode(char *dst, const uint8_t *src, size_t count) {
+    return hex_encode_scalar(dst, src, count);
+}
+
+int hex_decode(uint8_t *dst, const char *src, size_t len) {
+    return hex_decode_scalar(dst, src, len);
+}
+
+#endif
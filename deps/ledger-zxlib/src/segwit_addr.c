@@ -24,15 +24,158 @@
 
 #include "segwit_addr.h"
 
+/* Generator terms for the top 5 bits of the checksum state, so a step is one
+ * lookup instead of five conditional XORs */
+static const uint32_t bech32_gen[32] = {
+        0x00000000, 0x3b6a57b2, 0x26508e6d, 0x1d3ad9df, 0x1ea119fa, 0x25cb4e48, 0x38f19797, 0x039bc025,
+        0x3d4233dd, 0x0628646f, 0x1b12bdb0, 0x2078ea02, 0x23e32a27, 0x18897d95, 0x05b3a44a, 0x3ed9f3f8,
+        0x2a1462b3, 0x117e3501, 0x0c44ecde, 0x372ebb6c, 0x34b57b49, 0x0fdf2cfb, 0x12e5f524, 0x298fa296,
+        0x1756516e, 0x2c3c06dc, 0x3106df03, 0x0a6c88b1, 0x09f74894, 0x329d1f26, 0x2fa7c6f9, 0x14cd914b
+};
+
 uint32_t bech32_polymod_step(uint32_t pre) {
-    uint8_t b = pre >> 25;
-    return ((pre & 0x1FFFFFF) << 5) ^
-           (-((b >> 0) & 1) & 0x3b6a57b2UL) ^
-           (-((b >> 1) & 1) & 0x26508e6dUL) ^
-           (-((b >> 2) & 1) & 0x1ea119faUL) ^
-           (-((b >> 3) & 1) & 0x3d4233ddUL) ^
-           (-((b >> 4) & 1) & 0x2a1462b3UL);
+    return ((pre & 0x1FFFFFF) << 5) ^ bech32_gen[pre >> 25];
+}
+
+#ifndef LEDGER_SPECIFIC
+/* Two steps at once, indexed by the top 10 bits of the state. 4KB, so only in
+ * host builds */
+static const uint32_t bech32_gen2[1024] = {
+        0x00000000, 0x3b6a57b2, 0x26508e6d, 0x1d3ad9df, 0x1ea119fa, 0x25cb4e48, 0x38f19797, 0x039bc025,
+        0x3d4233dd, 0x0628646f, 0x1b12bdb0, 0x2078ea02, 0x23e32a27, 0x18897d95, 0x05b3a44a, 0x3ed9f3f8,
+        0x2a1462b3, 0x117e3501, 0x0c44ecde, 0x372ebb6c, 0x34b57b49, 0x0fdf2cfb, 0x12e5f524, 0x298fa296,
+        0x1756516e, 0x2c3c06dc, 0x3106df03, 0x0a6c88b1, 0x09f74894, 0x329d1f26, 0x2fa7c6f9, 0x14cd914b,
+        0x1fd7e966, 0x24bdbed4, 0x3987670b, 0x02ed30b9, 0x0176f09c, 0x3a1ca72e, 0x27267ef1, 0x1c4c2943,
+        0x2295dabb, 0x19ff8d09, 0x04c554d6, 0x3faf0364, 0x3c34c341, 0x075e94f3, 0x1a644d2c, 0x210e1a9e,
+        0x35c38bd5, 0x0ea9dc67, 0x139305b8, 0x28f9520a, 0x2b62922f, 0x1008c59d, 0x0d321c42, 0x36584bf0,
+        0x0881b808, 0x33ebefba, 0x2ed13665, 0x15bb61d7, 0x1620a1f2, 0x2d4af640, 0x30702f9f, 0x0b1a782d,
+        0x3d3f76cc, 0x0655217e, 0x1b6ff8a1, 0x2005af13, 0x239e6f36, 0x18f43884, 0x05cee15b, 0x3ea4b6e9,
+        0x007d4511, 0x3b1712a3, 0x262dcb7c, 0x1d479cce, 0x1edc5ceb, 0x25b60b59, 0x388cd286, 0x03e68534,
+        0x172b147f, 0x2c4143cd, 0x317b9a12, 0x0a11cda0, 0x098a0d85, 0x32e05a37, 0x2fda83e8, 0x14b0d45a,
+        0x2a6927a2, 0x11037010, 0x0c39a9cf, 0x3753fe7d, 0x34c83e58, 0x0fa269ea, 0x1298b035, 0x29f2e787,
+        0x22e89faa, 0x1982c818, 0x04b811c7, 0x3fd24675, 0x3c498650, 0x0723d1e2, 0x1a19083d, 0x21735f8f,
+        0x1faaac77, 0x24c0fbc5, 0x39fa221a, 0x029075a8, 0x010bb58d, 0x3a61e23f, 0x275b3be0, 0x1c316c52,
+        0x08fcfd19, 0x3396aaab, 0x2eac7374, 0x15c624c6, 0x165de4e3, 0x2d37b351, 0x300d6a8e, 0x0b673d3c,
+        0x35becec4, 0x0ed49976, 0x13ee40a9, 0x2884171b, 0x2b1fd73e, 0x1075808c, 0x0d4f5953, 0x36250ee1,
+        0x2afaccb8, 0x11909b0a, 0x0caa42d5, 0x37c01567, 0x345bd542, 0x0f3182f0, 0x120b5b2f, 0x29610c9d,
+        0x17b8ff65, 0x2cd2a8d7, 0x31e87108, 0x0a8226ba, 0x0919e69f, 0x3273b12d, 0x2f4968f2, 0x14233f40,
+        0x00eeae0b, 0x3b84f9b9, 0x26be2066, 0x1dd477d4, 0x1e4fb7f1, 0x2525e043, 0x381f399c, 0x03756e2e,
+        0x3dac9dd6, 0x06c6ca64, 0x1bfc13bb, 0x20964409, 0x230d842c, 0x1867d39e, 0x055d0a41, 0x3e375df3,
+        0x352d25de, 0x0e47726c, 0x137dabb3, 0x2817fc01, 0x2b8c3c24, 0x10e66b96, 0x0ddcb249, 0x36b6e5fb,
+        0x086f1603, 0x330541b1, 0x2e3f986e, 0x1555cfdc, 0x16ce0ff9, 0x2da4584b, 0x309e8194, 0x0bf4d626,
+        0x1f39476d, 0x245310df, 0x3969c900, 0x02039eb2, 0x01985e97, 0x3af20925, 0x27c8d0fa, 0x1ca28748,
+        0x227b74b0, 0x19112302, 0x042bfadd, 0x3f41ad6f, 0x3cda6d4a, 0x07b03af8, 0x1a8ae327, 0x21e0b495,
+        0x17c5ba74, 0x2cafedc6, 0x31953419, 0x0aff63ab, 0x0964a38e, 0x320ef43c, 0x2f342de3, 0x145e7a51,
+        0x2a8789a9, 0x11edde1b, 0x0cd707c4, 0x37bd5076, 0x34269053, 0x0f4cc7e1, 0x12761e3e, 0x291c498c,
+        0x3dd1d8c7, 0x06bb8f75, 0x1b8156aa, 0x20eb0118, 0x2370c13d, 0x181a968f, 0x05204f50, 0x3e4a18e2,
+        0x0093eb1a, 0x3bf9bca8, 0x26c36577, 0x1da932c5, 0x1e32f2e0, 0x2558a552, 0x38627c8d, 0x03082b3f,
+        0x08125312, 0x337804a0, 0x2e42dd7f, 0x15288acd, 0x16b34ae8, 0x2dd91d5a, 0x30e3c485, 0x0b899337,
+        0x355060cf, 0x0e3a377d, 0x1300eea2, 0x286ab910, 0x2bf17935, 0x109b2e87, 0x0da1f758, 0x36cba0ea,
+        0x220631a1, 0x196c6613, 0x0456bfcc, 0x3f3ce87e, 0x3ca7285b, 0x07cd7fe9, 0x1af7a636, 0x219df184,
+        0x1f44027c, 0x242e55ce, 0x39148c11, 0x027edba3, 0x01e51b86, 0x3a8f4c34, 0x27b595eb, 0x1cdfc259,
+        0x07e1bd59, 0x3c8beaeb, 0x21b13334, 0x1adb6486, 0x1940a4a3, 0x222af311, 0x3f102ace, 0x047a7d7c,
+        0x3aa38e84, 0x01c9d936, 0x1cf300e9, 0x2799575b, 0x2402977e, 0x1f68c0cc, 0x02521913, 0x39384ea1,
+        0x2df5dfea, 0x169f8858, 0x0ba55187, 0x30cf0635, 0x3354c610, 0x083e91a2, 0x1504487d, 0x2e6e1fcf,
+        0x10b7ec37, 0x2bddbb85, 0x36e7625a, 0x0d8d35e8, 0x0e16f5cd, 0x357ca27f, 0x28467ba0, 0x132c2c12,
+        0x1836543f, 0x235c038d, 0x3e66da52, 0x050c8de0, 0x06974dc5, 0x3dfd1a77, 0x20c7c3a8, 0x1bad941a,
+        0x257467e2, 0x1e1e3050, 0x0324e98f, 0x384ebe3d, 0x3bd57e18, 0x00bf29aa, 0x1d85f075, 0x26efa7c7,
+        0x3222368c, 0x0948613e, 0x1472b8e1, 0x2f18ef53, 0x2c832f76, 0x17e978c4, 0x0ad3a11b, 0x31b9f6a9,
+        0x0f600551, 0x340a52e3, 0x29308b3c, 0x125adc8e, 0x11c11cab, 0x2aab4b19, 0x379192c6, 0x0cfbc574,
+        0x3adecb95, 0x01b49c27, 0x1c8e45f8, 0x27e4124a, 0x247fd26f, 0x1f1585dd, 0x022f5c02, 0x39450bb0,
+        0x079cf848, 0x3cf6affa, 0x21cc7625, 0x1aa62197, 0x193de1b2, 0x2257b600, 0x3f6d6fdf, 0x0407386d,
+        0x10caa926, 0x2ba0fe94, 0x369a274b, 0x0df070f9, 0x0e6bb0dc, 0x3501e76e, 0x283b3eb1, 0x13516903,
+        0x2d889afb, 0x16e2cd49, 0x0bd81496, 0x30b24324, 0x33298301, 0x0843d4b3, 0x15790d6c, 0x2e135ade,
+        0x250922f3, 0x1e637541, 0x0359ac9e, 0x3833fb2c, 0x3ba83b09, 0x00c26cbb, 0x1df8b564, 0x2692e2d6,
+        0x184b112e, 0x2321469c, 0x3e1b9f43, 0x0571c8f1, 0x06ea08d4, 0x3d805f66, 0x20ba86b9, 0x1bd0d10b,
+        0x0f1d4040, 0x347717f2, 0x294dce2d, 0x1227999f, 0x11bc59ba, 0x2ad60e08, 0x37ecd7d7, 0x0c868065,
+        0x325f739d, 0x0935242f, 0x140ffdf0, 0x2f65aa42, 0x2cfe6a67, 0x17943dd5, 0x0aaee40a, 0x31c4b3b8,
+        0x2d1b71e1, 0x16712653, 0x0b4bff8c, 0x3021a83e, 0x33ba681b, 0x08d03fa9, 0x15eae676, 0x2e80b1c4,
+        0x1059423c, 0x2b33158e, 0x3609cc51, 0x0d639be3, 0x0ef85bc6, 0x35920c74, 0x28a8d5ab, 0x13c28219,
+        0x070f1352, 0x3c6544e0, 0x215f9d3f, 0x1a35ca8d, 0x19ae0aa8, 0x22c45d1a, 0x3ffe84c5, 0x0494d377,
+        0x3a4d208f, 0x0127773d, 0x1c1daee2, 0x2777f950, 0x24ec3975, 0x1f866ec7, 0x02bcb718, 0x39d6e0aa,
+        0x32cc9887, 0x09a6cf35, 0x149c16ea, 0x2ff64158, 0x2c6d817d, 0x1707d6cf, 0x0a3d0f10, 0x315758a2,
+        0x0f8eab5a, 0x34e4fce8, 0x29de2537, 0x12b47285, 0x112fb2a0, 0x2a45e512, 0x377f3ccd, 0x0c156b7f,
+        0x18d8fa34, 0x23b2ad86, 0x3e887459, 0x05e223eb, 0x0679e3ce, 0x3d13b47c, 0x20296da3, 0x1b433a11,
+        0x259ac9e9, 0x1ef09e5b, 0x03ca4784, 0x38a01036, 0x3b3bd013, 0x005187a1, 0x1d6b5e7e, 0x260109cc,
+        0x1024072d, 0x2b4e509f, 0x36748940, 0x0d1edef2, 0x0e851ed7, 0x35ef4965, 0x28d590ba, 0x13bfc708,
+        0x2d6634f0, 0x160c6342, 0x0b36ba9d, 0x305ced2f, 0x33c72d0a, 0x08ad7ab8, 0x1597a367, 0x2efdf4d5,
+        0x3a30659e, 0x015a322c, 0x1c60ebf3, 0x270abc41, 0x24917c64, 0x1ffb2bd6, 0x02c1f209, 0x39aba5bb,
+        0x07725643, 0x3c1801f1, 0x2122d82e, 0x1a488f9c, 0x19d34fb9, 0x22b9180b, 0x3f83c1d4, 0x04e99666,
+        0x0ff3ee4b, 0x3499b9f9, 0x29a36026, 0x12c93794, 0x1152f7b1, 0x2a38a003, 0x370279dc, 0x0c682e6e,
+        0x32b1dd96, 0x09db8a24, 0x14e153fb, 0x2f8b0449, 0x2c10c46c, 0x177a93de, 0x0a404a01, 0x312a1db3,
+        0x25e78cf8, 0x1e8ddb4a, 0x03b70295, 0x38dd5527, 0x3b469502, 0x002cc2b0, 0x1d161b6f, 0x267c4cdd,
+        0x18a5bf25, 0x23cfe897, 0x3ef53148, 0x059f66fa, 0x0604a6df, 0x3d6ef16d, 0x205428b2, 0x1b3e7f00,
+        0x0d537a9b, 0x36392d29, 0x2b03f4f6, 0x1069a344, 0x13f26361, 0x289834d3, 0x35a2ed0c, 0x0ec8babe,
+        0x30114946, 0x0b7b1ef4, 0x1641c72b, 0x2d2b9099, 0x2eb050bc, 0x15da070e, 0x08e0ded1, 0x338a8963,
+        0x27471828, 0x1c2d4f9a, 0x01179645, 0x3a7dc1f7, 0x39e601d2, 0x028c5660, 0x1fb68fbf, 0x24dcd80d,
+        0x1a052bf5, 0x216f7c47, 0x3c55a598, 0x073ff22a, 0x04a4320f, 0x3fce65bd, 0x22f4bc62, 0x199eebd0,
+        0x128493fd, 0x29eec44f, 0x34d41d90, 0x0fbe4a22, 0x0c258a07, 0x374fddb5, 0x2a75046a, 0x111f53d8,
+        0x2fc6a020, 0x14acf792, 0x09962e4d, 0x32fc79ff, 0x3167b9da, 0x0a0dee68, 0x173737b7, 0x2c5d6005,
+        0x3890f14e, 0x03faa6fc, 0x1ec07f23, 0x25aa2891, 0x2631e8b4, 0x1d5bbf06, 0x006166d9, 0x3b0b316b,
+        0x05d2c293, 0x3eb89521, 0x23824cfe, 0x18e81b4c, 0x1b73db69, 0x20198cdb, 0x3d235504, 0x064902b6,
+        0x306c0c57, 0x0b065be5, 0x163c823a, 0x2d56d588, 0x2ecd15ad, 0x15a7421f, 0x089d9bc0, 0x33f7cc72,
+        0x0d2e3f8a, 0x36446838, 0x2b7eb1e7, 0x1014e655, 0x138f2670, 0x28e571c2, 0x35dfa81d, 0x0eb5ffaf,
+        0x1a786ee4, 0x21123956, 0x3c28e089, 0x0742b73b, 0x04d9771e, 0x3fb320ac, 0x2289f973, 0x19e3aec1,
+        0x273a5d39, 0x1c500a8b, 0x016ad354, 0x3a0084e6, 0x399b44c3, 0x02f11371, 0x1fcbcaae, 0x24a19d1c,
+        0x2fbbe531, 0x14d1b283, 0x09eb6b5c, 0x32813cee, 0x311afccb, 0x0a70ab79, 0x174a72a6, 0x2c202514,
+        0x12f9d6ec, 0x2993815e, 0x34a95881, 0x0fc30f33, 0x0c58cf16, 0x373298a4, 0x2a08417b, 0x116216c9,
+        0x05af8782, 0x3ec5d030, 0x23ff09ef, 0x18955e5d, 0x1b0e9e78, 0x2064c9ca, 0x3d5e1015, 0x063447a7,
+        0x38edb45f, 0x0387e3ed, 0x1ebd3a32, 0x25d76d80, 0x264cada5, 0x1d26fa17, 0x001c23c8, 0x3b76747a,
+        0x27a9b623, 0x1cc3e191, 0x01f9384e, 0x3a936ffc, 0x3908afd9, 0x0262f86b, 0x1f5821b4, 0x24327606,
+        0x1aeb85fe, 0x2181d24c, 0x3cbb0b93, 0x07d15c21, 0x044a9c04, 0x3f20cbb6, 0x221a1269, 0x197045db,
+        0x0dbdd490, 0x36d78322, 0x2bed5afd, 0x10870d4f, 0x131ccd6a, 0x28769ad8, 0x354c4307, 0x0e2614b5,
+        0x30ffe74d, 0x0b95b0ff, 0x16af6920, 0x2dc53e92, 0x2e5efeb7, 0x1534a905, 0x080e70da, 0x33642768,
+        0x387e5f45, 0x031408f7, 0x1e2ed128, 0x2544869a, 0x26df46bf, 0x1db5110d, 0x008fc8d2, 0x3be59f60,
+        0x053c6c98, 0x3e563b2a, 0x236ce2f5, 0x1806b547, 0x1b9d7562, 0x20f722d0, 0x3dcdfb0f, 0x06a7acbd,
+        0x126a3df6, 0x29006a44, 0x343ab39b, 0x0f50e429, 0x0ccb240c, 0x37a173be, 0x2a9baa61, 0x11f1fdd3,
+        0x2f280e2b, 0x14425999, 0x09788046, 0x3212d7f4, 0x318917d1, 0x0ae34063, 0x17d999bc, 0x2cb3ce0e,
+        0x1a96c0ef, 0x21fc975d, 0x3cc64e82, 0x07ac1930, 0x0437d915, 0x3f5d8ea7, 0x22675778, 0x190d00ca,
+        0x27d4f332, 0x1cbea480, 0x01847d5f, 0x3aee2aed, 0x3975eac8, 0x021fbd7a, 0x1f2564a5, 0x244f3317,
+        0x3082a25c, 0x0be8f5ee, 0x16d22c31, 0x2db87b83, 0x2e23bba6, 0x1549ec14, 0x087335cb, 0x33196279,
+        0x0dc09181, 0x36aac633, 0x2b901fec, 0x10fa485e, 0x1361887b, 0x280bdfc9, 0x35310616, 0x0e5b51a4,
+        0x05412989, 0x3e2b7e3b, 0x2311a7e4, 0x187bf056, 0x1be03073, 0x208a67c1, 0x3db0be1e, 0x06dae9ac,
+        0x38031a54, 0x03694de6, 0x1e539439, 0x2539c38b, 0x26a203ae, 0x1dc8541c, 0x00f28dc3, 0x3b98da71,
+        0x2f554b3a, 0x143f1c88, 0x0905c557, 0x326f92e5, 0x31f452c0, 0x0a9e0572, 0x17a4dcad, 0x2cce8b1f,
+        0x121778e7, 0x297d2f55, 0x3447f68a, 0x0f2da138, 0x0cb6611d, 0x37dc36af, 0x2ae6ef70, 0x118cb8c2,
+        0x0ab2c7c2, 0x31d89070, 0x2ce249af, 0x17881e1d, 0x1413de38, 0x2f79898a, 0x32435055, 0x092907e7,
+        0x37f0f41f, 0x0c9aa3ad, 0x11a07a72, 0x2aca2dc0, 0x2951ede5, 0x123bba57, 0x0f016388, 0x346b343a,
+        0x20a6a571, 0x1bccf2c3, 0x06f62b1c, 0x3d9c7cae, 0x3e07bc8b, 0x056deb39, 0x185732e6, 0x233d6554,
+        0x1de496ac, 0x268ec11e, 0x3bb418c1, 0x00de4f73, 0x03458f56, 0x382fd8e4, 0x2515013b, 0x1e7f5689,
+        0x15652ea4, 0x2e0f7916, 0x3335a0c9, 0x085ff77b, 0x0bc4375e, 0x30ae60ec, 0x2d94b933, 0x16feee81,
+        0x28271d79, 0x134d4acb, 0x0e779314, 0x351dc4a6, 0x36860483, 0x0dec5331, 0x10d68aee, 0x2bbcdd5c,
+        0x3f714c17, 0x041b1ba5, 0x1921c27a, 0x224b95c8, 0x21d055ed, 0x1aba025f, 0x0780db80, 0x3cea8c32,
+        0x02337fca, 0x39592878, 0x2463f1a7, 0x1f09a615, 0x1c926630, 0x27f83182, 0x3ac2e85d, 0x01a8bfef,
+        0x378db10e, 0x0ce7e6bc, 0x11dd3f63, 0x2ab768d1, 0x292ca8f4, 0x1246ff46, 0x0f7c2699, 0x3416712b,
+        0x0acf82d3, 0x31a5d561, 0x2c9f0cbe, 0x17f55b0c, 0x146e9b29, 0x2f04cc9b, 0x323e1544, 0x095442f6,
+        0x1d99d3bd, 0x26f3840f, 0x3bc95dd0, 0x00a30a62, 0x0338ca47, 0x38529df5, 0x2568442a, 0x1e021398,
+        0x20dbe060, 0x1bb1b7d2, 0x068b6e0d, 0x3de139bf, 0x3e7af99a, 0x0510ae28, 0x182a77f7, 0x23402045,
+        0x285a5868, 0x13300fda, 0x0e0ad605, 0x356081b7, 0x36fb4192, 0x0d911620, 0x10abcfff, 0x2bc1984d,
+        0x15186bb5, 0x2e723c07, 0x3348e5d8, 0x0822b26a, 0x0bb9724f, 0x30d325fd, 0x2de9fc22, 0x1683ab90,
+        0x024e3adb, 0x39246d69, 0x241eb4b6, 0x1f74e304, 0x1cef2321, 0x27857493, 0x3abfad4c, 0x01d5fafe,
+        0x3f0c0906, 0x04665eb4, 0x195c876b, 0x2236d0d9, 0x21ad10fc, 0x1ac7474e, 0x07fd9e91, 0x3c97c923,
+        0x20480b7a, 0x1b225cc8, 0x06188517, 0x3d72d2a5, 0x3ee91280, 0x05834532, 0x18b99ced, 0x23d3cb5f,
+        0x1d0a38a7, 0x26606f15, 0x3b5ab6ca, 0x0030e178, 0x03ab215d, 0x38c176ef, 0x25fbaf30, 0x1e91f882,
+        0x0a5c69c9, 0x31363e7b, 0x2c0ce7a4, 0x1766b016, 0x14fd7033, 0x2f972781, 0x32adfe5e, 0x09c7a9ec,
+        0x371e5a14, 0x0c740da6, 0x114ed479, 0x2a2483cb, 0x29bf43ee, 0x12d5145c, 0x0fefcd83, 0x34859a31,
+        0x3f9fe21c, 0x04f5b5ae, 0x19cf6c71, 0x22a53bc3, 0x213efbe6, 0x1a54ac54, 0x076e758b, 0x3c042239,
+        0x02ddd1c1, 0x39b78673, 0x248d5fac, 0x1fe7081e, 0x1c7cc83b, 0x27169f89, 0x3a2c4656, 0x014611e4,
+        0x158b80af, 0x2ee1d71d, 0x33db0ec2, 0x08b15970, 0x0b2a9955, 0x3040cee7, 0x2d7a1738, 0x1610408a,
+        0x28c9b372, 0x13a3e4c0, 0x0e993d1f, 0x35f36aad, 0x3668aa88, 0x0d02fd3a, 0x103824e5, 0x2b527357,
+        0x1d777db6, 0x261d2a04, 0x3b27f3db, 0x004da469, 0x03d6644c, 0x38bc33fe, 0x2586ea21, 0x1eecbd93,
+        0x20354e6b, 0x1b5f19d9, 0x0665c006, 0x3d0f97b4, 0x3e945791, 0x05fe0023, 0x18c4d9fc, 0x23ae8e4e,
+        0x37631f05, 0x0c0948b7, 0x11339168, 0x2a59c6da, 0x29c206ff, 0x12a8514d, 0x0f928892, 0x34f8df20,
+        0x0a212cd8, 0x314b7b6a, 0x2c71a2b5, 0x171bf507, 0x14803522, 0x2fea6290, 0x32d0bb4f, 0x09baecfd,
+        0x02a094d0, 0x39cac362, 0x24f01abd, 0x1f9a4d0f, 0x1c018d2a, 0x276bda98, 0x3a510347, 0x013b54f5,
+        0x3fe2a70d, 0x0488f0bf, 0x19b22960, 0x22d87ed2, 0x2143bef7, 0x1a29e945, 0x0713309a, 0x3c796728,
+        0x28b4f663, 0x13dea1d1, 0x0ee4780e, 0x358e2fbc, 0x3615ef99, 0x0d7fb82b, 0x104561f4, 0x2b2f3646,
+        0x15f6c5be, 0x2e9c920c, 0x33a64bd3, 0x08cc1c61, 0x0b57dc44, 0x303d8bf6, 0x2d075229, 0x166d059b
+};
+
+/* Same as bech32_polymod_step(bech32_polymod_step(pre) ^ v1) ^ v2 */
+static uint32_t bech32_polymod_step2(uint32_t pre, uint8_t v1, uint8_t v2) {
+    return ((pre & 0xFFFFF) << 10) ^ bech32_gen2[pre >> 20] ^ ((uint32_t) v1 << 5) ^ v2;
 }
+#endif
 
 static const char* charset = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
 
@@ -47,8 +190,8 @@ static const int8_t charset_rev[128] = {
         1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
 };
 
-int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t data_len) {
-    uint32_t chk = 1;
+int bech32_hrp_checksum(uint32_t *chk, size_t *hrp_len, const char *hrp) {
+    uint32_t c = 1;
     size_t i = 0;
     while (hrp[i] != 0) {
         int ch = hrp[i];
@@ -57,21 +200,35 @@ int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t dat
         }
 
         if (ch >= 'A' && ch <= 'Z') return 0;
-        chk = bech32_polymod_step(chk) ^ (ch >> 5);
+        c = bech32_polymod_step(c) ^ (ch >> 5);
         ++i;
     }
-    if (i + 7 + data_len > 90) return 0;
-    chk = bech32_polymod_step(chk);
-    while (*hrp != 0) {
-        chk = bech32_polymod_step(chk) ^ (*hrp & 0x1f);
-        *(output++) = *(hrp++);
+    c = bech32_polymod_step(c);
+    for (i = 0; hrp[i] != 0; ++i) {
+        c = bech32_polymod_step(c) ^ (hrp[i] & 0x1f);
     }
-    *(output++) = '1';
-    for (i = 0; i < data_len; ++i) {
-        if (*data >> 5) return 0;
-        chk = bech32_polymod_step(chk) ^ (*data);
-        *(output++) = charset[*(data++)];
+    *chk = c;
+    *hrp_len = i;
+    return 1;
+}
+
+int bech32_encode_data(char *output, uint32_t chk, size_t hrp_len, const uint8_t *data, size_t data_len) {
+    size_t i = 0;
+    if (hrp_len + 7 + data_len > 90) return 0;
+#ifndef LEDGER_SPECIFIC
+    for (; i + 1 < data_len; i += 2) {
+        if ((data[i] | data[i + 1]) >> 5) return 0;
+        chk = bech32_polymod_step2(chk, data[i], data[i + 1]);
+        output[i] = charset[data[i]];
+        output[i + 1] = charset[data[i + 1]];
     }
+#endif
+    for (; i < data_len; ++i) {
+        if (data[i] >> 5) return 0;
+        chk = bech32_polymod_step(chk) ^ data[i];
+        output[i] = charset[data[i]];
+    }
+    output += data_len;
     for (i = 0; i < 6; ++i) {
         chk = bech32_polymod_step(chk);
     }
@@ -83,6 +240,18 @@ int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t dat
     return 1;
 }
 
+int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t data_len) {
+    uint32_t chk;
+    size_t hrp_len;
+    if (!bech32_hrp_checksum(&chk, &hrp_len, hrp)) {
+        return 0;
+    }
+    if (hrp_len + 7 + data_len > 90) return 0;
+    memcpy(output, hrp, hrp_len);
+    output[hrp_len] = '1';
+    return bech32_encode_data(output + hrp_len + 1, chk, hrp_len, data, data_len);
+}
+
 int bech32_decode(char* hrp, uint8_t *data, size_t *data_len, const char *input) {
     uint32_t chk = 1;
     size_t i;
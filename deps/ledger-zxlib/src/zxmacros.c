@@ -39,16 +39,87 @@ size_t asciify(char *utf8_in_ascii_out)
     return asciify_ext(utf8_in_ascii_out, utf8_in_ascii_out);
 }
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Copies the printable ASCII run at the start of src, control chars become
+// '.'. Stops at the terminator or at the first byte that is not ASCII and
+// returns the number of bytes copied. Blocks are loaded aligned, so reading
+// ahead of the terminator never crosses into another page
+static size_t ascii_span(const char *src, char *dst) {
+    size_t i = 0;
+    char c;
+
+#if defined(__SSE2__)
+    while (((uintptr_t) (src + i) & 15) != 0) {
+        c = src[i];
+        if (c == 0 || (c & 0x80)) {
+            return i;
+        }
+        dst[i++] = (c >= 32) ? c : '.';
+    }
+    const __m128i space = _mm_set1_epi8(32);
+    const __m128i dot = _mm_set1_epi8('.');
+    for (;; i += 16) {
+        const __m128i v = _mm_load_si128((const __m128i *) (src + i));
+        if (_mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()))) {
+            break;
+        }
+        const __m128i ctrl = _mm_cmplt_epi8(v, space);
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_or_si128(_mm_andnot_si128(ctrl, v), _mm_and_si128(ctrl, dot)));
+    }
+#else
+    while (((uintptr_t) (src + i) & 3) != 0) {
+        c = src[i];
+        if (c == 0 || (c & 0x80)) {
+            return i;
+        }
+        dst[i++] = (c >= 32) ? c : '.';
+    }
+    for (;; i += 4) {
+        uint32_t w;
+        memcpy(&w, src + i, sizeof(w));
+        // Any byte below 32, the terminator included, or above 127
+        if ((w | (w - 0x20202020u)) & 0x80808080u) {
+            break;
+        }
+        memcpy(dst + i, &w, sizeof(w));
+    }
+#endif
+
+    while ((c = src[i]) != 0 && !(c & 0x80)) {
+        dst[i++] = (c >= 32) ? c : '.';
+    }
+    return i;
+}
+
 size_t asciify_ext(const char *utf8_in, char *ascii_only_out) {
-    void *p = (void *) utf8_in;
+    const char *p = utf8_in;
     char *q = ascii_only_out;
 
-    // utf8valid returns zero on success
-    while (*((char *) p) && utf8valid(p) == 0) {
-        utf8_int32_t tmp_codepoint = 0;
-        p = utf8codepoint(p, &tmp_codepoint);
-        *q = (tmp_codepoint >= 32 && tmp_codepoint <= 0x7F)? tmp_codepoint : '.';
-        q++;
+    size_t n = ascii_span(p, q);
+    p += n;
+    q += n;
+
+    if (*p != 0) {
+        // An ASCII prefix is always valid, so the rest decides. utf8valid
+        // returns zero on success
+        if (utf8valid(p) != 0) {
+            *ascii_only_out = 0;
+            return 0;
+        }
+
+        while (*p != 0) {
+            utf8_int32_t tmp_codepoint = 0;
+            p = utf8codepoint(p, &tmp_codepoint);
+            *q++ = (tmp_codepoint >= 32 && tmp_codepoint <= 0x7F) ? tmp_codepoint : '.';
+
+            n = ascii_span(p, q);
+            p += n;
+            q += n;
+        }
     }
 
     // Terminate string
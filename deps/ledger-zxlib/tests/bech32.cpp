@@ -16,6 +16,11 @@
 #include <gmock/gmock.h>
 #include <zxmacros.h>
 #include <bech32.h>
+#include <segwit_addr.h>
+#include <bittools.h>
+#include <chrono>
+#include <random>
+#include <vector>
 
 namespace {
     TEST(BECH32, hex_to_address) {
@@ -33,4 +38,104 @@ namespace {
         std::cout << addr_out << std::endl;
         ASSERT_STREQ("zx1qyps2pcfpvx20dk22", addr_out);
     }
+
+    // Encoding as it was done before the fast paths: bit by bit conversion
+    // and the plain encoder
+    std::string reference_encode(const char *hrp, const uint8_t *data, size_t data_len) {
+        char out[256];
+        uint8_t tmp[256];
+        size_t tmp_size = 0;
+        out[0] = 0;
+        convert_bits(tmp, &tmp_size, 5, data, data_len, 8, 0);
+        bech32_encode(out, hrp, tmp, tmp_size);
+        return out;
+    }
+
+    TEST(BECH32, fast_path_matches_reference) {
+        std::mt19937 rng(1234);
+        char addr_out[256];
+        uint8_t data[128];
+
+        for (size_t len = 0; len <= 60; len++) {
+            for (int round = 0; round < 50; round++) {
+                for (size_t i = 0; i < len; i++) {
+                    data[i] = (uint8_t) rng();
+                }
+                bech32EncodeFromBytes(addr_out, "qrl", data, len);
+                ASSERT_EQ(reference_encode("qrl", data, len), addr_out) << "len " << len;
+            }
+        }
+    }
+
+    TEST(BECH32, encode_data_rejects_invalid) {
+        char out[128];
+        const uint8_t bad[] = {1, 2, 32, 4};
+        ASSERT_EQ(0, bech32_encode(out, "zx", bad, sizeof(bad)));
+        ASSERT_EQ(0, bech32_encode(out, "Zx", bad, 2));
+
+        const uint8_t long_data[84] = {0};
+        ASSERT_EQ(0, bech32_encode(out, "zx", long_data, sizeof(long_data)));
+        ASSERT_EQ(1, bech32_encode(out, "zx", long_data, sizeof(long_data) - 3));
+    }
+
+    TEST(BECH32, batch_matches_single) {
+        const size_t count = 100;
+        const size_t len = 39;
+        const size_t stride = 80;
+        std::mt19937 rng(42);
+        std::vector<uint8_t> data(count * len);
+        for (auto &b : data) {
+            b = (uint8_t) rng();
+        }
+
+        std::vector<char> out(count * stride);
+        ASSERT_EQ(count, bech32_encode_batch(out.data(), stride, "qrl", data.data(), len, count));
+
+        char addr_out[100];
+        for (size_t i = 0; i < count; i++) {
+            bech32EncodeFromBytes(addr_out, "qrl", data.data() + i * len, len);
+            ASSERT_STREQ(addr_out, out.data() + i * stride);
+        }
+    }
+
+    TEST(BECH32, batch_stops_when_stride_is_too_small) {
+        const uint8_t data[2 * 39] = {0};
+        char out[2 * 40];
+        ASSERT_EQ(0u, bech32_encode_batch(out, 40, "qrl", data, 39, 2));
+        ASSERT_EQ(0u, bech32_encode_batch(out, 40, "QRL", data, 1, 2));
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(BECH32, DISABLED_benchmark) {
+        const size_t count = 20000;
+        const size_t len = 39;
+        const size_t stride = 80;
+        std::mt19937 rng(7);
+        std::vector<uint8_t> data(count * len);
+        for (auto &b : data) {
+            b = (uint8_t) rng();
+        }
+        std::vector<char> out(count * stride);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            const std::string s = reference_encode("qrl", data.data() + i * len, len);
+            memcpy(out.data() + i * stride, s.c_str(), s.size() + 1);
+        }
+        const double t_ref = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            bech32EncodeFromBytes(out.data() + i * stride, "qrl", data.data() + i * len, len);
+        }
+        const double t_single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ASSERT_EQ(count, bech32_encode_batch(out.data(), stride, "qrl", data.data(), len, count));
+        const double t_batch = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "reference " << (size_t) (count / t_ref) << " addresses/s" << std::endl;
+        std::cout << "single    " << (size_t) (count / t_single) << " addresses/s" << std::endl;
+        std::cout << "batch     " << (size_t) (count / t_batch) << " addresses/s" << std::endl;
+    }
 }
@@ -16,6 +16,10 @@
 
 #include "gtest/gtest.h"
 #include "buffering.h"
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
 
 namespace {
 
@@ -234,4 +238,253 @@ namespace {
         auto num_bytes = buffering_append(big, sizeof(big));
         EXPECT_EQ(0, num_bytes) << "Appending outside the bounds of the buffer should return error";
     }
+
+    TEST(Buffering, RingWrapAround) {
+        uint8_t storage[10];
+        buffer_ring_t ring;
+        buffering_ring_init(&ring, storage, sizeof(storage));
+
+        const uint8_t first[] = {0, 1, 2, 3, 4, 5, 6};
+        EXPECT_EQ(7, buffering_ring_write(&ring, first, sizeof(first)));
+
+        uint8_t out[10];
+        EXPECT_EQ(5, buffering_ring_read(&ring, out, 5));
+        EXPECT_EQ(2, buffering_ring_used(&ring));
+
+        // Goes past the end of the storage
+        const uint8_t second[] = {7, 8, 9, 10, 11, 12};
+        EXPECT_EQ(6, buffering_ring_write(&ring, second, sizeof(second)));
+        EXPECT_EQ(8, buffering_ring_used(&ring));
+        EXPECT_EQ(2, buffering_ring_free(&ring));
+
+        uint16_t length;
+        const uint8_t *span = buffering_ring_read_span(&ring, &length);
+        EXPECT_EQ(5, length) << "First span should stop at the end of the storage";
+        EXPECT_EQ(5, span[0]);
+        buffering_ring_consume(&ring, length);
+
+        span = buffering_ring_read_span(&ring, &length);
+        EXPECT_EQ(3, length);
+        EXPECT_EQ(span, storage) << "Second span should start at the beginning of the storage";
+        EXPECT_EQ(10, span[0]);
+        EXPECT_EQ(12, span[2]);
+    }
+
+    TEST(Buffering, RingWriteDoesNotFit) {
+        uint8_t storage[16];
+        buffer_ring_t ring;
+        buffering_ring_init(&ring, storage, sizeof(storage));
+
+        uint8_t data[17] = {0};
+        EXPECT_EQ(0, buffering_ring_write(&ring, data, sizeof(data))) << "Writing more than the ring holds should fail";
+        EXPECT_EQ(0, buffering_ring_used(&ring));
+
+        EXPECT_EQ(16, buffering_ring_write(&ring, data, 16));
+        EXPECT_EQ(0, buffering_ring_write(&ring, data, 1)) << "Full ring should not accept data";
+
+        uint16_t length;
+        buffering_ring_write_span(&ring, &length);
+        EXPECT_EQ(0, length);
+    }
+
+    TEST(Buffering, RingMatchesQueue) {
+        uint8_t storage[97];
+        buffer_ring_t ring;
+        buffering_ring_init(&ring, storage, sizeof(storage));
+        std::deque<uint8_t> expected;
+        std::mt19937 rng(11);
+        uint8_t next = 0;
+
+        for (int step = 0; step < 20000; step++) {
+            const uint16_t n = rng() % 60;
+            switch (rng() % 4) {
+                case 0: {
+                    uint8_t data[60];
+                    for (int i = 0; i < n; i++) {
+                        data[i] = next++;
+                    }
+                    if (buffering_ring_write(&ring, data, n) == n) {
+                        expected.insert(expected.end(), data, data + n);
+                    } else {
+                        next -= n;
+                    }
+                    break;
+                }
+                case 1: {
+                    // Filled in place
+                    uint16_t length;
+                    uint8_t *span = buffering_ring_write_span(&ring, &length);
+                    const uint16_t k = n < length ? n : length;
+                    for (int i = 0; i < k; i++) {
+                        span[i] = next;
+                        expected.push_back(next++);
+                    }
+                    buffering_ring_commit(&ring, k);
+                    break;
+                }
+                case 2: {
+                    uint8_t out[60];
+                    const int read = buffering_ring_read(&ring, out, n);
+                    ASSERT_EQ(std::min<size_t>(n, expected.size()), (size_t) read);
+                    for (int i = 0; i < read; i++) {
+                        ASSERT_EQ(expected.front(), out[i]);
+                        expected.pop_front();
+                    }
+                    break;
+                }
+                default: {
+                    uint16_t length;
+                    const uint8_t *span = buffering_ring_read_span(&ring, &length);
+                    const uint16_t k = n < length ? n : length;
+                    for (int i = 0; i < k; i++) {
+                        ASSERT_EQ(expected.front(), span[i]);
+                        expected.pop_front();
+                    }
+                    buffering_ring_consume(&ring, k);
+                    break;
+                }
+            }
+            ASSERT_EQ(expected.size(), buffering_ring_used(&ring));
+        }
+    }
+
+    TEST(Buffering, FlushBatching) {
+        uint8_t ram_buffer[100];
+        uint8_t flash_buffer[1000];
+        memset(flash_buffer, 0xEE, sizeof(flash_buffer));
+
+        buffering_init(ram_buffer,
+                       sizeof(ram_buffer),
+                       flash_buffer,
+                       sizeof(flash_buffer));
+        buffering_set_flush_batching(1);
+
+        std::vector<uint8_t> expected;
+        std::mt19937 rng(12);
+        while (expected.size() < 700) {
+            uint8_t chunk[90];
+            const int n = 1 + rng() % sizeof(chunk);
+            for (int i = 0; i < n; i++) {
+                chunk[i] = (uint8_t) rng();
+            }
+            ASSERT_EQ(n, buffering_append(chunk, n));
+            expected.insert(expected.end(), chunk, chunk + n);
+        }
+
+        const uint16_t pos = buffering_get_flash_buffer()->pos;
+        ASSERT_EQ(expected.size(), pos);
+        const uint16_t written = pos - pos % BUFFERING_FLASH_PAGE;
+        EXPECT_EQ(0, memcmp(flash_buffer, expected.data(), written)) << "Whole pages should be in flash";
+        EXPECT_EQ(0xEE, flash_buffer[written]) << "The partial page should still be staged";
+
+        buffering_flush();
+        EXPECT_EQ(0, memcmp(flash_buffer, expected.data(), pos)) << "Flush should write the partial page";
+        EXPECT_EQ(0xEE, flash_buffer[pos]);
+    }
+
+    TEST(Buffering, FlushBatchingNeedsAPage) {
+        uint8_t ram_buffer[10];
+        uint8_t flash_buffer[1000];
+
+        buffering_init(ram_buffer,
+                       sizeof(ram_buffer),
+                       flash_buffer,
+                       sizeof(flash_buffer));
+        buffering_set_flush_batching(1);
+
+        uint8_t small[30];
+        memset(small, 7, sizeof(small));
+        EXPECT_EQ(30, buffering_append(small, sizeof(small)));
+        EXPECT_EQ(7, flash_buffer[29]) << "Without room to stage a page, flash is written directly";
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(Buffering, DISABLED_RingBenchmark) {
+        uint8_t storage[1024];
+        buffer_ring_t ring;
+        const size_t total = 64 * 1024 * 1024;
+        uint8_t packet[250];
+        for (size_t i = 0; i < sizeof(packet); i++) {
+            packet[i] = (uint8_t) i;
+        }
+
+        // The consumer copies out, then hashes
+        buffering_ring_init(&ring, storage, sizeof(storage));
+        uint32_t sum_copy = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < total;) {
+            while (buffering_ring_write(&ring, packet, sizeof(packet)) != 0) {}
+            uint8_t out[512];
+            int n;
+            while ((n = buffering_ring_read(&ring, out, sizeof(out))) > 0) {
+                for (int i = 0; i < n; i++) {
+                    sum_copy += out[i];
+                }
+                done += n;
+            }
+        }
+        const double t_copy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // The consumer hashes the spans in place
+        buffering_ring_init(&ring, storage, sizeof(storage));
+        uint32_t sum_span = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < total;) {
+            while (buffering_ring_write(&ring, packet, sizeof(packet)) != 0) {}
+            uint16_t n;
+            const uint8_t *span;
+            while ((span = buffering_ring_read_span(&ring, &n)), n > 0) {
+                for (int i = 0; i < n; i++) {
+                    sum_span += span[i];
+                }
+                buffering_ring_consume(&ring, n);
+                done += n;
+            }
+        }
+        const double t_span = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_EQ(sum_copy, sum_span);
+        const double mb = (double) total / 1e6;
+        std::cout << "ring read  " << mb / t_copy << " MB/s" << std::endl;
+        std::cout << "ring spans " << mb / t_span << " MB/s" << std::endl;
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(Buffering, DISABLED_FlushBatchingBenchmark) {
+        // Counts the flash pages written, which is what costs on the device
+        uint8_t ram_buffer[256];
+        uint8_t flash_buffer[4096];
+        uint8_t packet[250] = {0};
+        const int rounds = 2000;
+
+        for (int batching = 0; batching < 2; batching++) {
+            size_t pages = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++) {
+                buffering_init(ram_buffer, sizeof(ram_buffer), flash_buffer, sizeof(flash_buffer));
+                buffering_set_flush_batching((uint8_t) batching);
+                uint16_t before = 0;
+                for (int i = 0; i < 16; i++) {
+                    buffering_append(packet, sizeof(packet));
+                    const uint16_t pos = buffering_get_buffer()->pos;
+                    if (buffering_get_flash_buffer()->in_use) {
+                        const uint16_t done = batching ? pos - pos % BUFFERING_FLASH_PAGE : pos;
+                        if (done > before) {
+                            // Pages touched by the write, a partial page counts once per write
+                            pages += (done + BUFFERING_FLASH_PAGE - 1) / BUFFERING_FLASH_PAGE -
+                                     before / BUFFERING_FLASH_PAGE;
+                            before = done;
+                        }
+                    }
+                }
+                buffering_flush();
+                if (batching && before < buffering_get_buffer()->pos) {
+                    pages++;
+                }
+            }
+            const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << (batching ? "batched " : "direct  ") << (double) pages / rounds << " page writes per 4000 bytes, "
+                      << (double) (rounds * 16 * sizeof(packet)) / 1e6 / t << " MB/s" << std::endl;
+        }
+    }
 }
@@ -0,0 +1,157 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+#include <zxmacros.h>
+#include <fpformat.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+    // fpuint64_to_str as it was before fpformat, valid up to INT64_MAX
+    void reference_fpuint64_to_str(char *dst, const uint64_t value, uint8_t decimals) {
+        char buffer[30];
+
+        int64_to_str(buffer, 30, value);
+        size_t digits = strlen(buffer);
+
+        if (digits <= decimals) {
+            *dst++ = '0';
+            *dst++ = '.';
+            for (uint16_t i = 0; i < decimals - digits; i++, dst++)
+                *dst = '0';
+            strcpy(dst, buffer);
+        } else {
+            strcpy(dst, buffer);
+            const size_t shift = digits - decimals;
+            dst = dst + shift;
+            *dst++ = '.';
+
+            char *p = buffer + shift;
+            strcpy(dst, p);
+        }
+    }
+
+    std::vector<uint64_t> test_values() {
+        std::vector<uint64_t> values = {0, 1, 9, 10, 99, 100, 999999999, 1000000000, 1000000001,
+                                        99999999, 100000000, 100000001,
+                                        9999999999999999ULL, 10000000000000000ULL,
+                                        UINT32_MAX, (uint64_t) UINT32_MAX + 1, INT64_MAX};
+        uint64_t p = 1;
+        for (int i = 0; i < 19; i++, p *= 10) {
+            values.push_back(p - 1);
+            values.push_back(p);
+            values.push_back(p + 1);
+        }
+        std::mt19937_64 rng(3);
+        for (int i = 0; i < 20000; i++) {
+            // Spread over all magnitudes
+            values.push_back(rng() >> (rng() % 64) >> 1);
+        }
+        return values;
+    }
+
+    TEST(FPFORMAT, uint64_to_dec) {
+        char out[32];
+        char expected[32];
+        auto values = test_values();
+        values.push_back(UINT64_MAX);
+        values.push_back(UINT64_MAX - 1);
+        values.push_back((uint64_t) INT64_MAX + 1);
+        for (uint64_t v : values) {
+            snprintf(expected, sizeof(expected), "%" PRIu64, v);
+            ASSERT_EQ(strlen(expected), uint64_to_dec(out, v));
+            ASSERT_STREQ(expected, out);
+        }
+    }
+
+    TEST(FPFORMAT, matches_reference) {
+        char out[64];
+        char expected[64];
+        const uint8_t decimals[] = {0, 1, 5, 9, 18, 19, 20, 21, 30};
+        for (uint64_t v : test_values()) {
+            for (uint8_t d : decimals) {
+                reference_fpuint64_to_str(expected, v, d);
+                ASSERT_EQ(strlen(expected), fpuint64_format(out, v, d));
+                ASSERT_STREQ(expected, out) << v << " " << (int) d;
+            }
+        }
+    }
+
+    TEST(FPFORMAT, above_int64_max) {
+        char out[64];
+        fpuint64_to_str(out, UINT64_MAX, 9);
+        EXPECT_STREQ("18446744073.709551615", out);
+        fpuint64_to_str(out, UINT64_MAX, 0);
+        EXPECT_STREQ("18446744073709551615.", out);
+    }
+
+    TEST(FPFORMAT, batch) {
+        const std::vector<uint64_t> values = {0, 5, 1000000000, 123456789012345ULL, UINT64_MAX};
+        const size_t stride = 32;
+        std::vector<char> out(values.size() * stride);
+        fpuint64_format_batch(out.data(), stride, values.data(), values.size(), 9);
+
+        char expected[32];
+        for (size_t i = 0; i < values.size(); i++) {
+            fpuint64_format(expected, values[i], 9);
+            ASSERT_STREQ(expected, out.data() + i * stride);
+        }
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(FPFORMAT, DISABLED_benchmark) {
+        std::mt19937_64 rng(4);
+        std::vector<uint64_t> values(4096);
+        for (auto &v : values) {
+            // Quanta amounts, up to the 105M supply in shor
+            v = rng() % 105000000000000000ULL;
+        }
+        const size_t rounds = 100;
+        char out[64];
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            for (uint64_t v : values) {
+                reference_fpuint64_to_str(out, v, 9);
+                asm volatile("" : : "r"(out) : "memory");
+            }
+        }
+        const double t_ref = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            for (uint64_t v : values) {
+                fpuint64_format(out, v, 9);
+                asm volatile("" : : "r"(out) : "memory");
+            }
+        }
+        const double t_fast = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<char> batch(values.size() * 32);
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            fpuint64_format_batch(batch.data(), 32, values.data(), values.size(), 9);
+            asm volatile("" : : "r"(batch.data()) : "memory");
+        }
+        const double t_batch = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double n = (double) (values.size() * rounds);
+        std::cout << "reference " << (size_t) (n / t_ref) << " amounts/s" << std::endl;
+        std::cout << "fpformat  " << (size_t) (n / t_fast) << " amounts/s" << std::endl;
+        std::cout << "batch     " << (size_t) (n / t_batch) << " amounts/s" << std::endl;
+    }
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+#include <zxmacros.h>
+#include <hexutils.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> random_bytes(size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> v(count);
+        for (auto &b : v) {
+            b = (uint8_t) rng();
+        }
+        return v;
+    }
+
+    TEST(HEXUTILS, encode_all_values) {
+        uint8_t data[256];
+        for (int i = 0; i < 256; i++) {
+            data[i] = (uint8_t) i;
+        }
+        char out[513];
+        char expected[3];
+        ASSERT_EQ(512u, hex_encode(out, data, sizeof(data)));
+        for (int i = 0; i < 256; i++) {
+            snprintf(expected, sizeof(expected), "%02X", i);
+            ASSERT_EQ(expected[0], out[2 * i]);
+            ASSERT_EQ(expected[1], out[2 * i + 1]);
+        }
+        ASSERT_EQ(0, out[512]);
+    }
+
+    TEST(HEXUTILS, vector_matches_scalar) {
+        const auto data = random_bytes(100, 1);
+        char out[201];
+        char ref[201];
+        uint8_t back[100];
+        for (size_t len = 0; len <= data.size(); len++) {
+            memset(out, 1, sizeof(out));
+            ASSERT_EQ(2 * len, hex_encode(out, data.data(), len));
+            hex_encode_scalar(ref, data.data(), len);
+            ASSERT_STREQ(ref, out) << "len " << len;
+
+            ASSERT_EQ((int) len, hex_decode(back, out, 2 * len));
+            ASSERT_EQ(0, memcmp(back, data.data(), len)) << "len " << len;
+        }
+    }
+
+    TEST(HEXUTILS, decode_lower_case) {
+        uint8_t out[20];
+        const char *hex = "00ff10abcdefABCDEF0123456789aBcDeF0a0b0c";
+        ASSERT_EQ(20, hex_decode(out, hex, strlen(hex)));
+        const uint8_t expected[] = {0x00, 0xFF, 0x10, 0xAB, 0xCD, 0xEF, 0xAB, 0xCD, 0xEF, 0x01,
+                                    0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x0A, 0x0B, 0x0C};
+        ASSERT_EQ(0, memcmp(out, expected, sizeof(expected)));
+    }
+
+    TEST(HEXUTILS, decode_rejects_invalid) {
+        uint8_t out[64];
+        ASSERT_EQ(-1, hex_decode(out, "abc", 3));
+
+        // Every position, so both the vector blocks and the tail are covered
+        const char bad[] = {'g', 'G', '/', ':', '@', '`', ' ', 0, (char) 0x80, (char) 0xC1};
+        for (size_t pos = 0; pos < 80; pos++) {
+            for (char c : bad) {
+                char hex[81];
+                memset(hex, 'a', 80);
+                hex[80] = 0;
+                hex[pos] = c;
+                ASSERT_EQ(-1, hex_decode(out, hex, 80)) << "pos " << pos << " char " << (int) c;
+            }
+        }
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(HEXUTILS, DISABLED_benchmark) {
+        const size_t count = 39;
+        const size_t rounds = 200000;
+        const auto data = random_bytes(count * 16, 2);
+        char out[2 * count * 16 + 1];
+        uint8_t back[count * 16];
+
+        // The per-nibble loop array_to_hexstr used before
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            const char hexchars[] = "0123456789ABCDEF";
+            const uint8_t *src = data.data() + (r % 16) * count;
+            char *dst = out;
+            for (size_t i = 0; i < count; i++, src++) {
+                *dst++ = hexchars[*src >> 4];
+                *dst++ = hexchars[*src & 0x0F];
+            }
+            *dst = 0;
+            asm volatile("" : : "r"(out) : "memory");
+        }
+        const double t_nibble = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            hex_encode_scalar(out, data.data() + (r % 16) * count, count);
+            asm volatile("" : : "r"(out) : "memory");
+        }
+        const double t_scalar = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            hex_encode(out, data.data() + (r % 16) * count, count);
+            asm volatile("" : : "r"(out) : "memory");
+        }
+        const double t_vector = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        hex_encode(out, data.data(), data.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds / 16; r++) {
+            ASSERT_EQ((int) data.size(), hex_decode(back, out, 2 * data.size()));
+        }
+        const double t_decode = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double mb = (double) (count * rounds) / 1e6;
+        std::cout << "encode nibble " << mb / t_nibble << " MB/s" << std::endl;
+        std::cout << "encode table  " << mb / t_scalar << " MB/s" << std::endl;
+        std::cout << "encode vector " << mb / t_vector << " MB/s" << std::endl;
+        std::cout << "decode        " << mb / t_decode << " MB/s" << std::endl;
+    }
+}
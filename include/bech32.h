@@ -27,6 +27,16 @@ void bech32EncodeFromBytes(char *output,
                            const uint8_t *data,
                            size_t data_len);
 
+// encodes count inputs of data_len bytes each, stored back to back in data,
+// into output strings spaced output_stride bytes apart. The hrp is validated
+// and hashed once for the whole batch. Returns the number of strings encoded
+size_t bech32_encode_batch(char *output,
+                           size_t output_stride,
+                           const char *hrp,
+                           const uint8_t *data,
+                           size_t data_len,
+                           size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,11 @@
 #define _SEGWIT_ADDR_H_ 1
 
 #include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /** Encode a SegWit address
  *
@@ -80,6 +85,38 @@ int bech32_encode(
         size_t data_len
 );
 
+/** Compute the checksum state of a human readable part
+ *
+ *  Out: chk:     Checksum state after the hrp and its separator, to be passed
+ *                to bech32_encode_data.
+ *       hrp_len: Length of the hrp.
+ *  In: hrp :     Pointer to the null-terminated human readable part.
+ *  Returns 1 if successful.
+ */
+int bech32_hrp_checksum(
+        uint32_t *chk,
+        size_t *hrp_len,
+        const char *hrp
+);
+
+/** Encode the data part of a Bech32 string for a precomputed hrp checksum
+ *
+ *  Out: output:  Pointer to a buffer of size data_len + 7 that will be updated
+ *                to contain the null-terminated data part and checksum.
+ *  In: chk :     Checksum state from bech32_hrp_checksum.
+ *      hrp_len:  Length of the hrp, for the total length limit.
+ *      data :    Pointer to an array of 5-bit values.
+ *      data_len: Length of the data array.
+ *  Returns 1 if successful.
+ */
+int bech32_encode_data(
+        char *output,
+        uint32_t chk,
+        size_t hrp_len,
+        const uint8_t *data,
+        size_t data_len
+);
+
 /** Decode a Bech32 string
  *
  *  Out: hrp:      Pointer to a buffer of size strlen(input) - 6. Will be
@@ -98,4 +135,8 @@ int bech32_decode(
         const char *input
 );
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
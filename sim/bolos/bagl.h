@@ -0,0 +1,90 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+// Stand-in for the BOLOS bagl.h used by the host simulator
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define BAGL_NONE               0
+#define BAGL_BUTTON             1
+#define BAGL_LABEL              2
+#define BAGL_RECTANGLE          3
+#define BAGL_LINE               4
+#define BAGL_ICON               5
+#define BAGL_CIRCLE             6
+#define BAGL_LABELINE           7
+
+#define BAGL_FILL               1
+#define BAGL_STROKE_FLAG_ONESHOT 0x80
+
+#define BAGL_FONT_OPEN_SANS_EXTRABOLD_11px  8
+#define BAGL_FONT_OPEN_SANS_LIGHT_16px      9
+#define BAGL_FONT_OPEN_SANS_REGULAR_11px    10
+#define BAGL_FONT_ALIGNMENT_LEFT            0x0000
+#define BAGL_FONT_ALIGNMENT_CENTER          0x8000
+
+#define BAGL_GLYPH_ICON_CHECK   1
+#define BAGL_GLYPH_ICON_CROSS   2
+#define BAGL_GLYPH_ICON_LEFT    3
+#define BAGL_GLYPH_ICON_RIGHT   4
+
+typedef struct {
+    unsigned int type;
+    unsigned char userid;
+    short x;
+    short y;
+    unsigned short width;
+    unsigned short height;
+    unsigned char stroke;
+    unsigned char radius;
+    unsigned char fill;
+    unsigned int fgcolor;
+    unsigned int bgcolor;
+    unsigned short font_id;
+    unsigned char icon_id;
+} bagl_component_t;
+
+typedef struct bagl_element_e bagl_element_t;
+typedef const bagl_element_t *(*bagl_element_callback_t)(const bagl_element_t *e);
+
+struct bagl_element_e {
+    bagl_component_t component;
+    const char *text;
+    unsigned char touch_area_brim;
+    int overfgcolor;
+    int overbgcolor;
+    bagl_element_callback_t tap;
+    bagl_element_callback_t out;
+    bagl_element_callback_t over;
+};
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+    unsigned int bpp;
+    const unsigned int *colors;
+    const unsigned char *bitmap;
+} bagl_icon_details_t;
+
+unsigned int bagl_label_roundtrip_duration_ms(const bagl_element_t *e, unsigned int average_char_width);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,227 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/sha.h>
+
+#include "os.h"
+#include "cx.h"
+#include "os_io_seproxyhal.h"
+#include "fips202.h"
+#include "sim.h"
+#include "flash.h"
+
+void sha3_256_ledger(unsigned char *output, const unsigned char *input, unsigned long long inlen);
+void sha3_512_ledger(unsigned char *output, const unsigned char *input, unsigned long long inlen);
+
+#define CX_ALGO_SHA256      1
+#define CX_ALGO_SHA3        2
+#define CX_ALGO_SHA3_XOF    3
+
+unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+const bagl_icon_details_t C_icon_app = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_back = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_crossmark = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_dashboard = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_eye = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_key = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_refresh = {0, 0, 0, NULL, NULL};
+const bagl_icon_details_t C_icon_validate_14 = {0, 0, 0, NULL, NULL};
+
+/////////////////////////////////////////////
+// Exceptions
+
+static try_context_t *G_try_last_open_context = NULL;
+
+try_context_t *try_context_get(void) {
+    return G_try_last_open_context;
+}
+
+try_context_t *try_context_set(try_context_t *context) {
+    try_context_t *previous = G_try_last_open_context;
+    G_try_last_open_context = context;
+    return previous;
+}
+
+void os_longjmp(unsigned int exception) {
+    if (G_try_last_open_context == NULL) {
+        fprintf(stderr, "sim: uncaught exception 0x%04X\n", exception);
+        abort();
+    }
+    longjmp(G_try_last_open_context->jmp_buf, (int) exception);
+}
+
+/////////////////////////////////////////////
+// System
+
+void os_sched_exit(unsigned int exit_code) {
+    UNUSED(exit_code);
+    THROW(EXCEPTION_APPEXIT);
+}
+
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len) {
+    flash_write(dst_adr, src_adr, src_len);
+    if (src_adr == NULL) {
+        memset(dst_adr, 0, src_len);
+    } else {
+        memmove(dst_adr, src_adr, src_len);
+    }
+    sim_stats.nvm_writes++;
+    sim_stats.nvm_bytes += src_len;
+}
+
+void reset(void) {
+    THROW(EXCEPTION_IO_RESET);
+}
+
+void io_seproxyhal_init(void) {}
+
+void io_seproxyhal_general_status(void) {}
+
+unsigned int io_seproxyhal_spi_is_status_sent(void) {
+    return 1;
+}
+
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length) {
+    UNUSED(buffer);
+    UNUSED(length);
+}
+
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer, unsigned short maxlength, unsigned int flags) {
+    UNUSED(buffer);
+    UNUSED(maxlength);
+    UNUSED(flags);
+    return 0;
+}
+
+void io_seproxyhal_display_default(const bagl_element_t *element) {
+    UNUSED(element);
+}
+
+void USB_power(unsigned char enabled) {
+    UNUSED(enabled);
+}
+
+unsigned int bagl_label_roundtrip_duration_ms(const bagl_element_t *e, unsigned int average_char_width) {
+    UNUSED(e);
+    UNUSED(average_char_width);
+    return 0;
+}
+
+/////////////////////////////////////////////
+// Crypto
+
+int cx_sha256_init(cx_sha256_t *hash) {
+    hash->header.algo = CX_ALGO_SHA256;
+    SHA256_Init(&hash->ctx);
+    return CX_ALGO_SHA256;
+}
+
+int cx_sha3_init(cx_sha3_t *hash, unsigned int size) {
+    hash->header.algo = CX_ALGO_SHA3;
+    hash->size = size;
+    hash->output_size = size / 8;
+    hash->blen = 0;
+    return CX_ALGO_SHA3;
+}
+
+int cx_sha3_xof_init(cx_sha3_t *hash, unsigned int size, unsigned int out_length) {
+    hash->header.algo = CX_ALGO_SHA3_XOF;
+    hash->size = size;
+    hash->output_size = out_length;
+    hash->blen = 0;
+    return CX_ALGO_SHA3_XOF;
+}
+
+static void cx_sha3_final(cx_sha3_t *hash, unsigned char *out) {
+    if (hash->header.algo == CX_ALGO_SHA3_XOF) {
+        if (hash->size == 128) {
+            shake128(out, hash->output_size, hash->buffer, hash->blen);
+        } else {
+            shake256(out, hash->output_size, hash->buffer, hash->blen);
+        }
+        return;
+    }
+    if (hash->size == 512) {
+        sha3_512_ledger(out, hash->buffer, hash->blen);
+    } else {
+        sha3_256_ledger(out, hash->buffer, hash->blen);
+    }
+}
+
+int cx_hash(cx_hash_t *hash, int mode, const unsigned char *in, unsigned int len,
+            unsigned char *out, unsigned int out_len) {
+    UNUSED(out_len);
+
+    if (hash->algo == CX_ALGO_SHA256) {
+        cx_sha256_t *sha = (cx_sha256_t *) hash;
+        SHA256_Update(&sha->ctx, in, len);
+        if (mode & CX_LAST) {
+            SHA256_Final(out, &sha->ctx);
+            return 32;
+        }
+        return 0;
+    }
+
+    cx_sha3_t *sha3 = (cx_sha3_t *) hash;
+    if (sha3->blen + len > sizeof(sha3->buffer)) {
+        THROW(INVALID_PARAMETER);
+    }
+    memcpy(sha3->buffer + sha3->blen, in, len);
+    sha3->blen += len;
+    if (mode & CX_LAST) {
+        cx_sha3_final(sha3, out);
+        return (int) sha3->output_size;
+    }
+    return 0;
+}
+
+// Deterministic stand-in for the BIP32 derivation, SHA-512(seed || path)
+void os_perso_derive_node_bip32(unsigned int curve,
+                                const unsigned int *path,
+                                unsigned int path_length,
+                                unsigned char *private_key,
+                                unsigned char *chain) {
+    UNUSED(curve);
+    uint8_t digest[SHA512_DIGEST_LENGTH];
+    SHA512_CTX ctx;
+
+    SHA512_Init(&ctx);
+    SHA512_Update(&ctx, sim_seed, sizeof(sim_seed));
+    for (unsigned int i = 0; i < path_length; i++) {
+        const uint8_t be[4] = {
+            (uint8_t) (path[i] >> 24), (uint8_t) (path[i] >> 16),
+            (uint8_t) (path[i] >> 8), (uint8_t) path[i]
+        };
+        SHA512_Update(&ctx, be, sizeof(be));
+    }
+    SHA512_Final(digest, &ctx);
+
+    if (private_key != NULL) {
+        memcpy(private_key, digest, 32);
+    }
+    if (chain != NULL) {
+        memcpy(chain, digest + 32, 32);
+    }
+}
+
+int cx_hash_sha256(const unsigned char *in, unsigned int len, unsigned char *out, unsigned int out_len) {
+    UNUSED(out_len);
+    SHA256(in, len, out);
+    return 32;
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+// Stand-in for the BOLOS cx.h used by the host simulator, backed by OpenSSL
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <openssl/sha.h>
+
+#define CX_LAST                 (1 << 0)
+#define CX_CURVE_SECP256K1      0x21
+
+typedef struct {
+    int algo;
+} cx_hash_t;
+
+typedef struct {
+    cx_hash_t header;
+    SHA256_CTX ctx;
+} cx_sha256_t;
+
+// Input is buffered and hashed on CX_LAST, the app only hashes small inputs
+typedef struct {
+    cx_hash_t header;
+    unsigned int size;
+    unsigned int output_size;
+    unsigned int blen;
+    uint8_t buffer[256];
+} cx_sha3_t;
+
+int cx_sha256_init(cx_sha256_t *hash);
+int cx_sha3_init(cx_sha3_t *hash, unsigned int size);
+int cx_sha3_xof_init(cx_sha3_t *hash, unsigned int size, unsigned int out_length);
+int cx_hash(cx_hash_t *hash, int mode, const unsigned char *in, unsigned int len,
+            unsigned char *out, unsigned int out_len);
+int cx_hash_sha256(const unsigned char *in, unsigned int len, unsigned char *out, unsigned int out_len);
+
+#ifdef __cplusplus
+}
+#endif
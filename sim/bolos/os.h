@@ -0,0 +1,163 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+// Stand-in for the BOLOS os.h used by the host simulator
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "bolos_target.h"
+
+#ifndef UNUSED
+#define UNUSED(x) (void)x
+#endif
+#ifndef PRINTF
+#define PRINTF(...)
+#endif
+
+#define PIC(x) (x)
+
+#define os_memmove memmove
+#define os_memcpy memcpy
+#define os_memset memset
+#define os_memcmp memcmp
+
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len);
+
+void os_sched_exit(unsigned int exit_code);
+void reset(void);
+
+void os_perso_derive_node_bip32(unsigned int curve,
+                                const unsigned int *path,
+                                unsigned int path_length,
+                                unsigned char *private_key,
+                                unsigned char *chain);
+
+/////////////////////////////////////////////
+// Exceptions, same structure as the BOLOS macros
+
+typedef unsigned short exception_t;
+
+typedef struct try_context_s {
+    jmp_buf jmp_buf;
+    struct try_context_s *previous;
+    exception_t ex;
+} try_context_t;
+
+try_context_t *try_context_get(void);
+try_context_t *try_context_set(try_context_t *context);
+void os_longjmp(unsigned int exception) __attribute__((noreturn));
+
+#define EXCEPTION               1
+#define INVALID_PARAMETER       2
+#define EXCEPTION_OVERFLOW      3
+#define EXCEPTION_SECURITY      4
+#define INVALID_CRC             5
+#define INVALID_CHECKSUM        6
+#define INVALID_COUNTER         7
+#define NOT_SUPPORTED           8
+#define INVALID_STATE           9
+#define TIMEOUT                 10
+#define EXCEPTION_PIC           11
+#define EXCEPTION_APPEXIT       12
+#define EXCEPTION_IO_OVERFLOW   13
+#define EXCEPTION_IO_HEADER     14
+#define EXCEPTION_IO_STATE      15
+#define EXCEPTION_IO_RESET      16
+#define EXCEPTION_CXPORT        17
+#define EXCEPTION_SYSTEM        18
+#define NOT_ENOUGH_SPACE        19
+
+#define BEGIN_TRY_L(L) \
+    {                  \
+        try_context_t __try##L;
+
+#define TRY_L(L)                                                \
+        __try##L.ex = (exception_t) setjmp(__try##L.jmp_buf);   \
+        if (__try##L.ex == 0) {                                 \
+            __try##L.previous = try_context_set(&__try##L);
+
+#define CATCH_L(L, x)                                           \
+            goto __FINALLY##L;                                  \
+        } else if (__try##L.ex == (x)) {                        \
+            __try##L.ex = 0;                                    \
+            try_context_set(__try##L.previous);
+
+#define CATCH_OTHER_L(L, e)                                     \
+            goto __FINALLY##L;                                  \
+        } else {                                                \
+            exception_t e;                                      \
+            e = __try##L.ex;                                    \
+            __try##L.ex = 0;                                    \
+            try_context_set(__try##L.previous);
+
+#define CATCH_ALL_L(L)                                          \
+            goto __FINALLY##L;                                  \
+        } else {                                                \
+            __try##L.ex = 0;                                    \
+            try_context_set(__try##L.previous);
+
+#define FINALLY_L(L)                                            \
+            goto __FINALLY##L;                                  \
+        }                                                       \
+        __FINALLY##L:                                           \
+        if (try_context_get() == &__try##L) {                   \
+            try_context_set(__try##L.previous);                 \
+        }
+
+#define END_TRY_L(L)                                            \
+        if (__try##L.ex != 0) {                                 \
+            THROW_L(L, __try##L.ex);                            \
+        }                                                       \
+    }
+
+#define THROW_L(L, x) os_longjmp(x)
+
+#define BEGIN_TRY BEGIN_TRY_L(_)
+#define TRY TRY_L(_)
+#define CATCH(x) CATCH_L(_, x)
+#define CATCH_OTHER(e) CATCH_OTHER_L(_, e)
+#define CATCH_ALL CATCH_ALL_L(_)
+#define FINALLY FINALLY_L(_)
+#define END_TRY END_TRY_L(_)
+#define THROW(x) THROW_L(_, x)
+
+/////////////////////////////////////////////
+// IO
+
+#define IO_APDU_BUFFER_SIZE (5 + 255)
+extern unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+#define CHANNEL_APDU            0
+#define CHANNEL_KEYBOARD        1
+#define CHANNEL_SPI             2
+#define IO_RESET_AFTER_REPLIED  0x80
+#define IO_RECEIVE_DATA         0x40
+#define IO_RETURN_AFTER_TX      0x20
+#define IO_ASYNCH_REPLY         0x10
+#define IO_FINISHED             0x08
+#define IO_FLAGS                0xF8
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len);
+
+#ifdef __cplusplus
+}
+#endif
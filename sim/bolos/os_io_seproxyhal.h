@@ -0,0 +1,46 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+// Stand-in for the BOLOS os_io_seproxyhal.h used by the host simulator
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "os.h"
+#include "ux.h"
+
+#define SEPROXYHAL_TAG_BUTTON_PUSH_EVENT        0x05
+#define SEPROXYHAL_TAG_FINGER_EVENT             0x0C
+#define SEPROXYHAL_TAG_DISPLAY_PROCESSED_EVENT  0x0D
+#define SEPROXYHAL_TAG_TICKER_EVENT             0x0E
+
+extern unsigned char G_io_seproxyhal_spi_buffer[IO_SEPROXYHAL_BUFFER_SIZE_B];
+
+void io_seproxyhal_init(void);
+void io_seproxyhal_general_status(void);
+unsigned int io_seproxyhal_spi_is_status_sent(void);
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length);
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer, unsigned short maxlength, unsigned int flags);
+void io_seproxyhal_display_default(const bagl_element_t *element);
+void USB_power(unsigned char enabled);
+
+unsigned char io_event(unsigned char channel);
+unsigned short io_exchange_al(unsigned char channel, unsigned short tx_len);
+
+#ifdef __cplusplus
+}
+#endif
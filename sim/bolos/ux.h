@@ -0,0 +1,94 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+// Stand-in for the BOLOS ux.h used by the host simulator. Nothing is drawn, the
+// simulator only keeps track of what is on screen so that it can press buttons.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "bagl.h"
+
+#define BUTTON_LEFT             1
+#define BUTTON_RIGHT            2
+#define BUTTON_EVT_FAST         0x40000000
+#define BUTTON_EVT_RELEASED     0x80000000
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+typedef unsigned int (*button_push_callback_t)(unsigned int button_mask, unsigned int button_mask_counter);
+
+typedef struct ux_menu_entry_s ux_menu_entry_t;
+typedef void (*ux_menu_callback_t)(unsigned int userid);
+
+struct ux_menu_entry_s {
+    const ux_menu_entry_t *menu;
+    ux_menu_callback_t callback;
+    unsigned int userid;
+    const bagl_icon_details_t *icon;
+    const char *line1;
+    const char *line2;
+    char text_x;
+    char icon_x;
+};
+
+#define UX_MENU_END {NULL, NULL, 0, NULL, NULL, NULL, 0, 0}
+
+typedef const bagl_element_t *(*ux_menu_preprocessor_t)(const ux_menu_entry_t *entry, bagl_element_t *element);
+
+typedef struct {
+    const bagl_element_t *elements;
+    unsigned int elements_count;
+    button_push_callback_t button_push_handler;
+    const ux_menu_entry_t *menu_entries;
+    unsigned int menu_current;
+    unsigned int callback_interval_ms;
+} ux_state_t;
+
+extern const bagl_icon_details_t C_icon_app;
+extern const bagl_icon_details_t C_icon_back;
+extern const bagl_icon_details_t C_icon_crossmark;
+extern const bagl_icon_details_t C_icon_dashboard;
+extern const bagl_icon_details_t C_icon_eye;
+extern const bagl_icon_details_t C_icon_key;
+extern const bagl_icon_details_t C_icon_refresh;
+extern const bagl_icon_details_t C_icon_validate_14;
+
+void sim_ux_display(const bagl_element_t *elements, unsigned int count, button_push_callback_t handler);
+void sim_ux_menu_display(unsigned int current, const ux_menu_entry_t *entries);
+
+#define UX_INIT()
+#define UX_DISPLAY(elements_array, preprocessor) \
+    sim_ux_display(elements_array, sizeof(elements_array) / sizeof(elements_array[0]), elements_array##_button)
+#define UX_MENU_DISPLAY(current_entry, entries, preprocessor) \
+    sim_ux_menu_display(current_entry, entries)
+#define UX_DISPLAYED() 1
+#define UX_DISPLAY_NEXT_ELEMENT()
+#define UX_REDISPLAY()
+#define UX_ALLOWED 1
+#define UX_CALLBACK_SET_INTERVAL(ms)
+#define UX_FINGER_EVENT(seph_packet)
+#define UX_BUTTON_PUSH_EVENT(seph_packet)
+#define UX_DISPLAYED_EVENT()
+#define UX_TICKER_EVENT(seph_packet, callback)
+#define UX_DEFAULT_EVENT()
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#*******************************************************************************
+#*   (c) 2019 ZondaX GmbH
+#*
+#*  Licensed under the Apache License, Version 2.0 (the "License");
+#*  you may not use this file except in compliance with the License.
+#*  You may obtain a copy of the License at
+#*
+#*      http://www.apache.org/licenses/LICENSE-2.0
+#*
+#*  Unless required by applicable law or agreed to in writing, software
+#*  distributed under the License is distributed on an "AS IS" BASIS,
+#*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#*  See the License for the specific language governing permissions and
+#*  limitations under the License.
+#********************************************************************************
+# Bare metal Cortex-M toolchain (arm-none-eabi), newlib with semihosting so that
+# QEMU user mode can run the programs. GCCPATH points to the toolchain as in the Makefile.
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR arm)
+
+set(CORTEXM_CPU cortex-m3 CACHE STRING "Target core, cortex-m0 for the Armv6-M subset")
+
+set(CMAKE_C_COMPILER $ENV{GCCPATH}arm-none-eabi-gcc)
+set(CMAKE_NM $ENV{GCCPATH}arm-none-eabi-nm CACHE FILEPATH "")
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(CMAKE_C_FLAGS_INIT "-mcpu=${CORTEXM_CPU} -mthumb -ffunction-sections -fdata-sections")
+set(CMAKE_EXE_LINKER_FLAGS_INIT "--specs=rdimon.specs -Wl,--gc-sections")
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
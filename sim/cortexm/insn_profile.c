@@ -0,0 +1,106 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// QEMU TCG plugin counting executed guest instructions per translation block.
+//
+//   qemu-arm -cpu cortex-m3 -plugin ./libinsn_profile.so,out=sign.prof ./xmss_bench sign
+//
+// Writes one "<block address> <instructions> <executions>" line per block at exit,
+// insn_table.py maps the blocks to functions.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+typedef struct {
+    uint64_t key;           // address, and the length as blocks can be translated again shorter
+    uint64_t vaddr;
+    uint64_t insns;
+    uint64_t execs;
+} block_t;
+
+static GHashTable *blocks;
+static GMutex lock;
+static const char *out_path = "insns.prof";
+
+static void vcpu_tb_exec(unsigned int vcpu_index, void *udata) {
+    (void) vcpu_index;
+    // the bench is single threaded, user mode runs it on one vCPU
+    ((block_t *) udata)->execs++;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb) {
+    (void) id;
+    const uint64_t vaddr = qemu_plugin_tb_vaddr(tb);
+    const uint64_t insns = qemu_plugin_tb_n_insns(tb);
+    const uint64_t key = vaddr ^ (insns << 48u);
+
+    g_mutex_lock(&lock);
+    block_t *b = g_hash_table_lookup(blocks, &key);
+    if (b == NULL) {
+        b = g_new0(block_t, 1);
+        b->key = key;
+        b->vaddr = vaddr;
+        b->insns = insns;
+        g_hash_table_insert(blocks, &b->key, b);
+    }
+    g_mutex_unlock(&lock);
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec, QEMU_PLUGIN_CB_NO_REGS, b);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p) {
+    (void) id;
+    (void) p;
+    FILE *f = fopen(out_path, "w");
+    if (f == NULL) {
+        perror(out_path);
+        return;
+    }
+
+    GHashTableIter it;
+    gpointer value;
+    g_hash_table_iter_init(&it, blocks);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        const block_t *b = value;
+        if (b->execs > 0) {
+            fprintf(f, "%" PRIx64 " %" PRIu64 " %" PRIu64 "\n", b->vaddr, b->insns, b->execs);
+        }
+    }
+    fclose(f);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                                           int argc, char **argv) {
+    (void) info;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "out=", 4) == 0) {
+            out_path = g_strdup(argv[i] + 4);
+        } else {
+            fprintf(stderr, "insn_profile: unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    blocks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
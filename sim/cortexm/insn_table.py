@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# *******************************************************************************
+# *   (c) 2019 ZondaX GmbH
+# *
+# *  Licensed under the Apache License, Version 2.0 (the "License");
+# *  you may not use this file except in compliance with the License.
+# *  You may obtain a copy of the License at
+# *
+# *      http://www.apache.org/licenses/LICENSE-2.0
+# *
+# *  Unless required by applicable law or agreed to in writing, software
+# *  distributed under the License is distributed on an "AS IS" BASIS,
+# *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# *  See the License for the specific language governing permissions and
+# *  limitations under the License.
+# ********************************************************************************
+"""Per function instruction counts from insn_profile.c output.
+
+  insn_table.py --elf xmss_bench --nm arm-none-eabi-nm [--baseline none.prof] sign.prof leaf.prof
+
+Blocks are charged to the function holding their first instruction. With --baseline
+the counts of the setup-only run are subtracted, leaving the operation itself.
+"""
+
+import argparse
+import bisect
+import os
+import subprocess
+import sys
+
+
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, '-n', '-S', '--defined-only', elf],
+                         check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4 and parts[2] in 'tTwW':
+            # Thumb functions have the low bit set
+            syms.append((int(parts[0], 16) & ~1, int(parts[1], 16), parts[3]))
+    syms.sort()
+    return syms
+
+
+def load_profile(path, syms):
+    starts = [s[0] for s in syms]
+    counts = {}
+    with open(path) as f:
+        for line in f:
+            vaddr, insns, execs = line.split()
+            vaddr = int(vaddr, 16)
+            i = bisect.bisect_right(starts, vaddr) - 1
+            name = '[unknown]'
+            if i >= 0 and vaddr < syms[i][0] + max(syms[i][1], 1):
+                name = syms[i][2]
+            counts[name] = counts.get(name, 0) + int(insns) * int(execs)
+    return counts
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Per function instruction counts from QEMU block profiles')
+    ap.add_argument('--elf', required=True, help='profiled program')
+    ap.add_argument('--nm', default='nm', help='nm for --elf')
+    ap.add_argument('--baseline', help='profile of the setup-only run, subtracted')
+    ap.add_argument('--top', type=int, default=25, help='functions listed per profile')
+    ap.add_argument('profiles', nargs='+')
+    args = ap.parse_args()
+
+    syms = load_symbols(args.nm, args.elf)
+    base = load_profile(args.baseline, syms) if args.baseline else {}
+
+    for path in args.profiles:
+        counts = load_profile(path, syms)
+        for name, n in base.items():
+            counts[name] = counts.get(name, 0) - n
+        counts = {k: v for k, v in counts.items() if v != 0}
+        total = sum(counts.values())
+
+        print('%s: %d instructions' % (os.path.splitext(os.path.basename(path))[0], total))
+        print('%14s %7s  %s' % ('instructions', '%', 'function'))
+        for name, n in sorted(counts.items(), key=lambda kv: (-kv[1], kv[0]))[:args.top]:
+            print('%14d %6.2f%%  %s' % (n, 100.0 * n / total if total else 0.0, name))
+        print()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
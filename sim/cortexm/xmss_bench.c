@@ -0,0 +1,99 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// Runs one libxmss operation, to be profiled under QEMU (see insn_profile.c).
+//
+//   xmss_bench <none|sign|leaf|treehash> [sha2_256|shake128|shake256]
+//
+// "none" only does the setup shared by the others, its profile is the baseline.
+// The first bytes of the result are printed so host and target runs can be compared.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xmss.h"
+
+static xmss_sk_t sk;
+static uint8_t nodes[XMSS_NODES_BUFSIZE];
+static uint8_t wots_buffer[WOTS_LEN * WOTS_N];
+static xmss_signature_t sig;
+
+static void print_hex(const char *name, const uint8_t *data, size_t len) {
+    printf("%s ", name);
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+static void setup(uint8_t hash_func) {
+    uint8_t sk_seed[SZ_SKSEED];
+    for (uint8_t i = 0; i < SZ_SKSEED; i++) {
+        sk_seed[i] = i;
+    }
+    xmss_gen_keys_1_get_seeds(&sk, sk_seed, hash_func);
+
+    // Stand-in leaves, treehash and sign only read them
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < sizeof(nodes); i++) {
+        x = x * 1103515245u + 12345u;
+        nodes[i] = (uint8_t) (x >> 24);
+    }
+    shash_select(hash_func);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <none|sign|leaf|treehash> [sha2_256|shake128|shake256]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t hash_func = SHASH_FUNC_SHA2_256;
+    if (argc > 2) {
+        if (strcmp(argv[2], "shake128") == 0) {
+            hash_func = SHASH_FUNC_SHAKE128;
+        } else if (strcmp(argv[2], "shake256") == 0) {
+            hash_func = SHASH_FUNC_SHAKE256;
+        } else if (strcmp(argv[2], "sha2_256") != 0) {
+            fprintf(stderr, "unknown hash function: %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    setup(hash_func);
+
+    const char *op = argv[1];
+    if (strcmp(op, "none") == 0) {
+        print_hex("seeds", sk.seeds.raw, 16);
+    } else if (strcmp(op, "sign") == 0) {
+        const uint8_t msg[32] = {1, 2, 3, 4};
+        xmss_sign(&sig, msg, &sk, nodes, 5);
+        print_hex("sig", sig.wots_sig, 16);
+        print_hex("auth", sig.auth_path, 16);
+    } else if (strcmp(op, "leaf") == 0) {
+        uint8_t leaf[WOTS_N];
+        xmss_gen_keys_2_get_nodes(wots_buffer, leaf, &sk, 5);
+        print_hex("leaf", leaf, 16);
+    } else if (strcmp(op, "treehash") == 0) {
+        uint8_t root[WOTS_N];
+        uint8_t authpath[(XMSS_H + 1) * WOTS_N];
+        xmss_treehash(root, authpath, nodes, sk.pub_seed, 5);
+        print_hex("root", root, 16);
+    } else {
+        fprintf(stderr, "unknown operation: %s\n", op);
+        return 1;
+    }
+    return 0;
+}
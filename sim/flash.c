@@ -0,0 +1,230 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash.h"
+
+typedef struct {
+    const char *name;
+    const uint8_t *base;
+    uint32_t size;
+    uint32_t *erases;                       // per page
+    uint64_t *bytes;                        // per page
+} flash_region_t;
+
+static flash_region_t regions[FLASH_MAX_REGIONS];
+static uint8_t num_regions;
+
+static flash_op_t ops[FLASH_MAX_OPS];
+static uint8_t num_ops;
+static flash_op_t *cur_op;
+
+static uint32_t flash_region_pages(const flash_region_t *r) {
+    return (r->size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+}
+
+void flash_init(void) {
+    for (uint8_t i = 0; i < num_regions; i++) {
+        free(regions[i].erases);
+        free(regions[i].bytes);
+    }
+    memset(regions, 0, sizeof(regions));
+    num_regions = 0;
+    flash_reset_counters();
+}
+
+void flash_add_region(const char *name, const void *base, uint32_t size) {
+    if (num_regions == FLASH_MAX_REGIONS) {
+        return;
+    }
+    flash_region_t *r = &regions[num_regions++];
+    r->name = name;
+    r->base = base;
+    r->size = size;
+    r->erases = calloc(flash_region_pages(r), sizeof(uint32_t));
+    r->bytes = calloc(flash_region_pages(r), sizeof(uint64_t));
+}
+
+void flash_reset_counters(void) {
+    for (uint8_t i = 0; i < num_regions; i++) {
+        memset(regions[i].erases, 0, flash_region_pages(&regions[i]) * sizeof(uint32_t));
+        memset(regions[i].bytes, 0, flash_region_pages(&regions[i]) * sizeof(uint64_t));
+    }
+    memset(ops, 0, sizeof(ops));
+    num_ops = 0;
+    cur_op = NULL;
+    flash_set_op("other");
+}
+
+static flash_op_t *flash_find_op(const char *name) {
+    for (uint8_t i = 0; i < num_ops; i++) {
+        if (strcmp(ops[i].name, name) == 0) {
+            return &ops[i];
+        }
+    }
+    return NULL;
+}
+
+void flash_set_op(const char *name) {
+    flash_op_t *op = flash_find_op(name);
+    if (op == NULL) {
+        if (num_ops == FLASH_MAX_OPS) {
+            return;
+        }
+        op = &ops[num_ops++];
+        op->name = name;
+    }
+    op->calls++;
+    cur_op = op;
+}
+
+const flash_op_t *flash_get_op(const char *name) {
+    return flash_find_op(name);
+}
+
+uint64_t flash_estimated_us(const flash_op_t *op) {
+    return op->pages * (FLASH_ERASE_US + FLASH_PROGRAM_US);
+}
+
+void flash_write(const void *dst, const void *src, uint32_t len) {
+    const uint8_t *p = dst;
+    flash_region_t *r = NULL;
+
+    for (uint8_t i = 0; i < num_regions; i++) {
+        if (p >= regions[i].base && p + len <= regions[i].base + regions[i].size) {
+            r = &regions[i];
+            break;
+        }
+    }
+    if (r == NULL || len == 0) {
+        return;
+    }
+
+    const uint32_t offset = (uint32_t) (p - r->base);
+    const uint32_t first = offset / FLASH_PAGE_SIZE;
+    const uint32_t last = (offset + len - 1) / FLASH_PAGE_SIZE;
+
+    for (uint32_t page = first; page <= last; page++) {
+        const uint32_t start = page * FLASH_PAGE_SIZE > offset ? page * FLASH_PAGE_SIZE : offset;
+        const uint32_t end = (page + 1) * FLASH_PAGE_SIZE < offset + len ? (page + 1) * FLASH_PAGE_SIZE : offset + len;
+        r->erases[page]++;
+        r->bytes[page] += end - start;
+    }
+
+    cur_op->writes++;
+    cur_op->bytes += len;
+    cur_op->pages += last - first + 1;
+
+    // NULL clears the range
+    for (uint32_t i = 0; i < len; i++) {
+        const uint8_t v = src != NULL ? ((const uint8_t *) src)[i] : 0;
+        if (p[i] == v) {
+            cur_op->unchanged++;
+        }
+    }
+}
+
+void flash_print_summary(FILE *f) {
+    fprintf(f, "%-12s %8s %8s %10s %10s %8s %8s %12s\n",
+            "operation", "calls", "writes", "bytes", "unchanged", "pages", "ampl", "est ms/call");
+
+    uint64_t pages = 0;
+    for (uint8_t i = 0; i < num_ops; i++) {
+        const flash_op_t *op = &ops[i];
+        if (op->writes == 0) {
+            continue;
+        }
+        pages += op->pages;
+        // Write amplification: bytes programmed per byte requested
+        fprintf(f, "%-12s %8llu %8llu %10llu %10llu %8llu %8.1f %12.1f\n", op->name,
+                (unsigned long long) op->calls,
+                (unsigned long long) op->writes,
+                (unsigned long long) op->bytes,
+                (unsigned long long) op->unchanged,
+                (unsigned long long) op->pages,
+                (double) (op->pages * FLASH_PAGE_SIZE) / (double) op->bytes,
+                (double) flash_estimated_us(op) / 1e3 / (double) op->calls);
+    }
+
+    uint32_t hottest = 0;
+    for (uint8_t i = 0; i < num_regions; i++) {
+        for (uint32_t page = 0; page < flash_region_pages(&regions[i]); page++) {
+            if (regions[i].erases[page] > hottest) {
+                hottest = regions[i].erases[page];
+            }
+        }
+    }
+    fprintf(f, "%llu page erases, hottest page %u\n", (unsigned long long) pages, hottest);
+
+    // Signing wear only, keygen is paid once per tree
+    const flash_op_t *sign = flash_find_op("sign");
+    const flash_op_t *chunks = flash_find_op("sign chunks");
+    if (sign != NULL && sign->calls > 0) {
+        const uint64_t sign_pages = sign->pages + (chunks != NULL ? chunks->pages : 0);
+        fprintf(f, "per 1000 signatures: %.0f page erases, %.1f ms programming\n",
+                (double) sign_pages * 1000.0 / (double) sign->calls,
+                (double) sign_pages * (FLASH_ERASE_US + FLASH_PROGRAM_US) / (double) sign->calls);
+    }
+}
+
+void flash_print_heatmap(FILE *f) {
+    static const char ramp[] = " .:-=+*#%@";
+    const uint32_t row = 64;
+
+    for (uint8_t i = 0; i < num_regions; i++) {
+        const flash_region_t *r = &regions[i];
+        const uint32_t pages = flash_region_pages(r);
+
+        uint32_t max = 0;
+        for (uint32_t page = 0; page < pages; page++) {
+            if (r->erases[page] > max) {
+                max = r->erases[page];
+            }
+        }
+
+        fprintf(f, "%s: %u pages of %u bytes, max %u erases, '%s' from 0 to max\n",
+                r->name, pages, FLASH_PAGE_SIZE, max, ramp);
+        for (uint32_t page = 0; page < pages; page += row) {
+            fprintf(f, "%6u |", page * FLASH_PAGE_SIZE);
+            for (uint32_t j = page; j < page + row && j < pages; j++) {
+                uint32_t level = 0;
+                if (r->erases[j] > 0) {
+                    level = 1 + (uint32_t) ((uint64_t) (r->erases[j] - 1) * (sizeof(ramp) - 3) / (max > 1 ? max - 1 : 1));
+                }
+                fputc(ramp[level], f);
+            }
+            fputs("|\n", f);
+        }
+    }
+}
+
+int flash_write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+
+    fputs("region,page,offset,erases,bytes\n", f);
+    for (uint8_t i = 0; i < num_regions; i++) {
+        const flash_region_t *r = &regions[i];
+        for (uint32_t page = 0; page < flash_region_pages(r); page++) {
+            fprintf(f, "%s,%u,%u,%u,%llu\n", r->name, page, page * FLASH_PAGE_SIZE,
+                    r->erases[page], (unsigned long long) r->bytes[page]);
+        }
+    }
+    return fclose(f);
+}
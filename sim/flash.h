@@ -0,0 +1,67 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// Flash model for the simulated NVRAM. Every nvm_write erases and programs the
+// pages it touches; the model counts them per page and per operation (keygen,
+// sign, setidx, ...) and estimates how long programming took.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define FLASH_PAGE_SIZE         64          // same as NV_ALIGN
+#define FLASH_MAX_REGIONS       4
+#define FLASH_MAX_OPS           16
+
+// Rough per page figures, only meant to compare layouts and operations
+#define FLASH_ERASE_US          2000
+#define FLASH_PROGRAM_US        1000
+
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    uint64_t writes;                        // nvm_write calls
+    uint64_t bytes;                         // bytes requested
+    uint64_t unchanged;                     // bytes that already held the value written
+    uint64_t pages;                         // pages erased and programmed
+} flash_op_t;
+
+void flash_init(void);
+void flash_add_region(const char *name, const void *base, uint32_t size);
+
+/// Clears every counter, keeps the regions
+void flash_reset_counters(void);
+
+/// Following writes are accounted to this operation
+void flash_set_op(const char *name);
+
+/// Called before the data is copied
+void flash_write(const void *dst, const void *src, uint32_t len);
+
+const flash_op_t *flash_get_op(const char *name);
+uint64_t flash_estimated_us(const flash_op_t *op);
+
+void flash_print_summary(FILE *f);
+void flash_print_heatmap(FILE *f);
+int flash_write_csv(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
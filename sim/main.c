@@ -0,0 +1,196 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// Host simulator of the QRL app. Reads one hex APDU per line from stdin and
+// prints the reply, the status word and the time the app took to answer.
+//
+//   qrl_sim [--seed <64 hex chars>] [--keygen] [--reject] [--record <trace>] [--spans <json>]
+//           [--flash] [--flash-csv <csv>] [--load <image>] [--save <image>] [--listen <port>] < apdus.txt
+//
+// "@select <entry>" lines pick a menu entry, e.g. "@select Switch Tree".
+// With --listen APDUs come from a TCP client instead of stdin.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "os.h"
+#include "trace.h"
+#include "spans.h"
+#include "flash.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--seed <64 hex chars>] [--keygen] [--reject] [--record <trace>] [--spans <json>] [--flash] [--flash-csv <csv>]\n"
+                    "       [--load <image>] [--save <image>] [--listen <port>]\n", name);
+}
+
+int main(int argc, char **argv) {
+    uint8_t seed[SIM_SEED_SIZE] = {0};
+    int keygen = 0;
+    int approve = 1;
+    FILE *record = NULL;
+    const char *spans = NULL;
+    int flash = 0;
+    const char *flash_csv = NULL;
+    const char *load = NULL;
+    const char *save = NULL;
+    int listen_port = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            if (trace_hex_decode(argv[++i], seed, sizeof(seed)) != sizeof(seed)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--keygen") == 0) {
+            keygen = 1;
+        } else if (strcmp(argv[i], "--reject") == 0) {
+            approve = 0;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = fopen(argv[++i], "w");
+            if (record == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--spans") == 0 && i + 1 < argc) {
+            spans = argv[++i];
+        } else if (strcmp(argv[i], "--flash") == 0) {
+            flash = 1;
+        } else if (strcmp(argv[i], "--flash-csv") == 0 && i + 1 < argc) {
+            flash_csv = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save = argv[++i];
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listen_port = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (load != NULL) {
+        if (sim_snapshot_load(load) != 0) {
+            fprintf(stderr, "cannot load %s\n", load);
+            return 1;
+        }
+    } else {
+        sim_init(seed);
+    }
+    sim_set_approve((uint8_t) approve);
+
+    if (record != NULL) {
+        // A trace recorded on a loaded image replays with `qrl_replay --load`
+        trace_write_header(record, sim_seed, (uint8_t) keygen);
+    }
+
+    if (keygen) {
+        const uint64_t start = sim_now_ns();
+        if (!sim_ux_select("Init Tree")) {
+            fprintf(stderr, "keygen is not available\n");
+            return 1;
+        }
+        fprintf(stderr, "# keygen %.3f ms\n", (double) (sim_now_ns() - start) / 1e6);
+    }
+
+    if (listen_port > 0) {
+        if (sim_serve_tcp((uint16_t) listen_port) != 0) {
+            perror("listen");
+        }
+        return 1;
+    }
+
+    char line[2 * IO_APDU_BUFFER_SIZE + 64];
+    uint8_t apdu[IO_APDU_BUFFER_SIZE];
+    uint8_t resp[IO_APDU_BUFFER_SIZE];
+    uint64_t total_ns = 0;
+    uint64_t count = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        if (strncmp(line, "@select ", 8) == 0) {
+            line[strcspn(line, "\r\n")] = 0;
+            if (!sim_ux_select(line + 8)) {
+                fprintf(stderr, "no menu entry: %s\n", line + 8);
+            } else if (record != NULL) {
+                trace_write_select(record, line + 8);
+            }
+            continue;
+        }
+
+        const int len = trace_hex_decode(line, apdu, sizeof(apdu));
+        if (len <= 0) {
+            fprintf(stderr, "invalid apdu: %s", line);
+            continue;
+        }
+
+        uint16_t resp_len = 0;
+        const uint64_t start = sim_now_ns();
+        const uint16_t sw = sim_exchange(apdu, (uint16_t) len, resp, &resp_len);
+        const uint64_t elapsed = sim_now_ns() - start;
+        total_ns += elapsed;
+        count++;
+
+        if (record != NULL) {
+            trace_write_exchange(record, apdu, (uint16_t) len, resp, resp_len);
+        }
+
+        for (int i = 0; i + 2 < resp_len; i++) {
+            printf("%02x", resp[i]);
+        }
+        printf(" %04X %.1f us\n", sw, (double) elapsed / 1e3);
+    }
+
+    if (count > 0) {
+        fprintf(stderr, "# %llu apdus, %.3f ms, %.1f apdus/s\n",
+                (unsigned long long) count, (double) total_ns / 1e6,
+                (double) count * 1e9 / (double) total_ns);
+    }
+    fprintf(stderr, "# nvm %llu writes, %llu bytes, %llu screens, %llu buttons\n",
+            (unsigned long long) sim_stats.nvm_writes, (unsigned long long) sim_stats.nvm_bytes,
+            (unsigned long long) sim_stats.screens, (unsigned long long) sim_stats.buttons);
+
+    if (record != NULL) {
+        fclose(record);
+    }
+    if (save != NULL && sim_snapshot_save(save) != 0) {
+        perror(save);
+        return 1;
+    }
+    if (flash) {
+        flash_print_summary(stderr);
+        flash_print_heatmap(stderr);
+    }
+    if (flash_csv != NULL && flash_write_csv(flash_csv) != 0) {
+        perror(flash_csv);
+        return 1;
+    }
+    if (spans != NULL) {
+#ifdef XMSS_SPANS
+        if (spans_flush(spans) != 0) {
+            perror(spans);
+            return 1;
+        }
+#else
+        fprintf(stderr, "built without spans, configure with -DSIM_SPANS=ON\n");
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// Replays an APDU trace against simulated devices and reports per INS latency
+// histograms, bytes moved and round trips.
+//
+//   qrl_replay <trace> [--repeat <n>] [--concurrency <n>] [--check] [--flash]
+//              [--load <image>] [--reset]
+//
+// The device is set up once, from the trace header or from an NVRAM image, and
+// concurrent devices are forked from it with their NVRAM shared copy-on-write.
+// Repeats run on the same device, so state carried by the trace (e.g. the xmss
+// index) keeps moving forward and only the first pass is checked, unless
+// --reset puts the initial NVRAM back before every pass.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "trace.h"
+#include "flash.h"
+
+static uint16_t sim_transport(void *user,
+                              const uint8_t *cmd, uint16_t cmd_len,
+                              uint8_t *resp, uint16_t *resp_len) {
+    (void) user;
+    return sim_exchange(cmd, cmd_len, resp, resp_len);
+}
+
+static uint8_t sim_select(void *user, const char *line1) {
+    (void) user;
+    return sim_ux_select(line1);
+}
+
+static int setup_device(const trace_t *t, const char *image) {
+    if (image != NULL) {
+        return sim_snapshot_load(image);
+    }
+
+    sim_init(t->seed);
+    if (t->keygen && !sim_ux_select("Init Tree")) {
+        fprintf(stderr, "keygen is not available\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void run_device(const trace_t *t, unsigned int repeat, uint8_t check,
+                       const sim_snapshot_t *initial, trace_stats_t *stats) {
+    const uint64_t start = sim_now_ns();
+    for (unsigned int r = 0; r < repeat; r++) {
+        if (initial != NULL && r > 0) {
+            sim_snapshot_restore(initial);
+        }
+        trace_replay(t, sim_transport, sim_select, NULL, check && (r == 0 || initial != NULL), stats);
+    }
+    stats->replay_ns = sim_now_ns() - start;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        const ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        const ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s <trace> [--repeat <n>] [--concurrency <n>] [--check] [--flash]\n"
+                    "       [--load <image>] [--reset]\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    unsigned int repeat = 1;
+    unsigned int concurrency = 1;
+    uint8_t check = 0;
+    uint8_t flash = 0;
+    uint8_t reset = 0;
+    const char *image = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = (unsigned int) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            concurrency = (unsigned int) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = 1;
+        } else if (strcmp(argv[i], "--flash") == 0) {
+            flash = 1;
+        } else if (strcmp(argv[i], "--reset") == 0) {
+            reset = 1;
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            image = argv[++i];
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (path == NULL || repeat == 0 || concurrency == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    trace_t t;
+    const int err = trace_load(&t, f);
+    fclose(f);
+    if (err != 0) {
+        return 1;
+    }
+
+    trace_stats_t *total = calloc(1, sizeof(trace_stats_t));
+    trace_stats_t *stats = calloc(1, sizeof(trace_stats_t));
+    const uint64_t start = sim_now_ns();
+
+    if (setup_device(&t, image) != 0) {
+        fprintf(stderr, "device setup failed\n");
+        return 1;
+    }
+    sim_snapshot_t *initial = reset ? sim_snapshot_take() : NULL;
+
+    if (concurrency == 1) {
+        run_device(&t, repeat, check, initial, total);
+    } else {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+
+        for (unsigned int d = 0; d < concurrency; d++) {
+            const int pid = sim_fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                run_device(&t, repeat, check, initial, stats);
+                _exit(write_all(fds[1], stats, sizeof(*stats)) == 0 ? 0 : 1);
+            }
+        }
+        close(fds[1]);
+
+        for (unsigned int d = 0; d < concurrency; d++) {
+            if (read_all(fds[0], stats, sizeof(*stats)) != 0) {
+                fprintf(stderr, "device %u did not report\n", d);
+                break;
+            }
+            trace_stats_merge(total, stats);
+        }
+        close(fds[0]);
+        while (wait(NULL) > 0) {}
+    }
+
+    const uint64_t wall = sim_now_ns() - start;
+    printf("%u device(s), %u pass(es), %u commands per pass\n", concurrency, repeat, t.count);
+    trace_stats_print(stdout, total, wall);
+
+    // Only the local device can be inspected
+    if (flash && concurrency == 1) {
+        flash_print_summary(stdout);
+        flash_print_heatmap(stdout);
+    }
+
+    const int failed = total->mismatches != 0 || total->no_reply != 0;
+    sim_snapshot_free(initial);
+    free(stats);
+    free(total);
+    trace_free(&t);
+    return failed;
+}
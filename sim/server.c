@@ -0,0 +1,118 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+// APDU server with the framing used by speculos, so host tools can talk to
+// the simulator as they would to an emulated device:
+//
+//   request     [length, 4 bytes BE] [apdu]
+//   reply       [length without the status word, 4 bytes BE] [data] [sw]
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "sim.h"
+#include "os.h"
+
+static int read_all(int fd, uint8_t *buf, size_t len) {
+    while (len > 0) {
+        const ssize_t n = read(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        const ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static void serve_connection(int fd) {
+    uint8_t apdu[IO_APDU_BUFFER_SIZE];
+    uint8_t reply[4 + IO_APDU_BUFFER_SIZE];
+
+    for (;;) {
+        uint8_t hdr[4];
+        if (read_all(fd, hdr, sizeof(hdr)) != 0) {
+            return;
+        }
+        const uint32_t len = (uint32_t) hdr[0] << 24 | (uint32_t) hdr[1] << 16 | (uint32_t) hdr[2] << 8 | hdr[3];
+        if (len < 5 || len > sizeof(apdu) || read_all(fd, apdu, len) != 0) {
+            return;
+        }
+
+        uint16_t resp_len = 0;
+        if (sim_exchange(apdu, (uint16_t) len, reply + 4, &resp_len) == 0 || resp_len < 2) {
+            return;
+        }
+
+        const uint32_t data_len = resp_len - 2u;
+        reply[0] = (uint8_t) (data_len >> 24);
+        reply[1] = (uint8_t) (data_len >> 16);
+        reply[2] = (uint8_t) (data_len >> 8);
+        reply[3] = (uint8_t) data_len;
+        if (write_all(fd, reply, 4u + resp_len) != 0) {
+            return;
+        }
+    }
+}
+
+int sim_serve_tcp(uint16_t port) {
+    const int srv = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv < 0) {
+        return -1;
+    }
+
+    const int one = 1;
+    setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (bind(srv, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(srv, 1) != 0) {
+        close(srv);
+        return -1;
+    }
+    fprintf(stderr, "# listening on 127.0.0.1:%u\n", port);
+
+    // One client at a time, as with a device on USB
+    for (;;) {
+        const int fd = accept(srv, NULL, NULL);
+        if (fd < 0) {
+            close(srv);
+            return -1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        serve_connection(fd);
+        close(fd);
+    }
+}
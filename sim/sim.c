@@ -0,0 +1,322 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "flash.h"
+#include "os.h"
+#include "ux.h"
+#include "os_io_seproxyhal.h"
+#include "view.h"
+#include "app_main.h"
+#include "storage.h"
+#include "libxmss/nvram.h"
+#include "nvstage.h"
+#include "libxmss/perf.h"
+
+extern void h_sign_accept(unsigned int _);
+extern void h_sign_reject(unsigned int _);
+
+sim_stats_t sim_stats;
+uint8_t sim_seed[SIM_SEED_SIZE];
+
+#ifdef TESTING_ENABLED
+// The host's own calls between two APDUs reuse the stack below sim_exchange, so the
+// painted window is saved when the app returns and put back before it runs again
+static uint8_t sim_stack_shadow[SIM_STACK_WINDOW - SIM_STACK_MARGIN];
+#endif
+
+static struct {
+    // Pending request
+    uint8_t apdu[IO_APDU_BUFFER_SIZE];
+    uint16_t apdu_len;
+
+    // Last reply
+    uint8_t *resp;
+    uint16_t resp_len;
+    uint8_t replied;
+
+    uint8_t approve;
+} io;
+
+// What is on screen
+static struct {
+    const bagl_element_t *elements;
+    unsigned int count;
+    button_push_callback_t handler;
+    const ux_menu_entry_t *menu;
+    uint64_t serial;
+} screen;
+
+uint64_t sim_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void sim_ux_display(const bagl_element_t *elements, unsigned int count, button_push_callback_t handler) {
+    screen.elements = elements;
+    screen.count = count;
+    screen.handler = handler;
+    screen.menu = NULL;
+    screen.serial++;
+    sim_stats.screens++;
+}
+
+void sim_ux_menu_display(unsigned int current, const ux_menu_entry_t *entries) {
+    UNUSED(current);
+    screen.elements = NULL;
+    screen.count = 0;
+    screen.handler = NULL;
+    screen.menu = entries;
+    screen.serial++;
+    sim_stats.screens++;
+}
+
+static const ux_menu_entry_t *sim_menu_find(ux_menu_callback_t callback, const char *line1) {
+    if (screen.menu == NULL) {
+        return NULL;
+    }
+    for (const ux_menu_entry_t *e = screen.menu; e->line1 != NULL || e->icon != NULL; e++) {
+        if (callback != NULL && e->callback == callback) {
+            return e;
+        }
+        if (line1 != NULL && e->line1 != NULL && strcmp(e->line1, line1) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void sim_press(unsigned int buttons) {
+    sim_stats.buttons++;
+    screen.handler(BUTTON_EVT_RELEASED | buttons, 0);
+}
+
+// Headless user, walks the review pages and accepts or rejects
+static void sim_ux_run(void) {
+    for (unsigned int step = 0; step < SIM_MAX_UX_STEPS && !io.replied; step++) {
+        if (screen.menu != NULL) {
+            const ux_menu_entry_t *e = sim_menu_find(io.approve ? h_sign_accept : h_sign_reject, NULL);
+            if (e == NULL) {
+                break;
+            }
+            sim_stats.selections++;
+            e->callback(e->userid);
+            continue;
+        }
+
+        if (screen.handler == NULL) {
+            break;
+        }
+
+        if (io.approve) {
+            sim_press(BUTTON_RIGHT);
+        } else {
+            // Both buttons leave a review, left rejects the rest
+            const uint64_t serial = screen.serial;
+            sim_press(BUTTON_LEFT | BUTTON_RIGHT);
+            if (serial == screen.serial && !io.replied) {
+                sim_press(BUTTON_LEFT);
+            }
+        }
+    }
+
+    if (!io.replied) {
+        fprintf(stderr, "sim: the UI did not reply\n");
+        THROW(EXCEPTION_IO_RESET);
+    }
+}
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len) {
+    if (tx_len > 0 && !(channel_and_flags & IO_ASYNCH_REPLY)) {
+        memcpy(io.resp, G_io_apdu_buffer, tx_len);
+        io.resp_len = tx_len;
+        io.replied = 1;
+    }
+
+    if (channel_and_flags & IO_RETURN_AFTER_TX) {
+        return 0;
+    }
+
+    if (channel_and_flags & IO_ASYNCH_REPLY) {
+        sim_ux_run();
+    }
+
+    // Nothing else queued, give control back to the caller
+    if (io.apdu_len == 0) {
+        THROW(EXCEPTION_IO_RESET);
+    }
+
+    const uint16_t rx = io.apdu_len;
+    memcpy(G_io_apdu_buffer, io.apdu, rx);
+    io.apdu_len = 0;
+    sim_stats.apdus++;
+    return rx;
+}
+
+// Name under which the flash model accounts the writes of a command
+static const char *sim_op_name(uint8_t ins) {
+    switch (ins) {
+        case INS_SIGN:
+            return "sign";
+        case INS_SIGN_NEXT:
+            return "sign chunks";
+        case INS_SETIDX:
+            return "setidx";
+        case INS_SETHASH:
+            return "sethash";
+        case INS_SWITCH_TREE:
+            return "tree switch";
+        default:
+            return "other";
+    }
+}
+
+static const char *sim_menu_op_name(const char *line1) {
+    if (strcmp(line1, "Init Tree") == 0) {
+        return "keygen";
+    }
+    if (strcmp(line1, "Switch Tree") == 0) {
+        return "tree switch";
+    }
+    return "other";
+}
+
+void sim_boot(void) {
+    memset(&screen, 0, sizeof(screen));
+    flash_set_op("boot");
+
+    BEGIN_TRY
+    {
+        TRY
+        {
+            view_init();
+            app_init();
+        }
+        CATCH_OTHER(e)
+        {
+            fprintf(stderr, "sim: boot failed 0x%04X\n", e);
+        }
+        FINALLY
+        {}
+    }
+    END_TRY;
+}
+
+void sim_init(const uint8_t *seed) {
+    memset(sim_seed, 0, sizeof(sim_seed));
+    if (seed != NULL) {
+        memcpy(sim_seed, seed, sizeof(sim_seed));
+    }
+
+    // Fresh NVRAM
+    memset((void *) &N_appdata_impl, 0, sizeof(N_appdata_impl));
+    memset((void *) &N_xmss_data_impl, 0, sizeof(N_xmss_data_impl));
+    memset((void *) &N_nvstage_impl, 0, sizeof(N_nvstage_impl));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+
+    flash_init();
+    flash_add_region("N_appdata", (const void *) &N_appdata_impl, sizeof(N_appdata_impl));
+    flash_add_region("N_xmss_data", (const void *) &N_xmss_data_impl, sizeof(N_xmss_data_impl));
+    flash_add_region("N_nvstage", (const void *) &N_nvstage_impl, sizeof(N_nvstage_impl));
+
+    io.approve = 1;
+    sim_boot();
+}
+
+void sim_set_approve(uint8_t approve) {
+    io.approve = approve;
+}
+
+uint16_t sim_exchange(const uint8_t *apdu, uint16_t apdu_len, uint8_t *resp, uint16_t *resp_len) {
+    if (apdu_len == 0 || apdu_len > IO_APDU_BUFFER_SIZE) {
+        return 0;
+    }
+
+    memcpy(io.apdu, apdu, apdu_len);
+    io.apdu_len = apdu_len;
+    flash_set_op(sim_op_name(apdu_len > 1 ? apdu[1] : 0));
+    io.resp = resp;
+    io.resp_len = 0;
+    io.replied = 0;
+
+#ifdef TESTING_ENABLED
+    // The app runs on the host stack, the stack probe measures from this frame
+    const uintptr_t stack_top = (uintptr_t) __builtin_frame_address(0);
+    if (perf_stack_top != stack_top) {
+        // first call, or called from another thread
+        memset(sim_stack_shadow, 0, sizeof(sim_stack_shadow));
+        perf_stack_top = stack_top;
+        perf_stack_base = stack_top - SIM_STACK_WINDOW;
+    }
+    memcpy((void *) perf_stack_base, sim_stack_shadow, sizeof(sim_stack_shadow));
+#endif
+
+    BEGIN_TRY
+    {
+        TRY
+        {
+            app_main();
+        }
+        CATCH_OTHER(e)
+        {
+            if (e != EXCEPTION_IO_RESET) {
+                fprintf(stderr, "sim: app exited 0x%04X\n", e);
+            }
+        }
+        FINALLY
+        {}
+    }
+    END_TRY;
+
+#ifdef TESTING_ENABLED
+    memcpy(sim_stack_shadow, (const void *) perf_stack_base, sizeof(sim_stack_shadow));
+#endif
+
+    *resp_len = io.resp_len;
+    if (!io.replied || io.resp_len < 2) {
+        return 0;
+    }
+    return (uint16_t) ((resp[io.resp_len - 2] << 8) | resp[io.resp_len - 1]);
+}
+
+uint8_t sim_ux_select(const char *line1) {
+    const ux_menu_entry_t *e = sim_menu_find(NULL, line1);
+    if (e == NULL || e->callback == NULL) {
+        return 0;
+    }
+    flash_set_op(sim_menu_op_name(line1));
+
+    BEGIN_TRY
+    {
+        TRY
+        {
+            sim_stats.selections++;
+            e->callback(e->userid);
+        }
+        CATCH_OTHER(ex)
+        {
+            fprintf(stderr, "sim: menu entry failed 0x%04X\n", ex);
+        }
+        FINALLY
+        {}
+    }
+    END_TRY;
+    return 1;
+}
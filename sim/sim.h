@@ -0,0 +1,87 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SIM_SEED_SIZE       32
+#define SIM_MAX_UX_STEPS    1024
+#define SIM_STACK_WINDOW    0x8000      // host stack below sim_exchange seen by INS_TEST_STACK
+#define SIM_STACK_MARGIN    512         // top of the window, holds the frames of sim_exchange's callees
+
+typedef struct {
+    uint64_t apdus;
+    uint64_t nvm_writes;
+    uint64_t nvm_bytes;
+    uint64_t screens;
+    uint64_t buttons;
+    uint64_t selections;
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+extern uint8_t sim_seed[SIM_SEED_SIZE];
+
+/// Wipes NVRAM, sets the device seed (NULL for all zeros) and boots the app
+void sim_init(const uint8_t *seed);
+
+/// Boots the app again keeping NVRAM, same as a power cycle
+void sim_boot(void);
+
+/// 1 (default) accepts every review, 0 rejects them
+void sim_set_approve(uint8_t approve);
+
+/// Sends one APDU and runs the app until it replies. resp must hold
+/// IO_APDU_BUFFER_SIZE bytes. Returns the status word, 0 if there was no reply.
+uint16_t sim_exchange(const uint8_t *apdu, uint16_t apdu_len, uint8_t *resp, uint16_t *resp_len);
+
+/// Picks the entry of the current menu whose first line matches, e.g. "Init Tree".
+/// Returns 0 if there is no such entry.
+uint8_t sim_ux_select(const char *line1);
+
+/////////////////////////////////////////////
+// NVRAM snapshots
+
+typedef struct sim_snapshot_s sim_snapshot_t;
+
+/// Copies the seed and the whole NVRAM image
+sim_snapshot_t *sim_snapshot_take(void);
+
+/// Puts the image back and boots the app on it
+void sim_snapshot_restore(const sim_snapshot_t *snapshot);
+void sim_snapshot_free(sim_snapshot_t *snapshot);
+
+/// Image files, rejected if the NVRAM layout changed
+int sim_snapshot_save(const char *path);
+int sim_snapshot_load(const char *path);
+
+/// Forks the simulated device. The child starts from the same NVRAM, shared
+/// copy-on-write, with its counters cleared. Returns as fork() does.
+int sim_fork(void);
+
+/// Serves APDUs on 127.0.0.1:port with speculos framing, one client at a
+/// time. Only returns on socket errors.
+int sim_serve_tcp(uint16_t port);
+
+/// Monotonic clock for latency measurements
+uint64_t sim_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
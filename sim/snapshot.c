@@ -0,0 +1,132 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "flash.h"
+#include "storage.h"
+#include "nvstage.h"
+#include "libxmss/nvram.h"
+
+#define SNAPSHOT_MAGIC "QRLSIM01"
+
+struct sim_snapshot_s {
+    uint8_t seed[SIM_SEED_SIZE];
+    app_data_t appdata;
+    xmss_data_t xmss_data;
+    nvstage_journal_t nvstage;
+};
+
+// Region sizes, stored in image files to detect layout changes
+typedef struct {
+    char magic[8];
+    uint32_t appdata_size;
+    uint32_t xmss_data_size;
+    uint32_t nvstage_size;
+} snapshot_header_t;
+
+static void snapshot_header(snapshot_header_t *h) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic));
+    h->appdata_size = sizeof(app_data_t);
+    h->xmss_data_size = sizeof(xmss_data_t);
+    h->nvstage_size = sizeof(nvstage_journal_t);
+}
+
+sim_snapshot_t *sim_snapshot_take(void) {
+    sim_snapshot_t *s = malloc(sizeof(sim_snapshot_t));
+    if (s == NULL) {
+        return NULL;
+    }
+    memcpy(s->seed, sim_seed, sizeof(s->seed));
+    memcpy(&s->appdata, (const void *) &N_appdata_impl, sizeof(s->appdata));
+    memcpy(&s->xmss_data, (const void *) &N_xmss_data_impl, sizeof(s->xmss_data));
+    memcpy(&s->nvstage, (const void *) &N_nvstage_impl, sizeof(s->nvstage));
+    return s;
+}
+
+void sim_snapshot_restore(const sim_snapshot_t *s) {
+    memcpy(sim_seed, s->seed, sizeof(sim_seed));
+    memcpy((void *) &N_appdata_impl, &s->appdata, sizeof(s->appdata));
+    memcpy((void *) &N_xmss_data_impl, &s->xmss_data, sizeof(s->xmss_data));
+    memcpy((void *) &N_nvstage_impl, &s->nvstage, sizeof(s->nvstage));
+    sim_boot();
+}
+
+void sim_snapshot_free(sim_snapshot_t *s) {
+    free(s);
+}
+
+int sim_snapshot_save(const char *path) {
+    snapshot_header_t h;
+    snapshot_header(&h);
+
+    sim_snapshot_t *s = sim_snapshot_take();
+    FILE *f = fopen(path, "wb");
+    if (s == NULL || f == NULL) {
+        sim_snapshot_free(s);
+        if (f != NULL) {
+            fclose(f);
+        }
+        return -1;
+    }
+
+    const int ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(s, sizeof(*s), 1, f) == 1;
+    sim_snapshot_free(s);
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+int sim_snapshot_load(const char *path) {
+    snapshot_header_t expected;
+    snapshot_header_t h;
+    snapshot_header(&expected);
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    sim_snapshot_t *s = malloc(sizeof(sim_snapshot_t));
+    const int ok = s != NULL &&
+                   fread(&h, sizeof(h), 1, f) == 1 &&
+                   memcmp(&h, &expected, sizeof(h)) == 0 &&
+                   fread(s, sizeof(*s), 1, f) == 1;
+    fclose(f);
+
+    if (!ok) {
+        free(s);
+        return -1;
+    }
+
+    // Same as a fresh device, with the stored image
+    sim_init(s->seed);
+    sim_snapshot_restore(s);
+    sim_snapshot_free(s);
+    return 0;
+}
+
+int sim_fork(void) {
+    fflush(NULL);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        memset(&sim_stats, 0, sizeof(sim_stats));
+        flash_reset_counters();
+    }
+    return pid;
+}
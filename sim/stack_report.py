@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+# *******************************************************************************
+# *   (c) 2019 ZondaX GmbH
+# *
+# *  Licensed under the Apache License, Version 2.0 (the "License");
+# *  you may not use this file except in compliance with the License.
+# *  You may obtain a copy of the License at
+# *
+# *      http://www.apache.org/licenses/LICENSE-2.0
+# *
+# *  Unless required by applicable law or agreed to in writing, software
+# *  distributed under the License is distributed on an "AS IS" BASIS,
+# *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# *  See the License for the specific language governing permissions and
+# *  limitations under the License.
+# ********************************************************************************
+"""Worst case stack depth from gcc's stack usage output.
+
+Frame sizes come from -fstack-usage (.su) or -fcallgraph-info=su (.ci), call edges
+from the .ci files or from the disassembly of the linked image:
+
+  stack_report.py --ci <build dir> [--root app_main] [--limit 2384]
+  stack_report.py --su <obj dir> --elf bin/app.elf --objdump arm-none-eabi-objdump --limit 2384
+
+Functions without a frame size (SDK, syscalls) count as 0 and are marked "?",
+recursion and indirect calls are marked as they make the bound a lower bound.
+The exit status is 1 when a root goes over --limit.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+CI_NODE = re.compile(r'node:\s*\{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"')
+CI_EDGE = re.compile(r'edge:\s*\{\s*sourcename:\s*"([^"]+)"\s*targetname:\s*"([^"]+)"')
+CI_BYTES = re.compile(r'(\d+) bytes \(([a-z,]+)\)')
+SU_LINE = re.compile(r'^(.*):(\d+):(\d+):(\S+)\t(\d+)\t(\S+)$')
+OBJDUMP_FUNC = re.compile(r'^[0-9a-f]+ <([^>]+)>:$')
+OBJDUMP_CALL = re.compile(r'\t(bl|blx|b\.w|b)\s+[0-9a-f]+ <([^>+]+)(\+0x[0-9a-f]+)?>')
+OBJDUMP_INDIRECT = re.compile(r'\tblx\s+r\d+')
+
+INDIRECT = '__indirect_call'
+
+
+class Graph:
+    def __init__(self):
+        self.frame = {}         # function -> bytes
+        self.dynamic = set()    # functions with a dynamic frame (alloca, VLA)
+        self.calls = {}         # function -> set of callees
+
+    def add_frame(self, name, size, qualifier):
+        self.frame[name] = max(size, self.frame.get(name, 0))
+        if qualifier != 'static':
+            self.dynamic.add(name)
+
+    def add_call(self, src, dst):
+        self.calls.setdefault(src, set()).add(dst)
+
+
+def walk(root, suffix):
+    if os.path.isfile(root):
+        yield root
+        return
+    for d, _, files in os.walk(root):
+        for f in sorted(files):
+            if f.endswith(suffix):
+                yield os.path.join(d, f)
+
+
+def load_ci(g, path):
+    for fn in walk(path, '.ci'):
+        with open(fn) as f:
+            text = f.read()
+        # titles are the function names, prefixed with the file for static functions
+        for title, label in CI_NODE.findall(text):
+            m = CI_BYTES.search(label)
+            if title == INDIRECT or m is None:
+                continue
+            g.add_frame(title, int(m.group(1)), m.group(2))
+        for src, dst in CI_EDGE.findall(text):
+            g.add_call(src, dst)
+
+
+def load_su(g, path):
+    for fn in walk(path, '.su'):
+        with open(fn) as f:
+            for line in f:
+                m = SU_LINE.match(line.rstrip('\n'))
+                if m:
+                    g.add_frame(m.group(4), int(m.group(5)), m.group(6))
+
+
+def load_objdump(g, objdump, elf):
+    out = subprocess.run([objdump, '-d', '--no-show-raw-insn', elf],
+                         check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    func = None
+    for line in out.splitlines():
+        m = OBJDUMP_FUNC.match(line)
+        if m:
+            func = m.group(1)
+            continue
+        if func is None:
+            continue
+        m = OBJDUMP_CALL.search(line)
+        if m:
+            insn, target, offset = m.groups()
+            # a branch into another function is a tail call, a branch with an offset is local
+            if insn in ('bl', 'blx') or (offset is None and target != func):
+                g.add_call(func, target)
+        elif OBJDUMP_INDIRECT.search(line):
+            g.add_call(func, INDIRECT)
+
+
+class Analysis:
+    def __init__(self, g):
+        self.g = g
+        self.depth = {}
+        self.next = {}
+        self.flags = {}
+        self.active = set()
+
+    def run(self, f):
+        if f in self.depth:
+            return self.depth[f]
+        if f in self.active:
+            # back edge: the recursion depth is unknown
+            self.flags.setdefault(f, set()).add('recursive')
+            return 0
+
+        self.active.add(f)
+        flags = set()
+        if f == INDIRECT:
+            flags.add('indirect')
+        elif f not in self.g.frame:
+            flags.add('?')
+        if f in self.g.dynamic:
+            flags.add('dynamic')
+
+        best, best_callee = 0, None
+        for callee in sorted(self.g.calls.get(f, ())):
+            d = self.run(callee)
+            if d > best or best_callee is None:
+                best, best_callee = d, callee
+        self.active.discard(f)
+
+        self.depth[f] = self.g.frame.get(f, 0) + best
+        self.next[f] = best_callee
+        self.flags.setdefault(f, set()).update(flags)
+        return self.depth[f]
+
+    def path(self, f):
+        out = []
+        while f is not None and f not in out:
+            out.append(f)
+            f = self.next.get(f)
+        return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Worst case stack depth from gcc stack usage files')
+    ap.add_argument('--ci', action='append', default=[], help='.ci file or directory (-fcallgraph-info=su)')
+    ap.add_argument('--su', action='append', default=[], help='.su file or directory (-fstack-usage)')
+    ap.add_argument('--elf', help='linked image, call edges are taken from its disassembly')
+    ap.add_argument('--objdump', default='objdump', help='objdump for --elf')
+    ap.add_argument('--root', action='append', default=[], help='entry point, default: the five deepest functions nobody calls')
+    ap.add_argument('--limit', type=int, default=0, help='stack size in bytes, e.g. APP_STACK_SIZE')
+    ap.add_argument('--top', type=int, default=20, help='functions listed in the table')
+    args = ap.parse_args()
+
+    g = Graph()
+    for p in args.ci:
+        load_ci(g, p)
+    for p in args.su:
+        load_su(g, p)
+    if args.elf:
+        load_objdump(g, args.objdump, args.elf)
+    if not g.frame:
+        ap.error('no stack usage found, build with -fstack-usage or -fcallgraph-info=su')
+
+    a = Analysis(g)
+    for f in sorted(set(g.frame) | set(g.calls)):
+        a.run(f)
+
+    roots = args.root
+    if not roots:
+        called = set()
+        for callees in g.calls.values():
+            called |= callees
+        roots = sorted((f for f in g.frame if f not in called), key=lambda f: (-a.depth[f], f))[:5]
+
+    def flags(f):
+        return ' '.join(sorted(a.flags.get(f, ())))
+
+    def name(f):
+        return os.path.basename(f) if ':' in f else f
+
+    print('%8s %8s  %s' % ('worst', 'frame', 'function'))
+    ranked = sorted(g.frame, key=lambda f: (-a.depth[f], f))
+    for f in ranked[:args.top]:
+        print('%8d %8d  %s %s' % (a.depth[f], g.frame[f], name(f), flags(f)))
+
+    over = 0
+    for r in roots:
+        if r not in a.depth:
+            print('\n%s: not found' % r)
+            continue
+        d = a.depth[r]
+        mark = ''
+        if args.limit:
+            mark = ' (%d%% of %d)' % (100 * d // args.limit, args.limit)
+            if d > args.limit:
+                mark += ' OVER'
+                over += 1
+        print('\n%s: %d bytes%s' % (r, d, mark))
+        for f in a.path(r):
+            print('%8d  %s %s' % (g.frame.get(f, 0), name(f), flags(f)))
+
+    return 1 if over else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,272 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+int trace_hex_decode(const char *hex, uint8_t *out, int max) {
+    int n = 0;
+    while (*hex != 0) {
+        if (isspace((unsigned char) *hex)) {
+            hex++;
+            continue;
+        }
+        if (n >= max || !isxdigit((unsigned char) hex[0]) || !isxdigit((unsigned char) hex[1])) {
+            return -1;
+        }
+        const char pair[3] = {hex[0], hex[1], 0};
+        out[n++] = (uint8_t) strtoul(pair, NULL, 16);
+        hex += 2;
+    }
+    return n;
+}
+
+static void trace_write_hex(FILE *f, const char *prefix, const uint8_t *data, uint16_t len) {
+    fputs(prefix, f);
+    for (uint16_t i = 0; i < len; i++) {
+        fprintf(f, "%02x", data[i]);
+    }
+    fputc('\n', f);
+}
+
+static trace_entry_t *trace_push(trace_t *t) {
+    if (t->count == t->capacity) {
+        const uint32_t capacity = t->capacity == 0 ? 64 : t->capacity * 2;
+        trace_entry_t *entries = realloc(t->entries, capacity * sizeof(trace_entry_t));
+        if (entries == NULL) {
+            return NULL;
+        }
+        t->entries = entries;
+        t->capacity = capacity;
+    }
+    trace_entry_t *e = &t->entries[t->count++];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+int trace_load(trace_t *t, FILE *f) {
+    char line[2 * TRACE_APDU_MAX + 64];
+    unsigned int lineno = 0;
+
+    memset(t, 0, sizeof(*t));
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        if (strncmp(line, "@seed ", 6) == 0) {
+            if (trace_hex_decode(line + 6, t->seed, sizeof(t->seed)) != sizeof(t->seed)) {
+                goto fail;
+            }
+        } else if (strncmp(line, "@keygen", 7) == 0) {
+            t->keygen = 1;
+        } else if (strncmp(line, "@select ", 8) == 0) {
+            trace_entry_t *e = trace_push(t);
+            const size_t len = strcspn(line + 8, "\r\n");
+            if (e == NULL || len == 0 || len >= TRACE_SELECT_MAX) {
+                goto fail;
+            }
+            memcpy(e->select, line + 8, len);
+        } else if (strncmp(line, "=> ", 3) == 0) {
+            trace_entry_t *e = trace_push(t);
+            if (e == NULL) {
+                goto fail;
+            }
+            const int len = trace_hex_decode(line + 3, e->cmd, sizeof(e->cmd));
+            if (len < 5) {
+                goto fail;
+            }
+            e->cmd_len = (uint16_t) len;
+        } else if (strncmp(line, "<= ", 3) == 0) {
+            if (t->count == 0 || t->entries[t->count - 1].cmd_len == 0 ||
+                t->entries[t->count - 1].resp_len != 0) {
+                goto fail;
+            }
+            trace_entry_t *e = &t->entries[t->count - 1];
+            const int len = trace_hex_decode(line + 3, e->resp, sizeof(e->resp));
+            if (len < 2) {
+                goto fail;
+            }
+            e->resp_len = (uint16_t) len;
+        } else {
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    fprintf(stderr, "trace: invalid line %u\n", lineno);
+    trace_free(t);
+    return -1;
+}
+
+void trace_free(trace_t *t) {
+    free(t->entries);
+    memset(t, 0, sizeof(*t));
+}
+
+void trace_write_header(FILE *f, const uint8_t *seed, uint8_t keygen) {
+    trace_write_hex(f, "@seed ", seed, SIM_SEED_SIZE);
+    if (keygen) {
+        fputs("@keygen\n", f);
+    }
+}
+
+void trace_write_exchange(FILE *f,
+                          const uint8_t *cmd, uint16_t cmd_len,
+                          const uint8_t *resp, uint16_t resp_len) {
+    trace_write_hex(f, "=> ", cmd, cmd_len);
+    if (resp_len > 0) {
+        trace_write_hex(f, "<= ", resp, resp_len);
+    }
+}
+
+void trace_write_select(FILE *f, const char *line1) {
+    fprintf(f, "@select %s\n", line1);
+}
+
+static uint8_t trace_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    uint8_t b = 0;
+    while (us > 0 && b < TRACE_HIST_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void trace_replay(const trace_t *t, trace_exchange_t exchange, trace_select_t select, void *user,
+                  uint8_t check, trace_stats_t *stats) {
+    uint8_t resp[TRACE_APDU_MAX];
+
+    for (uint32_t i = 0; i < t->count; i++) {
+        const trace_entry_t *e = &t->entries[i];
+        if (e->cmd_len == 0) {
+            if (select != NULL && !select(user, e->select)) {
+                stats->mismatches++;
+            }
+            continue;
+        }
+        trace_ins_stats_t *s = &stats->ins[e->cmd[1]];
+        uint16_t resp_len = 0;
+
+        const uint64_t start = sim_now_ns();
+        const uint16_t sw = exchange(user, e->cmd, e->cmd_len, resp, &resp_len);
+        const uint64_t elapsed = sim_now_ns() - start;
+
+        stats->round_trips++;
+        if (sw == 0) {
+            stats->no_reply++;
+        }
+        if (check && e->resp_len > 0 &&
+            (resp_len != e->resp_len || memcmp(resp, e->resp, resp_len) != 0)) {
+            stats->mismatches++;
+        }
+
+        s->count++;
+        s->bytes_in += e->cmd_len;
+        s->bytes_out += resp_len;
+        s->total_ns += elapsed;
+        if (s->min_ns == 0 || elapsed < s->min_ns) {
+            s->min_ns = elapsed;
+        }
+        if (elapsed > s->max_ns) {
+            s->max_ns = elapsed;
+        }
+        s->hist[trace_bucket(elapsed)]++;
+    }
+}
+
+void trace_stats_reset(trace_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void trace_stats_merge(trace_stats_t *dst, const trace_stats_t *src) {
+    for (int i = 0; i < 256; i++) {
+        trace_ins_stats_t *d = &dst->ins[i];
+        const trace_ins_stats_t *s = &src->ins[i];
+        if (s->count == 0) {
+            continue;
+        }
+        if (d->count == 0 || s->min_ns < d->min_ns) {
+            d->min_ns = s->min_ns;
+        }
+        if (s->max_ns > d->max_ns) {
+            d->max_ns = s->max_ns;
+        }
+        d->count += s->count;
+        d->bytes_in += s->bytes_in;
+        d->bytes_out += s->bytes_out;
+        d->total_ns += s->total_ns;
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            d->hist[b] += s->hist[b];
+        }
+    }
+    dst->round_trips += src->round_trips;
+    dst->mismatches += src->mismatches;
+    dst->no_reply += src->no_reply;
+    if (src->replay_ns > dst->replay_ns) {
+        dst->replay_ns = src->replay_ns;
+    }
+}
+
+void trace_stats_print(FILE *f, const trace_stats_t *stats, uint64_t wall_ns) {
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+
+    fprintf(f, "%-4s %8s %10s %10s %10s %10s %10s\n",
+            "INS", "count", "bytes in", "bytes out", "avg us", "min us", "max us");
+
+    for (int i = 0; i < 256; i++) {
+        const trace_ins_stats_t *s = &stats->ins[i];
+        if (s->count == 0) {
+            continue;
+        }
+        bytes_in += s->bytes_in;
+        bytes_out += s->bytes_out;
+        fprintf(f, "0x%02X %8llu %10llu %10llu %10.1f %10.1f %10.1f\n", i,
+                (unsigned long long) s->count,
+                (unsigned long long) s->bytes_in,
+                (unsigned long long) s->bytes_out,
+                (double) s->total_ns / (double) s->count / 1e3,
+                (double) s->min_ns / 1e3,
+                (double) s->max_ns / 1e3);
+
+        // Histogram, bucket b holds latencies in [2^(b-1), 2^b) us
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            if (s->hist[b] != 0) {
+                fprintf(f, "     < %7llu us %8llu\n", 1ULL << b, (unsigned long long) s->hist[b]);
+            }
+        }
+    }
+
+    fprintf(f, "round trips %llu, %llu bytes in, %llu bytes out, %llu without reply, %llu mismatches\n",
+            (unsigned long long) stats->round_trips,
+            (unsigned long long) bytes_in,
+            (unsigned long long) bytes_out,
+            (unsigned long long) stats->no_reply,
+            (unsigned long long) stats->mismatches);
+    if (stats->replay_ns > 0) {
+        fprintf(f, "replay %.3f ms, %.1f round trips/s, wall %.3f ms with setup\n",
+                (double) stats->replay_ns / 1e6,
+                (double) stats->round_trips * 1e9 / (double) stats->replay_ns,
+                (double) wall_ns / 1e6);
+    }
+}
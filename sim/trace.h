@@ -0,0 +1,105 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+
+// APDU traces, one exchange per pair of lines as printed by ledgerblue:
+//
+//   # comment
+//   @seed <64 hex chars>        device seed for the session
+//   @keygen                     tree generated before the first command
+//   @select Switch Tree         menu entry picked on the device
+//   => 7701000000               command
+//   <= 0200009000               reply, including the status word
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sim.h"
+
+#define TRACE_APDU_MAX          260
+#define TRACE_HIST_BUCKETS      24          // log2 of the latency in microseconds
+
+#define TRACE_SELECT_MAX        24
+
+typedef struct {
+    char select[TRACE_SELECT_MAX];          // menu entry, set when cmd_len is 0
+    uint16_t cmd_len;
+    uint16_t resp_len;                      // 0 if the reply was not recorded
+    uint8_t cmd[TRACE_APDU_MAX];
+    uint8_t resp[TRACE_APDU_MAX];
+} trace_entry_t;
+
+typedef struct {
+    uint8_t seed[SIM_SEED_SIZE];
+    uint8_t keygen;
+    uint32_t count;
+    uint32_t capacity;
+    trace_entry_t *entries;
+} trace_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t bytes_in;                      // host to device
+    uint64_t bytes_out;                     // device to host
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t hist[TRACE_HIST_BUCKETS];
+} trace_ins_stats_t;
+
+typedef struct {
+    trace_ins_stats_t ins[256];
+    uint64_t round_trips;
+    uint64_t mismatches;
+    uint64_t no_reply;
+    uint64_t replay_ns;                     // slowest device, setup excluded
+} trace_stats_t;
+
+/// Sends a command and waits for the reply, returns the status word or 0
+typedef uint16_t (*trace_exchange_t)(void *user,
+                                     const uint8_t *cmd, uint16_t cmd_len,
+                                     uint8_t *resp, uint16_t *resp_len);
+
+/// Picks a menu entry on the device, returns 0 if it does not exist
+typedef uint8_t (*trace_select_t)(void *user, const char *line1);
+
+int trace_hex_decode(const char *hex, uint8_t *out, int max);
+
+int trace_load(trace_t *t, FILE *f);
+void trace_free(trace_t *t);
+
+void trace_write_header(FILE *f, const uint8_t *seed, uint8_t keygen);
+void trace_write_exchange(FILE *f,
+                          const uint8_t *cmd, uint16_t cmd_len,
+                          const uint8_t *resp, uint16_t resp_len);
+void trace_write_select(FILE *f, const char *line1);
+
+/// Replays every command once. With check set, replies that differ from the
+/// recorded ones are counted as mismatches. Menu selections are skipped when
+/// select is NULL.
+void trace_replay(const trace_t *t, trace_exchange_t exchange, trace_select_t select, void *user,
+                  uint8_t check, trace_stats_t *stats);
+
+void trace_stats_reset(trace_stats_t *stats);
+void trace_stats_merge(trace_stats_t *dst, const trace_stats_t *src);
+void trace_stats_print(FILE *f, const trace_stats_t *stats, uint64_t wall_ns);
+
+#ifdef __cplusplus
+}
+#endif
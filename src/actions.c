@@ -19,6 +19,7 @@
 
 #include "bolos_target.h"
 #include "storage.h"
+#include "nvstage.h"
 #include "view.h"
 #include "apdu_codes.h"
 
@@ -81,24 +82,27 @@ void get_seed(uint8_t *seed, uint8_t tree_idx) {
 }
 
 void hash_tx(uint8_t hash[32]) {
-    const int8_t ret = get_qrltx_hash(&ctx.qrltx, hash);
-    if (ret < 0) {
+    // the hash is computed while the tx is received
+    if (!qrltx_stream_done(&ctx.qrltx_stream)) {
         THROW(APDU_CODE_DATA_INVALID);
     }
+    MEMCPY(hash, ctx.qrltx_stream.hash, 32);
 }
 
 char actions_tree_init_step() {
     if (APP_CURTREE_MODE != APPMODE_NOT_INITIALIZED && APP_CURTREE_MODE != APPMODE_KEYGEN_RUNNING) {
         return false;
     }
+    PERF_ADD(keygen_steps, 1);
 
     if (APP_CURTREE_MODE == APPMODE_NOT_INITIALIZED) {
         uint8_t seed[48];
         get_seed(seed, N_appdata.tree_idx);
 
-        xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed);
+        xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed, XMSS_CUR_SK.hash_func);
 
         app_set_mode_index(APPMODE_KEYGEN_RUNNING, 0);
+        nvstage_commit();
         print_status("keygen start");
         view_idle_show();
         UX_WAIT();
@@ -108,19 +112,20 @@ char actions_tree_init_step() {
 #ifdef TESTING_ENABLED
         if (N_appdata.tree_idx == 0) {
             for (int idx  = 0; idx < 256; idx +=4){
-                nvm_write( (void *) (XMSS_CUR_NODES + 32 * idx),
-                           (void *) test_xmss_leaves[idx],
-                           128);
+                MEMCPY_NV((void *) (XMSS_CUR_NODES + 32 * idx),
+                      (void *) test_xmss_leaves[idx],
+                      128);
             }
         } else {
             for (int idx  = 0; idx < 256; idx +=4){
-                nvm_write( (void *) (XMSS_CUR_NODES + 32 * idx),
-                           (void *) test_xmss_leaves2[idx],
-                           128);
+                MEMCPY_NV((void *) (XMSS_CUR_NODES + 32 * idx),
+                      (void *) test_xmss_leaves2[idx],
+                      128);
             }
         }
 
         app_set_mode_index(APPMODE_KEYGEN_RUNNING, 256);
+        nvstage_commit();
         print_status("TEST TREE");
 #else
         const uint8_t *p = XMSS_CUR_NODES +32 * APP_CURTREE_XMSSIDX;
@@ -131,6 +136,7 @@ char actions_tree_init_step() {
             &XMSS_CUR_SK, APP_CURTREE_XMSSIDX);
 
         app_set_mode_index(APPMODE_KEYGEN_RUNNING, APP_CURTREE_XMSSIDX + 1);
+        nvstage_commit();
         print_status("keygen %03d/256", APP_CURTREE_XMSSIDX);
 #endif
     } else {
@@ -138,9 +144,10 @@ char actions_tree_init_step() {
         memset(pk.raw, 0, 64);
         xmss_gen_keys_3_get_root(XMSS_CUR_NODES, &XMSS_CUR_SK);
         xmss_pk(&pk, &XMSS_CUR_SK);
-        nvm_write(APP_CURTREE.pk.raw, pk.raw, 64);
-
+        // Public key and READY are committed together
+        nvstage_write(APP_CURTREE.pk.raw, pk.raw, 64);
         app_set_mode_index(APPMODE_READY, 0);
+        nvstage_commit();
         print_status("keygen root");
     }
 
@@ -148,6 +155,12 @@ char actions_tree_init_step() {
 }
 
 void actions_tree_init() {
+    // menu entries can run before the first tick
+    seed_verify();
+    if (seed_mode == SEED_MODE_ERR) {
+        return;
+    }
+
     while (actions_tree_init_step()) {
         view_idle_show();
         UX_WAIT();
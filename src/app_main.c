@@ -29,20 +29,38 @@
 #include "libxmss/nvram.h"
 #include "storage.h"
 #include "actions.h"
+#include "chaining.h"
+#include "nvstage.h"
 
 unsigned char G_io_seproxyhal_spi_buffer[IO_SEPROXYHAL_BUFFER_SIZE_B];
 
+// Set when a tx packet has been approved and more packets are expected
+uint8_t tx_stream_pending = 0;
+
+// Set while the signature in ctx is read with INS_SIGN_NEXT, anything else written to ctx clears it
+uint8_t sig_in_progress = 0;
+
 void parse_unsigned_message(volatile uint32_t *tx, uint32_t rx);
 
 void parse_view_address(volatile uint32_t *tx, uint32_t rx);
 
+// The seed is checked on the first command, button or tick that comes after app_init
+static void app_seed_check() {
+    if (seed_verify()) {
+        view_update_state();
+        view_idle_show();
+    }
+}
+
 unsigned char io_event(unsigned char channel) {
     switch (G_io_seproxyhal_spi_buffer[0]) {
         case SEPROXYHAL_TAG_FINGER_EVENT: //
+            app_seed_check();
             UX_FINGER_EVENT(G_io_seproxyhal_spi_buffer);
             break;
 
         case SEPROXYHAL_TAG_BUTTON_PUSH_EVENT: // for Nano S
+            app_seed_check();
             UX_BUTTON_PUSH_EVENT(G_io_seproxyhal_spi_buffer);
             break;
 
@@ -52,6 +70,8 @@ unsigned char io_event(unsigned char channel) {
             break;
 
         case SEPROXYHAL_TAG_TICKER_EVENT: {
+            PERF_ADD(ticks, 1);
+            app_seed_check();
             UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {if (UX_ALLOWED) UX_REDISPLAY()});
         }
             break;
@@ -109,25 +129,52 @@ void parse_unsigned_message(volatile uint32_t *tx, uint32_t rx) {
         THROW(APDU_CODE_WRONG_LENGTH);
     }
 
-    const uint8_t p1 = G_io_apdu_buffer[2];
-    const uint8_t p2 = G_io_apdu_buffer[3];
-    const uint8_t *data = G_io_apdu_buffer + 5;
+    uint8_t pck_index = G_io_apdu_buffer[OFFSET_PCK_INDEX];
+    uint8_t pck_count = G_io_apdu_buffer[OFFSET_PCK_COUNT];
+    const uint8_t *data = G_io_apdu_buffer + OFFSET_DATA;
 
-    UNUSED(p1);
-    UNUSED(p2);
-    UNUSED(data);
+    // A packet count of zero means the whole tx comes in this APDU
+    if (pck_count == 0) {
+        pck_index = 1;
+        pck_count = 1;
+    }
+
+    if (pck_index == 0 || pck_index > pck_count) {
+        tx_stream_pending = 0;
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    // The stream overlays the signature context
+    sig_in_progress = 0;
+
+    if (pck_index == 1) {
+        qrltx_stream_init(&ctx.qrltx_stream);
+    } else if (!tx_stream_pending ||
+               pck_index != ctx.qrltx_stream.pck_index + 1 ||
+               pck_count != ctx.qrltx_stream.pck_count) {
+        // continuation packets are only accepted after the previous one was approved
+        tx_stream_pending = 0;
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+    tx_stream_pending = 0;
 
-    const uint8_t *msg = G_io_apdu_buffer + 5;
-    const qrltx_t *tx_p = (qrltx_t *) msg;
+    ctx.qrltx_stream.pck_index = pck_index;
+    ctx.qrltx_stream.pck_count = pck_count;
 
-    // Validate message size
-    const int32_t req_size = get_qrltx_size(tx_p);
-    if (req_size < 0 || (uint32_t) req_size + 5 != rx) {
+    // Parse and hash the packet, only the subitems it completes are kept in RAM
+    if (qrltx_stream_append(&ctx.qrltx, &ctx.qrltx_stream, data, rx - OFFSET_DATA) < 0) {
         THROW(APDU_CODE_DATA_INVALID);
     }
 
-    // move the buffer to the tx ctx
-    memcpy((uint8_t * ) & ctx.qrltx, msg, rx);
+    // The first packet must hold every fixed field, the review shows them
+    if (!qrltx_stream_header_done(&ctx.qrltx_stream)) {
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    const uint8_t last = pck_index == pck_count;
+    if (last != qrltx_stream_done(&ctx.qrltx_stream)) {
+        THROW(APDU_CODE_DATA_INVALID);
+    }
 }
 
 ////////////////////////////////////////////////
@@ -148,7 +195,8 @@ void test_set_state(volatile uint32_t *tx, uint32_t rx)
     UNUSED(p2);
     UNUSED(data);
 
-    MEMCPY_NV((void*)APP_CURTREE.raw, G_io_apdu_buffer+2, 3);
+    nvstage_write(APP_CURTREE.raw, G_io_apdu_buffer+2, 3);
+    nvstage_commit();
 
     view_update_state();
 }
@@ -173,7 +221,7 @@ void test_pk_gen2(volatile uint32_t *tx, uint32_t rx)
     uint8_t seed[48];
     get_seed(seed, N_appdata.tree_idx);
 
-    xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed);
+    xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed, XMSS_CUR_SK.hash_func);
     xmss_gen_keys_2_get_nodes((uint8_t*) &N_XMSS_DATA.wots_buffer, (void*)p, &XMSS_CUR_SK, idx);
 
     MEMMOVE(G_io_apdu_buffer, (const void *)p, 32);
@@ -245,12 +293,13 @@ void test_calc_pk(volatile uint32_t *tx, uint32_t rx)
     xmss_gen_keys_3_get_root(XMSS_CUR_NODES, &XMSS_CUR_SK);
     xmss_pk(&pk, &XMSS_CUR_SK);
 
-    nvm_write(APP_CURTREE.pk.raw, pk.raw, 64);
+    nvstage_write(APP_CURTREE.pk.raw, pk.raw, 64);
 
     xmss_tree_t tmp;
     tmp.mode = APPMODE_READY;
     tmp.xmss_index = 0;
-    nvm_write((void*) &APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
+    nvstage_write(&APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
+    nvstage_commit();
 
     view_update_state();
 }
@@ -322,7 +371,7 @@ void test_digest(volatile uint32_t *tx, uint32_t rx)
     uint8_t seed[48];
     get_seed(seed, N_appdata.tree_idx);
 
-    xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed);
+    xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed, XMSS_CUR_SK.hash_func);
 
     xmss_digest_t digest;
     memset(digest.raw, 0, XMSS_DIGESTSIZE);
@@ -337,6 +386,64 @@ void test_digest(volatile uint32_t *tx, uint32_t rx)
     *tx+=64;
     view_update_state();
 }
+void test_get_stats(volatile uint32_t *tx, uint32_t rx)
+{
+    if (rx < 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    const uint8_t p1 = G_io_apdu_buffer[2];
+    const uint8_t p2 = G_io_apdu_buffer[3];
+    const uint8_t *data = G_io_apdu_buffer + 5;
+
+    UNUSED(p2);
+    UNUSED(data);
+
+    if (p1 == GET_STATS_P1_RESET) {
+        perf_reset();
+        return;
+    }
+
+    // Counters are sent big endian, in perf_stats_t order
+    for (uint8_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+        const uint32_t v = perf_stats.counter[i];
+        G_io_apdu_buffer[4 * i] = (uint8_t) (v >> 24);
+        G_io_apdu_buffer[4 * i + 1] = (uint8_t) (v >> 16);
+        G_io_apdu_buffer[4 * i + 2] = (uint8_t) (v >> 8);
+        G_io_apdu_buffer[4 * i + 3] = (uint8_t) v;
+    }
+    *tx += 4 * PERF_NUM_COUNTERS;
+}
+
+void test_get_stack(volatile uint32_t *tx, uint32_t rx)
+{
+    if (rx < 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    const uint8_t p1 = G_io_apdu_buffer[2];
+    const uint8_t p2 = G_io_apdu_buffer[3];
+    const uint8_t *data = G_io_apdu_buffer + 5;
+
+    UNUSED(p2);
+    UNUSED(data);
+
+    if (p1 == TEST_STACK_P1_PAINT) {
+        perf_stack_paint();
+        return;
+    }
+
+    // peak, sampled and size, big endian
+    perf_stack_t s;
+    perf_stack_read(&s);
+    const uint32_t v[3] = {s.peak, s.sampled, s.size};
+    for (uint8_t i = 0; i < 3; i++) {
+        G_io_apdu_buffer[4 * i] = (uint8_t) (v[i] >> 24);
+        G_io_apdu_buffer[4 * i + 1] = (uint8_t) (v[i] >> 16);
+        G_io_apdu_buffer[4 * i + 2] = (uint8_t) (v[i] >> 8);
+        G_io_apdu_buffer[4 * i + 3] = (uint8_t) v[i];
+    }
+    *tx += 12;
+}
+
 #endif
 
 ///////////////////////////////////////////////////////////
@@ -404,7 +511,7 @@ void app_get_pk(volatile uint32_t *tx, uint32_t rx) {
     UNUSED(data);
 
     // Add pk descriptor
-    G_io_apdu_buffer[0] = 0;        // XMSS, SHA2-256
+    G_io_apdu_buffer[0] = XMSS_CUR_SK.hash_func;    // XMSS, hash function
     G_io_apdu_buffer[1] = 4;        // Height 8
     G_io_apdu_buffer[2] = 0;        // SHA256_X
 
@@ -415,6 +522,72 @@ void app_get_pk(volatile uint32_t *tx, uint32_t rx) {
     view_update_state();
 }
 
+// INS_GET_TREES response: tree count, current tree, then one record per tree
+#define TREE_INFO_HEADER        2
+#define TREE_INFO_SIZE          70          // mode, xmss index (BE), pk descriptor, pk
+
+static void tree_info(uint8_t *out, uint8_t i) {
+    NV_VOL const xmss_tree_t *tree = &N_appdata.tree[i];
+
+    MEMSET(out, 0, TREE_INFO_SIZE);
+    out[0] = tree->mode;
+    out[1] = tree->xmss_index >> 8;
+    out[2] = tree->xmss_index & 0xFF;
+
+    // pk is only valid once keygen has finished
+    if (tree->mode == APPMODE_READY) {
+        out[3] = N_XMSS_DATA.trees[i].sk.hash_func;
+        out[4] = 4;        // Height 8
+        out[5] = 0;        // SHA256_X
+        MEMCPY(out + 6, (const void *) tree->pk.raw, 64);
+    }
+}
+
+// Pages are read straight from N_appdata, nothing is buffered in flash
+static void trees_read(uint8_t *out, uint16_t offset, uint16_t length) {
+    uint8_t record[TREE_INFO_SIZE];
+
+    while (length > 0) {
+        uint16_t skip;
+        uint16_t n;
+
+        if (offset < TREE_INFO_HEADER) {
+            record[0] = APP_NUM_TREES;
+            record[1] = APP_TREE_IDX;
+            skip = offset;
+            n = TREE_INFO_HEADER - skip;
+        } else {
+            const uint16_t rel = offset - TREE_INFO_HEADER;
+            tree_info(record, (uint8_t) (rel / TREE_INFO_SIZE));
+            skip = rel % TREE_INFO_SIZE;
+            n = TREE_INFO_SIZE - skip;
+        }
+        if (n > length) {
+            n = length;
+        }
+
+        MEMCPY(out, record + skip, n);
+        out += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+void app_get_trees(volatile uint32_t *tx, uint32_t rx) {
+    if (rx < 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    const uint8_t p1 = G_io_apdu_buffer[2];
+    const uint8_t p2 = G_io_apdu_buffer[3];
+    const uint8_t *data = G_io_apdu_buffer + 5;
+
+    UNUSED(p1);
+    UNUSED(p2);
+    UNUSED(data);
+
+    chain_response_send_reader(tx, trees_read, TREE_INFO_HEADER + APP_NUM_TREES * TREE_INFO_SIZE);
+}
+
 /// This allows extracting the signature by chunks
 void app_sign(volatile uint32_t *tx, uint32_t rx) {
     if (APP_CURTREE_MODE != APPMODE_READY) {
@@ -425,22 +598,32 @@ void app_sign(volatile uint32_t *tx, uint32_t rx) {
         THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
     }
 
+    if (!qrltx_stream_done(&ctx.qrltx_stream)) {
+        // Packet approved, wait for the next one
+        tx_stream_pending = 1;
+        return;
+    }
+
     uint8_t msg[32];        // Used to store the tx hash
     hash_tx(msg);
 
+    // Move index forward, before the signature context takes ctx over from the staged pages
+    const uint16_t index = APP_CURTREE_XMSSIDX;
+    xmss_tree_t tmp;
+
+    tmp.mode = APPMODE_READY;
+    tmp.xmss_index = index + 1;
+    nvstage_write(&APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
+    nvstage_commit();
+
     // buffer[2..3] are ignored (p1, p2)
     xmss_sign_incremental_init(
             &ctx.xmss_sig_ctx,
             msg,
             &XMSS_CUR_SK,
-            (uint8_t * )XMSS_CUR_NODES, APP_CURTREE_XMSSIDX);
-
-    // Move index forward
-    xmss_tree_t tmp;
-
-    tmp.mode = APPMODE_READY;
-    tmp.xmss_index = APP_CURTREE_XMSSIDX + 1;
-    nvm_write((void *) &APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
+            (uint8_t * )XMSS_CUR_NODES, index);
+    sig_in_progress = 1;
+    PERF_ADD(signatures, 1);
 }
 
 /// This allows extracting the signature by chunks
@@ -448,7 +631,8 @@ void app_sign_next(volatile uint32_t *tx, uint32_t rx) {
     if (APP_CURTREE_MODE != APPMODE_READY) {
         THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
     }
-    if (ctx.xmss_sig_ctx.sig_chunk_idx > 10) {
+    // Only the signature app_sign started, its leaf is spent already
+    if (!sig_in_progress || ctx.xmss_sig_ctx.sig_chunk_idx > 10) {
         THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
     }
 
@@ -461,9 +645,11 @@ void app_sign_next(volatile uint32_t *tx, uint32_t rx) {
     UNUSED(data);
 
     const uint16_t index = APP_CURTREE_XMSSIDX - 1;      // It has already been updated
+    PERF_ADD(sign_chunks, 1);
 
     if (ctx.xmss_sig_ctx.sig_chunk_idx == 10) {
         xmss_sign_incremental_last(&ctx.xmss_sig_ctx, G_io_apdu_buffer, &XMSS_CUR_SK, index);
+        sig_in_progress = 0;
         view_update_state();
     } else {
         xmss_sign_incremental(&ctx.xmss_sig_ctx, G_io_apdu_buffer, &XMSS_CUR_SK, index);
@@ -494,9 +680,44 @@ void parse_setidx(volatile uint32_t *tx, uint32_t rx) {
     UNUSED(p2);
     UNUSED(data);
 
+    sig_in_progress = 0;
     ctx.new_idx = *data;
 }
 
+void parse_switch_tree(volatile uint32_t *tx, uint32_t rx) {
+    if (rx != 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    // Keygen works on the current tree
+    if (APP_CURTREE_MODE == APPMODE_KEYGEN_RUNNING) {
+        THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
+    }
+}
+
+void app_sethash(volatile uint32_t *tx, uint32_t rx) {
+    if (rx < 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    // The hash function can only be chosen before keygen starts
+    if (APP_CURTREE_MODE != APPMODE_NOT_INITIALIZED) {
+        THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
+    }
+
+    const uint8_t p1 = G_io_apdu_buffer[2];
+    const uint8_t p2 = G_io_apdu_buffer[3];
+    const uint8_t *data = G_io_apdu_buffer + 5;
+
+    UNUSED(p2);
+    UNUSED(data);
+
+    if (p1 != SHASH_FUNC_SHA2_256 && p1 != SHASH_FUNC_SHAKE128 && p1 != SHASH_FUNC_SHAKE256) {
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    SET_NV(&XMSS_CUR_SK.hash_func, uint8_t, p1);
+    view_update_state();
+}
+
 void parse_view_address(volatile uint32_t *tx, uint32_t rx) {
     if (APP_CURTREE_MODE != APPMODE_READY) {
         THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
@@ -514,19 +735,37 @@ void parse_view_address(volatile uint32_t *tx, uint32_t rx) {
     UNUSED(data);
 }
 
+void app_switch_tree() {
+    seed_verify();
+    if (seed_mode == SEED_MODE_ERR) {
+        return;
+    }
+
+    app_set_tree((APP_TREE_IDX + 1) % 2);
+    nvstage_commit();
+}
+
 void app_setidx() {
     if (APP_CURTREE_MODE != APPMODE_READY) {
         THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
     }
 
     const uint16_t tmp = ctx.new_idx;
-    MEMCPY_NV((void *) &APP_CURTREE_XMSSIDX, (void *) &tmp, 2);
+    nvstage_write(&APP_CURTREE_XMSSIDX, &tmp, 2);
+    nvstage_commit();
     view_update_state();
 }
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-noreturn"
 
+void app_ctx_reset() {
+    MEMSET(&ctx, 0, sizeof(app_ctx_t));
+    tx_stream_pending = 0;
+    sig_in_progress = 0;
+    chain_reset();
+}
+
 void app_init() {
     io_seproxyhal_init();
     USB_power(0);
@@ -536,7 +775,7 @@ void app_init() {
     app_data_init();
 
     // Clear context
-    MEMSET(&ctx, 0, sizeof(app_ctx_t));
+    app_ctx_reset();
 
     // Initialize UI
     view_update_state();
@@ -562,6 +801,10 @@ void app_main() {
                     THROW(0x6982);
                 }
 
+                if (G_io_apdu_buffer[OFFSET_INS] != INS_VERSION) {
+                    app_seed_check();
+                }
+
                 if (seed_mode == SEED_MODE_ERR) {
                     THROW(APDU_CODE_BUSY);
                 }
@@ -570,6 +813,17 @@ void app_main() {
                     THROW(APDU_CODE_CLA_NOT_SUPPORTED);
                 }
 
+                // Any other command ends a streamed tx, ctx is shared
+                if (G_io_apdu_buffer[OFFSET_INS] != INS_SIGN) {
+                    tx_stream_pending = 0;
+                }
+
+                // Same for chained requests and responses
+                if (G_io_apdu_buffer[OFFSET_INS] != INS_NEXT_PAGE &&
+                    G_io_apdu_buffer[OFFSET_INS] != chain_ins()) {
+                    chain_reset();
+                }
+
                 switch (G_io_apdu_buffer[OFFSET_INS]) {
 
                     case INS_VERSION: {
@@ -631,6 +885,31 @@ void app_main() {
                         break;
                     }
 
+                    case INS_GET_TREES: {
+                        app_get_trees(&tx, rx);
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
+
+                    case INS_SWITCH_TREE: {
+                        parse_switch_tree(&tx, rx);
+                        view_switch_tree_show();
+                        flags |= IO_ASYNCH_REPLY;
+                        break;
+                    }
+
+                    case INS_SETHASH: {
+                        app_sethash(&tx, rx);
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
+
+                    case INS_NEXT_PAGE: {
+                        chain_next_page(&tx, rx);
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
+
                     case INS_VIEW_ADDRESS: {
                         if (APP_CURTREE_MODE != APPMODE_READY) {
                             THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
@@ -648,7 +927,7 @@ void app_main() {
                         uint8_t seed[48];
                         get_seed(seed, N_appdata.tree_idx);
 
-                        xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed);
+                        xmss_gen_keys_1_get_seeds(&XMSS_CUR_SK, seed, XMSS_CUR_SK.hash_func);
                         os_memmove(G_io_apdu_buffer, XMSS_CUR_SK.raw, 132);
                         tx+=132;
                         THROW(APDU_CODE_OK);
@@ -713,6 +992,27 @@ void app_main() {
                         THROW(APDU_CODE_OK);
                         break;
                     }
+
+                    case INS_GET_STATS: {
+                        test_get_stats(&tx, rx);
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
+
+                    case INS_TEST_STACK: {
+                        test_get_stack(&tx, rx);
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
+
+                    case INS_TEST_CHAIN: {
+                        if (chain_receive(rx)) {
+                            // the request buffer is sent back as it is
+                            chain_response_send(&tx);
+                        }
+                        THROW(APDU_CODE_OK);
+                        break;
+                    }
 #endif
                     default: {
                         THROW(APDU_CODE_INS_NOT_SUPPORTED);
@@ -19,6 +19,8 @@
 #include "app_types.h"
 
 extern app_ctx_t ctx;
+extern uint8_t tx_stream_pending;
+extern uint8_t sig_in_progress;
 
 #define CLA                             0x77
 #define OFFSET_CLA                      0
@@ -34,6 +36,10 @@ extern app_ctx_t ctx;
 #define INS_SIGN_NEXT           0x05u
 #define INS_SETIDX              0x06u
 #define INS_VIEW_ADDRESS        0x07u
+#define INS_SETHASH             0x08u
+#define INS_NEXT_PAGE           0x09u
+#define INS_SWITCH_TREE         0x0Au   // Same as the Switch Tree menu entry, confirmed on the device
+#define INS_GET_TREES           0x0Bu   // State and public key of every tree, paged
 
 #define INS_TEST_PK_GEN_1       0x80
 #define INS_TEST_PK_GEN_2       0x81
@@ -45,15 +51,29 @@ extern app_ctx_t ctx;
 #define INS_TEST_SETSTATE       0x87
 #define INS_TEST_COMM           0x88
 #define INS_TEST_GETSEED        0x89
+#define INS_TEST_CHAIN          0x8A    // Echoes a chained request as a paged response
+#define INS_GET_STATS           0x8B    // Reads performance counters, P1 = 1 resets them
+#define INS_TEST_STACK          0x8C    // Reads the stack high-water mark, P1 = 1 paints the stack
+
+#define GET_STATS_P1_READ       0
+#define GET_STATS_P1_RESET      1
+
+#define TEST_STACK_P1_READ      0
+#define TEST_STACK_P1_PAINT     1
 
 void handler_init_device(unsigned int unused);
 
 void app_init();
 
+/// Clears ctx, dropping the streamed tx, signature and chained request held there
+void app_ctx_reset();
+
 void app_main();
 
 void app_sign();
 
 void app_setidx();
 
+void app_switch_tree();
+
 char app_initialize_xmss_step();
@@ -17,11 +17,17 @@
 #include <stdint.h>
 #include "libxmss/xmss_types.h"
 #include "lib/qrl_types.h"
+#include "chaining.h"
+#include "nvstage.h"
 
-#pragma pack(push, 1)
+// Not packed, so that the stream's hash context and schema pointer are word aligned
 typedef union {
     xmss_sig_ctx_t xmss_sig_ctx;
-    qrltx_t qrltx;
+    struct {
+        qrltx_stream_t qrltx_stream;
+        qrltx_t qrltx;
+    };
     uint16_t new_idx;
+    uint8_t chain_ram[CHAIN_RAM_SIZE];
+    nvstage_t nvstage;
 } app_ctx_t;
-#pragma pack(pop)
@@ -20,18 +20,76 @@
 #include "segwit_addr.h"
 #include "bittools.h"
 
+#define BECH32_MAX_BYTES 128
+
+// 8 to 5 bit conversion, same output as convert_bits(..., 5, ..., 8, 0).
+// Five bytes are exactly eight symbols, so full groups go through a 64-bit
+// word and only the tail needs the bit by bit loop
+static size_t bytes_to_5bits(uint8_t *out, const uint8_t *in, size_t in_len) {
+    size_t out_len = 0;
+    while (in_len >= 5) {
+        const uint64_t v = ((uint64_t) in[0] << 32) | ((uint64_t) in[1] << 24) |
+                           ((uint64_t) in[2] << 16) | ((uint64_t) in[3] << 8) | in[4];
+        out[0] = (v >> 35) & 0x1F;
+        out[1] = (v >> 30) & 0x1F;
+        out[2] = (v >> 25) & 0x1F;
+        out[3] = (v >> 20) & 0x1F;
+        out[4] = (v >> 15) & 0x1F;
+        out[5] = (v >> 10) & 0x1F;
+        out[6] = (v >> 5) & 0x1F;
+        out[7] = v & 0x1F;
+        out += 8;
+        out_len += 8;
+        in += 5;
+        in_len -= 5;
+    }
+    size_t tail = 0;
+    convert_bits(out, &tail, 5, in, in_len, 8, 0);
+    return out_len + tail;
+}
+
 void bech32EncodeFromBytes(char *output,
                            const char *hrp,
                            const uint8_t *data,
                            size_t data_len) {
     output[0] = 0;
-    if (data_len > 128) {
+    if (data_len > BECH32_MAX_BYTES) {
         return;
     }
 
-    uint8_t tmp_data[128];
-    size_t tmp_size = 0;
-
-    convert_bits(tmp_data, &tmp_size, 5, data, data_len, 8, 0);
+    uint8_t tmp_data[BECH32_MAX_BYTES * 8 / 5];
+    const size_t tmp_size = bytes_to_5bits(tmp_data, data, data_len);
     bech32_encode(output, hrp, tmp_data, tmp_size);
 }
+
+size_t bech32_encode_batch(char *output,
+                           size_t output_stride,
+                           const char *hrp,
+                           const uint8_t *data,
+                           size_t data_len,
+                           size_t count) {
+    uint32_t chk;
+    size_t hrp_len;
+    if (data_len > BECH32_MAX_BYTES || !bech32_hrp_checksum(&chk, &hrp_len, hrp)) {
+        return 0;
+    }
+
+    uint8_t tmp_data[BECH32_MAX_BYTES * 8 / 5];
+    size_t i;
+    for (i = 0; i < count; i++) {
+        char *out = output + i * output_stride;
+        const size_t tmp_size = bytes_to_5bits(tmp_data, data + i * data_len, data_len);
+        if (hrp_len + tmp_size + 8 > output_stride) {
+            break;
+        }
+        for (size_t j = 0; j < hrp_len; j++) {
+            out[j] = hrp[j];
+        }
+        out[hrp_len] = '1';
+        if (!bech32_encode_data(out + hrp_len + 1, chk, hrp_len, tmp_data, tmp_size)) {
+            out[0] = 0;
+            break;
+        }
+    }
+    return i;
+}
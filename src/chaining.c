@@ -0,0 +1,197 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "chaining.h"
+#include "os.h"
+#include "os_io_seproxyhal.h"
+#include "apdu_codes.h"
+#include "buffering.h"
+#include "zxmacros.h"
+
+#include "app_main.h"
+#include "libxmss/nvram.h"
+
+#define CHAIN_INS_NONE  0xFF
+
+typedef struct {
+    uint8_t ins;
+    uint8_t in_index;
+    uint8_t in_count;
+    uint8_t out_index;
+    uint8_t out_count;
+    chain_reader_t reader;                  // NULL when the response is in the buffer
+    uint16_t out_size;                      // only set with a reader
+} chain_state_t;
+
+chain_state_t chain;
+
+static void chain_buffer_init() {
+    // chain_ram overlays the signature context
+    sig_in_progress = 0;
+    // The xmss signature area in flash is not used by the incremental signer
+    buffering_init(ctx.chain_ram,
+                   sizeof(ctx.chain_ram),
+                   (uint8_t *) N_XMSS_DATA.signature.raw,
+                   sizeof(N_XMSS_DATA.signature.raw));
+    // Packets are not page sized, stage them so each flash page is written once
+    buffering_set_flush_batching(1);
+}
+
+void chain_reset() {
+    chain.ins = CHAIN_INS_NONE;
+    chain.in_index = 0;
+    chain.in_count = 0;
+    chain.out_index = 0;
+    chain.out_count = 0;
+    chain.reader = NULL;
+    chain.out_size = 0;
+}
+
+uint8_t chain_ins() {
+    return chain.ins;
+}
+
+uint8_t chain_receive(uint32_t rx) {
+    if (rx < OFFSET_DATA) {
+        chain_reset();
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+
+    const uint8_t ins = G_io_apdu_buffer[OFFSET_INS];
+    uint8_t pck_index = G_io_apdu_buffer[OFFSET_PCK_INDEX];
+    uint8_t pck_count = G_io_apdu_buffer[OFFSET_PCK_COUNT];
+
+    if (pck_count == 0) {
+        pck_index = 1;
+        pck_count = 1;
+    }
+
+    if (pck_index == 0 || pck_index > pck_count) {
+        chain_reset();
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    if (pck_index == 1) {
+        chain_reset();
+        chain_buffer_init();
+        chain.ins = ins;
+        chain.in_count = pck_count;
+    } else if (ins != chain.ins || pck_count != chain.in_count || pck_index != chain.in_index + 1) {
+        chain_reset();
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+    chain.in_index = pck_index;
+
+    const int length = (int) (rx - OFFSET_DATA);
+    if (length > 0 && buffering_append(G_io_apdu_buffer + OFFSET_DATA, length) != length) {
+        chain_reset();
+        THROW(APDU_CODE_OUTPUT_BUFFER_TOO_SMALL);
+    }
+
+    return pck_index == pck_count;
+}
+
+const uint8_t *chain_get_data() {
+    buffering_flush();
+    return buffering_get_buffer()->data;
+}
+
+uint16_t chain_get_size() {
+    return buffering_get_buffer()->pos;
+}
+
+void chain_response_reset() {
+    chain_buffer_init();
+    chain.out_index = 0;
+    chain.out_count = 0;
+    chain.reader = NULL;
+    chain.out_size = 0;
+}
+
+void chain_response_append(const uint8_t *data, uint16_t length) {
+    if (buffering_append((uint8_t *) data, length) != length) {
+        chain_reset();
+        THROW(APDU_CODE_OUTPUT_BUFFER_TOO_SMALL);
+    }
+}
+
+static uint16_t chain_response_size() {
+    return chain.reader != NULL ? chain.out_size : buffering_get_buffer()->pos;
+}
+
+static void chain_response_page(volatile uint32_t *tx, uint8_t page) {
+    if (page == 0 || page > chain.out_count) {
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    const uint16_t offset = (uint16_t) (page - 1) * CHAIN_PAGE_SIZE;
+    uint16_t length = chain_response_size() - offset;
+    if (length > CHAIN_PAGE_SIZE) {
+        length = CHAIN_PAGE_SIZE;
+    }
+
+    G_io_apdu_buffer[0] = page;
+    G_io_apdu_buffer[1] = chain.out_count;
+    if (chain.reader != NULL) {
+        chain.reader(G_io_apdu_buffer + 2, offset, length);
+    } else {
+        MEMMOVE(G_io_apdu_buffer + 2, buffering_get_buffer()->data + offset, length);
+    }
+    *tx += 2 + length;
+
+    chain.out_index = page;
+}
+
+static void chain_response_first_page(volatile uint32_t *tx) {
+    const uint16_t size = chain_response_size();
+    chain.out_count = size == 0 ? 1 : (uint8_t) ((size + CHAIN_PAGE_SIZE - 1) / CHAIN_PAGE_SIZE);
+    chain_response_page(tx, 1);
+}
+
+void chain_response_send(volatile uint32_t *tx) {
+    buffering_flush();
+    chain.reader = NULL;
+    chain_response_first_page(tx);
+}
+
+void chain_response_send_reader(volatile uint32_t *tx, chain_reader_t reader, uint16_t size) {
+    chain.reader = reader;
+    chain.out_size = size;
+    chain.out_index = 0;
+    chain_response_first_page(tx);
+}
+
+void chain_next_page(volatile uint32_t *tx, uint32_t rx) {
+    if (rx < 5) {
+        THROW(APDU_CODE_WRONG_LENGTH);
+    }
+    if (chain.out_count == 0) {
+        THROW(APDU_CODE_COMMAND_NOT_ALLOWED);
+    }
+
+    const uint8_t p1 = G_io_apdu_buffer[2];
+    const uint8_t p2 = G_io_apdu_buffer[3];
+    const uint8_t *data = G_io_apdu_buffer + 5;
+
+    UNUSED(p2);
+    UNUSED(data);
+
+    // Pages must be read in order, the last one can be requested again
+    if (p1 != chain.out_index && p1 != chain.out_index + 1) {
+        THROW(APDU_CODE_DATA_INVALID);
+    }
+
+    chain_response_page(tx, p1);
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+#include <stdint.h>
+
+// Requests and responses up to this size stay in RAM, the rest goes to flash
+#define CHAIN_RAM_SIZE      256
+// Response bytes per page, after the [index, count] page header
+#define CHAIN_PAGE_SIZE     248
+
+/// Drop any request or response in progress
+void chain_reset();
+
+/// INS of the chained command in progress
+uint8_t chain_ins();
+
+/// Append a request packet. P1/P2 are packet index and count, a count of 0 means single packet.
+/// \return 1 when the whole request has been received
+uint8_t chain_receive(uint32_t rx);
+
+/// Reassembled request
+const uint8_t *chain_get_data();
+uint16_t chain_get_size();
+
+/// Start a new response. It reuses the request buffer
+void chain_response_reset();
+
+/// Append to the response
+void chain_response_append(const uint8_t *data, uint16_t length);
+
+/// Send the first page of the response
+void chain_response_send(volatile uint32_t *tx);
+
+/// Copies length bytes of a response from offset
+typedef void (*chain_reader_t)(uint8_t *out, uint16_t offset, uint16_t length);
+
+/// Send the first page of a response produced by reader, e.g. from NVRAM, so
+/// it is not copied to the response buffer
+void chain_response_send_reader(volatile uint32_t *tx, chain_reader_t reader, uint16_t size);
+
+/// Send the page requested by INS_NEXT_PAGE
+void chain_next_page(volatile uint32_t *tx, uint32_t rx);
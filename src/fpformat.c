@@ -0,0 +1,127 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "fpformat.h"
+
+// Division by 10 per digit means a 64-bit libcall per digit on Cortex-M0.
+// Here the value is split in 8 digit chunks with reciprocal multiplications
+// and the chunks are written two digits at a time
+static const char digit_pairs[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+#define UINT64_DIGITS 20
+
+static uint64_t mulhi64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t) (((unsigned __int128) a * b) >> 64);
+#else
+    const uint64_t a_lo = (uint32_t) a;
+    const uint64_t a_hi = a >> 32;
+    const uint64_t b_lo = (uint32_t) b;
+    const uint64_t b_hi = b >> 32;
+    const uint64_t hi_lo = a_hi * b_lo;
+    const uint64_t cross = ((a_lo * b_lo) >> 32) + (uint32_t) hi_lo + a_lo * b_hi;
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+// value / 10^8, exact for every 64-bit value
+static uint64_t div_1e8(uint64_t value) {
+    return mulhi64(value, 0xABCC77118461CEFDULL) >> 26;
+}
+
+static void write_pair(char *dst, uint32_t pair) {
+    dst[0] = digit_pairs[2 * pair];
+    dst[1] = digit_pairs[2 * pair + 1];
+}
+
+// 4 digits of y < 10^4, y / 100 as a multiplication
+static void write4(char *dst, uint32_t y) {
+    const uint32_t hi = (y * 5243) >> 19;
+    write_pair(dst, hi);
+    write_pair(dst + 2, y - hi * 100);
+}
+
+// 8 digits of x < 10^8
+static void write8(char *dst, uint32_t x) {
+    const uint32_t hi = (uint32_t) (((uint64_t) x * 109951163) >> 40);
+    write4(dst, hi);
+    write4(dst + 4, x - hi * 10000);
+}
+
+// All 20 digits, zero padded. Returns the number of significant digits
+static size_t write20(char *dst, uint64_t value) {
+    const uint64_t q1 = div_1e8(value);
+    const uint64_t q2 = div_1e8(q1);
+    write4(dst, (uint32_t) q2);
+    write8(dst + 4, (uint32_t) (q1 - q2 * 100000000));
+    write8(dst + 12, (uint32_t) (value - q1 * 100000000));
+
+    size_t lead = 0;
+    while (lead < UINT64_DIGITS - 1 && dst[lead] == '0') {
+        lead++;
+    }
+    return UINT64_DIGITS - lead;
+}
+
+size_t uint64_to_dec(char *dst, uint64_t value) {
+    char tmp[UINT64_DIGITS];
+    const size_t n = write20(tmp, value);
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = tmp[UINT64_DIGITS - n + i];
+    }
+    dst[n] = 0;
+    return n;
+}
+
+size_t fpuint64_format(char *dst, uint64_t value, uint8_t decimals) {
+    char tmp[UINT64_DIGITS];
+    const size_t n = write20(tmp, value);
+    char *p = dst;
+
+    if (n <= decimals) {
+        *p++ = '0';
+    } else {
+        for (size_t i = UINT64_DIGITS - n; i < (size_t) (UINT64_DIGITS - decimals); i++) {
+            *p++ = tmp[i];
+        }
+    }
+    *p++ = '.';
+
+    size_t frac = decimals;
+    for (; frac > UINT64_DIGITS; frac--) {
+        *p++ = '0';
+    }
+    for (size_t i = UINT64_DIGITS - frac; i < UINT64_DIGITS; i++) {
+        *p++ = tmp[i];
+    }
+    *p = 0;
+    return (size_t) (p - dst);
+}
+
+void fpuint64_format_batch(char *dst, size_t stride, const uint64_t *values, size_t count, uint8_t decimals) {
+    for (size_t i = 0; i < count; i++) {
+        fpuint64_format(dst + i * stride, values[i], decimals);
+    }
+}
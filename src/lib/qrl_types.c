@@ -16,61 +16,42 @@
 
 #include <shash.h>
 #include "qrl_types.h"
+#include <stddef.h>
 
-#define PTR_DIST(p2, p1) (int16_t)(((int8_t *)(p2)) - ((int8_t *)(p1)))
+#define QRLTX_SCHEMA(TYPE, ITEMS, ITEM_TYPE, ITEM_MAX) \
+    { TYPE, offsetof(qrltx_t, ITEMS), sizeof(ITEM_TYPE), ITEM_MAX, offsetof(qrltx_t, tx.master.amount) }
 
-int16_t get_qrltx_size(const qrltx_t *tx_p) {
-    if (tx_p->subitem_count == 0) {
-        return -1;
-    }
-
-    uint16_t req_size = 1;
-    // validate sizes
-    switch (tx_p->type) {
-        case QRLTX_TX: {
-            if (tx_p->subitem_count > QRLTX_SUBITEM_MAX) {
-                return -1;
-            }
-
-            const int16_t delta = PTR_DIST(&tx_p->tx.dst, tx_p);
-            req_size = delta + sizeof(qrltx_addr_block) * tx_p->subitem_count;
-            break;
-        }
+static const qrltx_schema_t qrltx_schemas[] = {
+        QRLTX_SCHEMA(QRLTX_TX, tx.dst, qrltx_addr_block, QRLTX_SUBITEM_MAX),
 #ifdef TXTOKEN_ENABLED
-        case QRLTX_TXTOKEN: {
-            if (tx_p->subitem_count > QRLTX_SUBITEM_MAX) {
-                return -1;
-            }
-
-            const int16_t delta = PTR_DIST(&tx_p->txtoken.dst, tx_p);
-            req_size = delta + sizeof(qrltx_addr_block) * tx_p->subitem_count;
-            break;
-        }
+        QRLTX_SCHEMA(QRLTX_TXTOKEN, txtoken.dst, qrltx_addr_block, QRLTX_SUBITEM_MAX),
 #endif
 #ifdef SLAVE_ENABLED
-        case QRLTX_SLAVE: {
-            if (tx_p->subitem_count > QRLTX_SUBITEM_MAX) {
-                return -1;
-            }
-
-            const int16_t delta = PTR_DIST(&tx_p->slave.slaves, tx_p);
-            req_size = delta + sizeof(qrltx_addr_block) * tx_p->subitem_count;
-            break;
-        }
+        QRLTX_SCHEMA(QRLTX_SLAVE, slave.slaves, qrltx_slave_block, QRLTX_SUBITEM_MAX),
 #endif
-        case QRLTX_MESSAGE: {
-            if (tx_p->subitem_count > QRLTX_MESSAGE_SUBITEM_MAX) {
-                return -1;
-            }
+        QRLTX_SCHEMA(QRLTX_MESSAGE, msg.message, uint8_t, QRLTX_MESSAGE_SUBITEM_MAX),
+};
 
-            const int16_t delta = PTR_DIST(&tx_p->msg.message, tx_p);
-            req_size = delta + sizeof(uint8_t) * tx_p->subitem_count;
-            break;
+const qrltx_schema_t *get_qrltx_schema(uint8_t type) {
+    for (uint8_t i = 0; i < sizeof(qrltx_schemas) / sizeof(qrltx_schemas[0]); i++) {
+        if (qrltx_schemas[i].type == type) {
+            return &qrltx_schemas[i];
         }
-        default:
-            break;
     }
-    return req_size;
+    return NULL;
+}
+
+int16_t get_qrltx_size(const qrltx_t *tx_p) {
+    if (tx_p->subitem_count == 0) {
+        return -1;
+    }
+
+    const qrltx_schema_t *schema = get_qrltx_schema(tx_p->type);
+    if (schema == NULL || tx_p->subitem_count > schema->item_max) {
+        return -1;
+    }
+
+    return schema->items_offset + (int16_t) schema->item_size * tx_p->subitem_count;
 }
 
 int8_t get_qrltx_hash(const qrltx_t *tx_p, uint8_t hash[32]) {
@@ -82,10 +63,127 @@ int8_t get_qrltx_hash(const qrltx_t *tx_p, uint8_t hash[32]) {
     uint8_t *p = ((uint8_t *) tx_p);
 
     // skip metadata and source address
-    p += 2 + 39;
-    in_len -= 2 + 39;
+    const uint8_t hash_offset = get_qrltx_schema(tx_p->type)->hash_offset;
+    p += hash_offset;
+    in_len -= hash_offset;
 
     __sha256(hash, p, (uint16_t) in_len);
 
     return 0;
 }
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+static int8_t qrltx_stream_layout(const qrltx_t *tx_p, qrltx_stream_t *s) {
+    if (tx_p->subitem_count == 0) {
+        return -1;
+    }
+
+    s->schema = get_qrltx_schema(tx_p->type);
+    if (s->schema == NULL) {
+        return -1;
+    }
+
+    s->size = s->schema->items_offset + (uint16_t) s->schema->item_size * tx_p->subitem_count;
+    return 0;
+}
+
+// items that have been completely received
+static uint8_t qrltx_stream_complete(const qrltx_stream_t *s) {
+    if (s->size == 0 || s->offset <= s->schema->items_offset) {
+        return 0;
+    }
+    return (uint8_t) ((s->offset - s->schema->items_offset) / s->schema->item_size);
+}
+
+void qrltx_stream_init(qrltx_stream_t *s) {
+    MEMSET(s, 0, sizeof(qrltx_stream_t));
+    __sha256_init(&s->sha);
+}
+
+int8_t qrltx_stream_append(qrltx_t *tx_p, qrltx_stream_t *s, const uint8_t *data, uint16_t len) {
+    uint8_t *raw = (uint8_t *) tx_p;
+
+    if (qrltx_stream_done(s)) {
+        return -1;
+    }
+
+    // Move the window so that it starts at the first incomplete item
+    const uint8_t complete = qrltx_stream_complete(s);
+    if (complete > s->item_base) {
+        const qrltx_schema_t *schema = s->schema;
+        const uint8_t partial = (uint8_t) ((s->offset - schema->items_offset) % schema->item_size);
+        uint8_t *window = raw + schema->items_offset;
+        MEMMOVE(window, window + (complete - s->item_base) * schema->item_size, partial);
+        s->item_base = complete;
+    }
+
+    while (len > 0) {
+        uint16_t n;
+        uint8_t *dst;
+
+        if (s->size == 0) {
+            // type and subitem count
+            raw[s->offset++] = *data++;
+            len--;
+            if (s->offset == 2 && qrltx_stream_layout(tx_p, s) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (s->offset >= s->size) {
+            return -1;
+        }
+
+        const qrltx_schema_t *schema = s->schema;
+        if (s->offset < schema->items_offset) {
+            n = schema->items_offset - s->offset;
+            dst = raw + s->offset;
+        } else {
+            const uint16_t rel = s->offset - schema->items_offset;
+            const uint16_t slot = rel / schema->item_size - s->item_base;
+            if (slot >= schema->item_max) {
+                return -1;
+            }
+            n = schema->item_size - rel % schema->item_size;
+            dst = raw + schema->items_offset + slot * schema->item_size + rel % schema->item_size;
+        }
+        if (n > len) {
+            n = len;
+        }
+
+        MEMCPY(dst, data, n);
+
+        if (s->offset + n > schema->hash_offset) {
+            const uint16_t skip = s->offset < schema->hash_offset ? schema->hash_offset - s->offset : 0;
+            __sha256_update(&s->sha, data + skip, n - skip);
+        }
+
+        s->offset += n;
+        data += n;
+        len -= n;
+    }
+
+    if (qrltx_stream_done(s)) {
+        uint8_t hash[32];
+        __sha256_final(&s->sha, hash);
+        MEMCPY(s->hash, hash, 32);
+    }
+
+    return 0;
+}
+
+// every fixed field (source address, fee, token hash) has been received
+uint8_t qrltx_stream_header_done(const qrltx_stream_t *s) {
+    return s->size != 0 && s->offset >= s->schema->items_offset;
+}
+
+uint8_t qrltx_stream_done(const qrltx_stream_t *s) {
+    return s->size != 0 && s->offset == s->size;
+}
+
+uint8_t qrltx_stream_items(const qrltx_stream_t *s) {
+    return qrltx_stream_complete(s) - s->item_base;
+}
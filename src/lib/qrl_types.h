@@ -20,6 +20,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <shash.h>
 // QRL TX definitions
 
 #define QRLTX_TX (0)
@@ -40,6 +41,7 @@ typedef struct {
 
 /////////////////////////////////////////
 
+// Items held in RAM at once. When a tx is streamed this is the limit per packet
 #define QRLTX_SUBITEM_MAX 3
 #define QRLTX_MESSAGE_SUBITEM_MAX 80
 #define QUANTA_DECIMALS 9
@@ -79,9 +81,41 @@ typedef struct {
 } qrltx_t;                                                  // 222 bytes
 #pragma pack(pop)
 
+// Layout of a tx type: fixed fields followed by subitem_count items
+typedef struct {
+    uint8_t type;
+    uint8_t items_offset;                                   // from the start of qrltx_t
+    uint8_t item_size;
+    uint8_t item_max;                                       // items held in RAM at once
+    uint8_t hash_offset;                                    // hashed bytes start here
+} qrltx_schema_t;
+
+// Streaming parser state. Header fields stay at their qrltx_t offsets while
+// subitems are kept in a window that is moved forward on every packet.
+// Not packed: sha is handed to cx_hash and schema is a pointer, both need word alignment
+typedef struct {
+    union {
+        sha256_ctx_t sha;                                   // while receiving
+        uint8_t hash[32];                                   // once complete
+    };
+    uint16_t offset;                                        // bytes received
+    uint16_t size;                                          // 0 until the header is known
+    const qrltx_schema_t *schema;
+    uint8_t item_base;                                      // first item in the window
+    uint8_t pck_index;
+    uint8_t pck_count;
+} qrltx_stream_t;
+
+const qrltx_schema_t *get_qrltx_schema(uint8_t type);
 int16_t get_qrltx_size(const qrltx_t *tx_p);
 int8_t get_qrltx_hash(const qrltx_t *tx_p, uint8_t hash[32]);
 
+void qrltx_stream_init(qrltx_stream_t *s);
+int8_t qrltx_stream_append(qrltx_t *tx_p, qrltx_stream_t *s, const uint8_t *data, uint16_t len);
+uint8_t qrltx_stream_header_done(const qrltx_stream_t *s);
+uint8_t qrltx_stream_done(const qrltx_stream_t *s);
+uint8_t qrltx_stream_items(const qrltx_stream_t *s);
+
 #ifdef __cplusplus
 }
 #endif
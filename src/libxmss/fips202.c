@@ -455,6 +455,40 @@ void shake128_squeezeblocks_ledger(unsigned char* output, unsigned long long nbl
     keccak_squeezeblocks_ledger(output, nblocks, s, SHAKE128_RATE);
 }
 
+/*************************************************
+* Name:        shake128
+*
+* Description: SHAKE128 XOF with non-incremental API
+*
+* Arguments:   - unsigned char *output:      pointer to output
+*              - unsigned long long outlen:  requested output length in bytes
+               - const unsigned char *input: pointer to input
+               - unsigned long long inlen:   length of input in bytes
+**************************************************/
+void shake128(unsigned char* output, unsigned long long outlen,
+        const unsigned char* input, unsigned long long inlen)
+{
+    uint64_t s[25];
+    unsigned char t[SHAKE128_RATE];
+    unsigned long long nblocks = outlen/SHAKE128_RATE;
+    size_t i;
+
+    /* Absorb input */
+    keccak_absorb_ledger(s, SHAKE128_RATE, input, inlen, 0x1F);
+
+    /* Squeeze output */
+    keccak_squeezeblocks_ledger(output, nblocks, s, SHAKE128_RATE);
+
+    output += nblocks*SHAKE128_RATE;
+    outlen -= nblocks*SHAKE128_RATE;
+
+    if (outlen) {
+        keccak_squeezeblocks_ledger(t, 1, s, SHAKE128_RATE);
+        for (i = 0; i<outlen; i++)
+            output[i] = t[i];
+    }
+}
+
 /*************************************************
 * Name:        shake256
 *
@@ -11,6 +11,7 @@
 void shake128_absorb(uint64_t *s, const unsigned char *input, unsigned int inputByteLen);
 void shake128_squeezeblocks(unsigned char *output, unsigned long long nblocks, uint64_t *s);
 
+void shake128(unsigned char *output, unsigned long long outlen, const unsigned char *input,  unsigned long long inlen);
 void shake256(unsigned char *output, unsigned long long outlen, const unsigned char *input,  unsigned long long inlen);
 void sha3_256(unsigned char *output, const unsigned char *input,  unsigned long long inlen);
 void sha3_512(unsigned char *output, const unsigned char *input,  unsigned long long inlen);
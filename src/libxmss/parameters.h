@@ -27,4 +27,4 @@
 #define XMSS_SIGSIZE       (4+32+WOTS_SIGSIZE+XMSS_AUTHPATHSIZE)
 #define XMSS_DIGESTSIZE    (2*WOTS_N)
 #define XMSS_PKSIZE        (2+WOTS_N)
-#define XMSS_SKSIZE        (4+WOTS_N*4)
+#define XMSS_SKSIZE        (4+WOTS_N*4+1)
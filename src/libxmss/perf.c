@@ -0,0 +1,71 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#include "perf.h"
+
+#ifdef TESTING_ENABLED
+
+perf_stats_t perf_stats;
+
+void perf_reset() {
+    MEMSET(&perf_stats, 0, sizeof(perf_stats));
+}
+
+#ifdef LEDGER_SPECIFIC
+void __wrap_nvm_write(void *dst, void *src, unsigned int len) {
+    PERF_ADD(nvm_writes, 1);
+    PERF_ADD(nvm_bytes, len);
+    __real_nvm_write(dst, src, len);
+}
+
+#define STACK_PAINT         0xA5u
+#define STACK_PAINT_MARGIN  64      // left untouched below the painter's own frame
+
+#ifdef PERF_STACK_EXTERNAL
+uintptr_t perf_stack_base;
+uintptr_t perf_stack_top;
+#define STACK_BASE perf_stack_base
+#define STACK_TOP  perf_stack_top
+#else
+// Defined by script.ld, the stack sits between the canary and the end of SRAM
+extern unsigned int app_stack_canary;
+extern unsigned int _estack;
+#define STACK_BASE ((uintptr_t) &app_stack_canary + sizeof(app_stack_canary))
+#define STACK_TOP  ((uintptr_t) &_estack)
+#endif
+
+// Addresses are kept as integers, they are compared and never dereferenced
+#define FRAME_ADDRESS() ((uintptr_t) __builtin_frame_address(0))
+
+// Deepest frame seen by perf_stack_sample, 0 until the stack is painted
+static uintptr_t stack_lowest;
+
+void perf_stack_paint() {
+    const uintptr_t end = FRAME_ADDRESS() - STACK_PAINT_MARGIN;
+
+    // A plain loop, MEMSET would run with its own frame below this one
+    for (uintptr_t a = STACK_BASE; a < end; a++) {
+        *(volatile uint8_t *) a = STACK_PAINT;
+    }
+    stack_lowest = FRAME_ADDRESS();
+}
+
+void perf_stack_sample() {
+    const uintptr_t frame = FRAME_ADDRESS();
+    if (frame < stack_lowest) {
+        stack_lowest = frame;
+    }
+}
+
+void perf_stack_read(perf_stack_t *out) {
+    uintptr_t a = STACK_BASE;
+    while (a < STACK_TOP && *(const volatile uint8_t *) a == STACK_PAINT) {
+        a++;
+    }
+
+    out->peak = (uint32_t) (STACK_TOP - a);
+    out->sampled = stack_lowest != 0 ? (uint32_t) (STACK_TOP - stack_lowest) : 0;
+    out->size = (uint32_t) (STACK_TOP - STACK_BASE);
+}
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#pragma once
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "zxmacros.h"
+
+// Performance counters, kept in RAM and read with INS_GET_STATS
+#define PERF_NUM_COUNTERS    8
+
+typedef union {
+    struct {
+        uint32_t ticks;             // ticker events, 100 ms each
+        uint32_t sha256_calls;
+        uint32_t sha256_bytes;
+        uint32_t nvm_writes;
+        uint32_t nvm_bytes;
+        uint32_t keygen_steps;
+        uint32_t signatures;
+        uint32_t sign_chunks;
+    };
+    uint32_t counter[PERF_NUM_COUNTERS];
+} perf_stats_t;
+
+#ifdef TESTING_ENABLED
+
+extern perf_stats_t perf_stats;
+
+#define PERF_ADD(FIELD, N) perf_stats.FIELD += (N)
+
+void perf_reset();
+
+#ifdef LEDGER_SPECIFIC
+// NVM writes are counted by wrapping nvm_write at link time (-Wl,--wrap=nvm_write),
+// so that the vendored zxlib sources (buffering.c) are counted without changes
+void __real_nvm_write(void *dst, void *src, unsigned int len);
+void __wrap_nvm_write(void *dst, void *src, unsigned int len);
+
+// Stack high-water mark, read with INS_TEST_STACK. perf_stack_paint fills the free
+// stack with a pattern; the deepest overwritten byte is the peak since then.
+// LOGSTACK() records the stack pointer at the deepest call sites (hash leaves).
+typedef struct {
+    uint32_t peak;          // bytes used, from the painted pattern
+    uint32_t sampled;       // bytes used, deepest LOGSTACK() sample
+    uint32_t size;          // bytes available to the app
+} perf_stack_t;
+
+void perf_stack_paint();
+
+void perf_stack_sample();
+
+void perf_stack_read(perf_stack_t *out);
+
+#ifdef PERF_STACK_EXTERNAL
+// Stack bounds as addresses, set by the host simulator before it enters the app
+extern uintptr_t perf_stack_base;
+extern uintptr_t perf_stack_top;
+#endif
+
+#undef LOGSTACK
+#define LOGSTACK() perf_stack_sample()
+#endif
+
+#else
+#define PERF_ADD(FIELD, N)
+
+#ifdef LEDGER_SPECIFIC
+// __logstack is only in zxlib debug builds
+#undef LOGSTACK
+#define LOGSTACK()
+#endif
+#endif
+
+#ifdef  __cplusplus
+}
+#endif
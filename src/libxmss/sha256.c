@@ -0,0 +1,125 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#include "sha256.h"
+
+#ifndef LEDGER_SPECIFIC
+#include <string.h>
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32u - (n))))
+
+static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void sha256_portable_compress(uint32_t state[8], const uint8_t block[64]) {
+    // 16 word rolling schedule, keeps the frame small on Cortex-M
+    uint32_t w[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        w[i] = ((uint32_t) block[4 * i] << 24) | ((uint32_t) block[4 * i + 1] << 16) |
+               ((uint32_t) block[4 * i + 2] << 8) | (uint32_t) block[4 * i + 3];
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (uint8_t i = 0; i < 64; i++) {
+        if (i >= 16) {
+            const uint32_t w15 = w[(i + 1) & 15u];
+            const uint32_t w2 = w[(i + 14) & 15u];
+            const uint32_t s0 = ROR(w15, 7) ^ ROR(w15, 18) ^ (w15 >> 3);
+            const uint32_t s1 = ROR(w2, 17) ^ ROR(w2, 19) ^ (w2 >> 10);
+            w[i & 15u] += s0 + w[(i + 9) & 15u] + s1;
+        }
+
+        const uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i & 15u];
+        const uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void sha256_portable_init(sha256_portable_t *c) {
+    memcpy(c->state, H0, sizeof(H0));
+    c->length = 0;
+}
+
+void sha256_portable_update(sha256_portable_t *c, const uint8_t *in, uint32_t in_len) {
+    uint32_t used = (uint32_t) (c->length & 63u);
+    c->length += in_len;
+
+    if (used > 0) {
+        const uint32_t n = in_len < 64 - used ? in_len : 64 - used;
+        memcpy(c->block + used, in, n);
+        in += n;
+        in_len -= n;
+        if (used + n < 64) {
+            return;
+        }
+        sha256_portable_compress(c->state, c->block);
+    }
+
+    // whole blocks are hashed in place
+    for (; in_len >= 64; in += 64, in_len -= 64) {
+        sha256_portable_compress(c->state, in);
+    }
+    memcpy(c->block, in, in_len);
+}
+
+void sha256_portable_final(sha256_portable_t *c, uint8_t out[32]) {
+    const uint64_t bits = c->length << 3u;
+    uint32_t used = (uint32_t) (c->length & 63u);
+
+    c->block[used++] = 0x80;
+    if (used > 56) {
+        memset(c->block + used, 0, 64 - used);
+        sha256_portable_compress(c->state, c->block);
+        used = 0;
+    }
+    memset(c->block + used, 0, 56 - used);
+    for (uint8_t i = 0; i < 8; i++) {
+        c->block[56 + i] = (uint8_t) (bits >> (56u - 8u * i));
+    }
+    sha256_portable_compress(c->state, c->block);
+
+    for (uint8_t i = 0; i < 8; i++) {
+        out[4 * i] = (uint8_t) (c->state[i] >> 24);
+        out[4 * i + 1] = (uint8_t) (c->state[i] >> 16);
+        out[4 * i + 2] = (uint8_t) (c->state[i] >> 8);
+        out[4 * i + 3] = (uint8_t) c->state[i];
+    }
+}
+
+void sha256_portable(uint8_t out[32], const uint8_t *in, uint32_t in_len) {
+    sha256_portable_t c;
+    sha256_portable_init(&c);
+    sha256_portable_update(&c, in, in_len);
+    sha256_portable_final(&c, out);
+}
+
+#endif
@@ -0,0 +1,32 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef LEDGER_SPECIFIC
+
+// Plain C SHA-256, used by XMSS_PORTABLE builds that have neither cx nor OpenSSL
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;        // bytes hashed so far
+    uint8_t block[64];
+} sha256_portable_t;
+
+void sha256_portable_init(sha256_portable_t *c);
+
+void sha256_portable_update(sha256_portable_t *c, const uint8_t *in, uint32_t in_len);
+
+void sha256_portable_final(sha256_portable_t *c, uint8_t out[32]);
+
+void sha256_portable(uint8_t out[32], const uint8_t *in, uint32_t in_len);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#include "sha256_mb.h"
+
+#ifndef LEDGER_SPECIFIC
+#include <string.h>
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32u - (n))))
+
+static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+typedef uint32_t lanes_t[SHA256_MB_LANES];
+
+static void sha256_mb_compress(lanes_t state[8], uint8_t blocks[SHA256_MB_LANES][64]) {
+    lanes_t w[64];
+    lanes_t a, b, c, d, e, f, g, h;
+
+    for (uint8_t t = 0; t < 16; t++) {
+        for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+            const uint8_t *p = blocks[l] + 4 * t;
+            w[t][l] = (uint32_t) p[0] << 24u | (uint32_t) p[1] << 16u | (uint32_t) p[2] << 8u | p[3];
+        }
+    }
+    for (uint8_t t = 16; t < 64; t++) {
+        for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+            const uint32_t s0 = ROR(w[t - 15][l], 7u) ^ ROR(w[t - 15][l], 18u) ^ (w[t - 15][l] >> 3u);
+            const uint32_t s1 = ROR(w[t - 2][l], 17u) ^ ROR(w[t - 2][l], 19u) ^ (w[t - 2][l] >> 10u);
+            w[t][l] = w[t - 16][l] + s0 + w[t - 7][l] + s1;
+        }
+    }
+
+    memcpy(a, state[0], sizeof(lanes_t));
+    memcpy(b, state[1], sizeof(lanes_t));
+    memcpy(c, state[2], sizeof(lanes_t));
+    memcpy(d, state[3], sizeof(lanes_t));
+    memcpy(e, state[4], sizeof(lanes_t));
+    memcpy(f, state[5], sizeof(lanes_t));
+    memcpy(g, state[6], sizeof(lanes_t));
+    memcpy(h, state[7], sizeof(lanes_t));
+
+    for (uint8_t t = 0; t < 64; t++) {
+        for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+            const uint32_t s1 = ROR(e[l], 6u) ^ ROR(e[l], 11u) ^ ROR(e[l], 25u);
+            const uint32_t ch = (e[l] & f[l]) ^ (~e[l] & g[l]);
+            const uint32_t t1 = h[l] + s1 + ch + K[t] + w[t][l];
+            const uint32_t s0 = ROR(a[l], 2u) ^ ROR(a[l], 13u) ^ ROR(a[l], 22u);
+            const uint32_t maj = (a[l] & b[l]) ^ (a[l] & c[l]) ^ (b[l] & c[l]);
+            h[l] = g[l];
+            g[l] = f[l];
+            f[l] = e[l];
+            e[l] = d[l] + t1;
+            d[l] = c[l];
+            c[l] = b[l];
+            b[l] = a[l];
+            a[l] = t1 + s0 + maj;
+        }
+    }
+
+    for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+        state[0][l] += a[l];
+        state[1][l] += b[l];
+        state[2][l] += c[l];
+        state[3][l] += d[l];
+        state[4][l] += e[l];
+        state[5][l] += f[l];
+        state[6][l] += g[l];
+        state[7][l] += h[l];
+    }
+}
+
+void sha256_mb(uint8_t *const out[], const uint8_t *const in[], uint16_t in_len, uint8_t lanes) {
+    lanes_t state[8];
+    uint8_t blocks[SHA256_MB_LANES][64];
+
+    if (lanes == 0 || lanes > SHA256_MB_LANES) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+            state[i][l] = H0[i];
+        }
+    }
+
+    // all messages have the same length so padding is identical for every lane
+    const uint32_t num_blocks = ((uint32_t) in_len + 9u + 63u) / 64u;
+    const uint64_t bitlen = (uint64_t) in_len * 8u;
+
+    for (uint32_t blk = 0; blk < num_blocks; blk++) {
+        const uint32_t offset = blk * 64u;
+
+        for (uint8_t l = 0; l < SHA256_MB_LANES; l++) {
+            // unused lanes just repeat the first message
+            const uint8_t *src = in[l < lanes ? l : 0];
+            uint8_t *dst = blocks[l];
+
+            if (offset + 64u <= in_len) {
+                memcpy(dst, src + offset, 64);
+                continue;
+            }
+
+            memset(dst, 0, 64);
+            if (offset < in_len) {
+                memcpy(dst, src + offset, in_len - offset);
+            }
+            if (offset <= in_len) {
+                dst[in_len - offset] = 0x80;
+            }
+            if (blk == num_blocks - 1) {
+                for (uint8_t i = 0; i < 8; i++) {
+                    dst[63 - i] = (uint8_t) (bitlen >> (8u * i));
+                }
+            }
+        }
+
+        sha256_mb_compress(state, blocks);
+    }
+
+    for (uint8_t l = 0; l < lanes; l++) {
+        for (uint8_t i = 0; i < 8; i++) {
+            out[l][4 * i + 0] = (uint8_t) (state[i][l] >> 24u);
+            out[l][4 * i + 1] = (uint8_t) (state[i][l] >> 16u);
+            out[l][4 * i + 2] = (uint8_t) (state[i][l] >> 8u);
+            out[l][4 * i + 3] = (uint8_t) state[i][l];
+        }
+    }
+}
+
+#endif
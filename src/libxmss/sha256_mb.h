@@ -0,0 +1,23 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef LEDGER_SPECIFIC
+
+#define SHA256_MB_LANES    8u
+
+// Hashes up to SHA256_MB_LANES messages of the same length at once.
+// Lanes are stored word-interleaved so the compression loops vectorize
+void sha256_mb(uint8_t *const out[], const uint8_t *const in[], uint16_t in_len, uint8_t lanes);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,5 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#include "shash.h"
+
+SHASH_THREAD_LOCAL uint8_t shash_func = SHASH_FUNC_SHA2_256;
@@ -8,8 +8,10 @@ extern "C" {
 
 #include <stdint.h>
 #include "zxmacros.h"
+#include "perf.h"
 #include "parameters.h"
 #include "adrs.h"
+#include "fips202.h"
 
 #pragma pack(push, 1)
 typedef union {
@@ -76,6 +78,28 @@ typedef union {
 #define SHASH_TYPE_HASH      2u
 #define SHASH_TYPE_PRF       3u
 
+// Hash functions as defined in the QRL address descriptor
+#define SHASH_FUNC_SHA2_256  0u
+#define SHASH_FUNC_SHAKE128  1u
+#define SHASH_FUNC_SHAKE256  2u
+
+// Hash function used by the tree that is being processed. Host builds hash on
+// several threads (wotsp_sign_mt, callers signing in parallel), there the
+// selection is per thread and every thread selects before it hashes.
+#if defined(LEDGER_SPECIFIC) || defined(XMSS_PORTABLE)
+#define SHASH_THREAD_LOCAL
+#elif defined(__cplusplus)
+#define SHASH_THREAD_LOCAL thread_local
+#else
+#define SHASH_THREAD_LOCAL _Thread_local
+#endif
+
+extern SHASH_THREAD_LOCAL uint8_t shash_func;
+
+__Z_INLINE void shash_select(uint8_t func) {
+    shash_func = func;
+}
+
 #ifndef LEDGER_SPECIFIC
 #include <stdio.h>
 __Z_INLINE void dump_hex(const char *prefix, uint8_t *data, uint16_t size) {
@@ -105,28 +129,104 @@ __Z_INLINE void memxor(uint8_t *in_out, const uint8_t *in, const uint8_t count)
 #include "cx.h"
 __Z_INLINE void __sha256(uint8_t *out, const uint8_t* in, uint16_t in_len)
 {
+    PERF_ADD(sha256_calls, 1);
+    PERF_ADD(sha256_bytes, in_len);
     cx_hash_sha256(in, in_len, out, 32);
 }
 
+typedef cx_sha256_t sha256_ctx_t;
+
+__Z_INLINE void __sha256_init(sha256_ctx_t *c) {
+    cx_sha256_init(c);
+}
+
+__Z_INLINE void __sha256_update(sha256_ctx_t *c, const uint8_t *in, uint16_t in_len) {
+    PERF_ADD(sha256_bytes, in_len);
+    cx_hash(&c->header, 0, in, in_len, NULL, 0);
+}
+
+__Z_INLINE void __sha256_final(sha256_ctx_t *c, uint8_t *out) {
+    PERF_ADD(sha256_calls, 1);
+    cx_hash(&c->header, CX_LAST, NULL, 0, out, 32);
+}
+
+#elif defined(XMSS_PORTABLE)
+
+#include "sha256.h"
+__Z_INLINE void __sha256(uint8_t *out, const uint8_t *in, uint16_t in_len) {
+    PERF_ADD(sha256_calls, 1);
+    PERF_ADD(sha256_bytes, in_len);
+    sha256_portable(out, in, in_len);
+}
+
+typedef sha256_portable_t sha256_ctx_t;
+
+__Z_INLINE void __sha256_init(sha256_ctx_t *c) {
+    sha256_portable_init(c);
+}
+
+__Z_INLINE void __sha256_update(sha256_ctx_t *c, const uint8_t *in, uint16_t in_len) {
+    PERF_ADD(sha256_bytes, in_len);
+    sha256_portable_update(c, in, in_len);
+}
+
+__Z_INLINE void __sha256_final(sha256_ctx_t *c, uint8_t *out) {
+    PERF_ADD(sha256_calls, 1);
+    sha256_portable_final(c, out);
+}
+
 #else
 
 #include <openssl/sha.h>
 __Z_INLINE void __sha256(uint8_t *out, const uint8_t *in, uint16_t in_len) {
+    PERF_ADD(sha256_calls, 1);
+    PERF_ADD(sha256_bytes, in_len);
     SHA256(in, in_len, out);
 }
 
+typedef SHA256_CTX sha256_ctx_t;
+
+__Z_INLINE void __sha256_init(sha256_ctx_t *c) {
+    SHA256_Init(c);
+}
+
+__Z_INLINE void __sha256_update(sha256_ctx_t *c, const uint8_t *in, uint16_t in_len) {
+    PERF_ADD(sha256_bytes, in_len);
+    SHA256_Update(c, in, in_len);
+}
+
+__Z_INLINE void __sha256_final(sha256_ctx_t *c, uint8_t *out) {
+    PERF_ADD(sha256_calls, 1);
+    SHA256_Final(out, c);
+}
+
 #endif
 
+__Z_INLINE void __shash(uint8_t *out, const uint8_t *in, uint16_t in_len) {
+    LOGSTACK();
+    switch (shash_func) {
+        case SHASH_FUNC_SHAKE128:
+            shake128(out, 32, in, in_len);
+            break;
+        case SHASH_FUNC_SHAKE256:
+            shake256(out, 32, in, in_len);
+            break;
+        default:
+            __sha256(out, in, in_len);
+            break;
+    }
+}
+
 __Z_INLINE void shash96(uint8_t *out, const shash_input_t *in) {
-    __sha256(out, in->raw, 96);
+    __shash(out, in->raw, 96);
 }
 
 __Z_INLINE void shash128_shifted(uint8_t *out, const hashh_t *in) {
-    __sha256(out, in->shifted_raw, 128);
+    __shash(out, in->shifted_raw, 128);
 }
 
 __Z_INLINE void shash160(uint8_t *out, const hashh_t *in) {
-    __sha256(out, in->raw, 160);
+    __shash(out, in->raw, 160);
 }
 
 __Z_INLINE void hash_f(uint8_t *in_out, shash_input_t *shash_in) {
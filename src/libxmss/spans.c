@@ -0,0 +1,114 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#include "spans.h"
+
+#ifdef XMSS_SPANS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+} span_event_t;
+
+// One ring per thread, written only by its owner. Rings are linked in a list
+// that is only ever pushed to, so no locks are needed
+typedef struct span_ring_s {
+    struct span_ring_s *next;
+    uint32_t tid;
+    _Atomic uint64_t head;
+    span_event_t events[SPANS_RING_SIZE];
+} span_ring_t;
+
+static _Atomic(span_ring_t *) rings = NULL;
+static _Atomic uint32_t next_tid = 1;
+static _Thread_local span_ring_t *ring = NULL;
+
+static uint64_t spans_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static span_ring_t *spans_ring() {
+    if (ring != NULL) {
+        return ring;
+    }
+
+    span_ring_t *r = calloc(1, sizeof(span_ring_t));
+    if (r == NULL) {
+        return NULL;
+    }
+    r->tid = atomic_fetch_add(&next_tid, 1);
+
+    span_ring_t *first = atomic_load(&rings);
+    do {
+        r->next = first;
+    } while (!atomic_compare_exchange_weak(&rings, &first, r));
+
+    ring = r;
+    return r;
+}
+
+span_t span_begin(const char *name) {
+    const span_t span = {name, spans_now()};
+    return span;
+}
+
+void span_end(span_t *span) {
+    const uint64_t end = spans_now();
+    span_ring_t *r = spans_ring();
+    if (r == NULL) {
+        return;
+    }
+
+    const uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    span_event_t *e = &r->events[head % SPANS_RING_SIZE];
+    e->name = span->name;
+    e->start_ns = span->start_ns;
+    e->dur_ns = end - span->start_ns;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+int spans_flush(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+
+    // Timestamps are relative to the first span
+    uint64_t origin = UINT64_MAX;
+    for (span_ring_t *r = atomic_load(&rings); r != NULL; r = r->next) {
+        const uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        const uint64_t first = head > SPANS_RING_SIZE ? head - SPANS_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const span_event_t *e = &r->events[i % SPANS_RING_SIZE];
+            if (e->start_ns < origin) {
+                origin = e->start_ns;
+            }
+        }
+    }
+
+    fputs("{\"traceEvents\":[\n", f);
+    const char *sep = "";
+    for (span_ring_t *r = atomic_load(&rings); r != NULL; r = r->next) {
+        const uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        const uint64_t first = head > SPANS_RING_SIZE ? head - SPANS_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const span_event_t *e = &r->events[i % SPANS_RING_SIZE];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    sep, e->name, r->tid,
+                    (double) (e->start_ns - origin) / 1e3, (double) e->dur_ns / 1e3);
+            sep = ",\n";
+        }
+    }
+    fputs("\n]}\n", f);
+
+    return fclose(f);
+}
+
+#endif
@@ -0,0 +1,48 @@
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+#pragma once
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+// Timeline spans for host profiling, written as a Chrome trace (chrome://tracing,
+// ui.perfetto.dev). Host builds only, enabled with XMSS_SPANS. Otherwise SPAN()
+// expands to nothing.
+//
+//   void f() {
+//       SPAN("f");
+//       ...
+//   }                          // span ends when the scope is left
+
+#ifdef XMSS_SPANS
+
+#include <stdint.h>
+
+#define SPANS_RING_SIZE     (1u << 16)      // events kept per thread, oldest are overwritten
+
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+} span_t;
+
+span_t span_begin(const char *name);
+void span_end(span_t *span);
+
+/// Writes the spans of every thread. Call it once the traced threads are done.
+int spans_flush(const char *path);
+
+#define SPAN_CONCAT_(A, B) A##B
+#define SPAN_CONCAT(A, B) SPAN_CONCAT_(A, B)
+#define SPAN(NAME) \
+    span_t SPAN_CONCAT(__span_, __LINE__) __attribute__((cleanup(span_end))) = span_begin(NAME)
+
+#else
+
+#define SPAN(NAME)
+
+#endif
+
+#ifdef  __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file LICENSE or http://www.opensource.org/licenses/mit-license.php.
 #include "wotsp.h"
+#include "spans.h"
 
 void wotsp_expand_seed(NV_VOL NV_CONST uint8_t *pk, const uint8_t *seed) {
     shash_input_t prf_input;
@@ -47,43 +48,46 @@ void wotsp_gen_pk(NV_VOL NV_CONST uint8_t *pk, uint8_t *sk, NV_VOL const uint8_t
     }
 }
 
+void wotsp_basew(uint8_t basew[WOTS_LEN], const uint8_t *msg) {
+    const uint16_t csum = wotsp_csum(msg);
+    for (uint8_t i = 0; i < WOTS_LEN; i++) {
+        basew[i] = wotsp_basew_digit(msg, csum, i);
+    }
+}
+
 void wotsp_sign_init_ctx(wots_sign_ctx_t *ctx,
                          NV_VOL const uint8_t *pub_seed,
                          NV_VOL const uint8_t *sk,
-                         uint16_t index) {
+                         uint16_t index,
+                         const uint8_t *msg) {
     PRF_init(&ctx->prf_input1, SHASH_TYPE_PRF);
     ctx->prf_input1.adrs.otshash.OTS = NtoHL(index);
     MEMCPY(ctx->prf_input1.key, (void *) pub_seed, WOTS_N);
 
-    ctx->bits = 0;      // init context
-    ctx->csum = 0;
-    ctx->in = 0;
-    ctx->total = 0;
+    // checksum is known upfront so every chain digit is available
+    ctx->csum = wotsp_csum(msg);
 
     PRF_init(&ctx->prf_input2, SHASH_TYPE_PRF);
     MEMCPY(ctx->prf_input2.key, (void *) sk, WOTS_N);
 }
 
+void wotsp_sign_chain(wots_sign_ctx_t *ctx,
+                      uint8_t *out_sig_p,
+                      const uint8_t *msg,
+                      uint8_t chain) {
+    ctx->prf_input2.seed_gen.cdr = chain;
+    shash96(out_sig_p, &ctx->prf_input2);
+
+    ctx->prf_input1.adrs.otshash.chain = HtoNL(chain);
+    wotsp_gen_chain_mem(out_sig_p, &ctx->prf_input1, 0, wotsp_basew_digit(msg, ctx->csum, chain));
+}
+
 void wotsp_sign_step(
         wots_sign_ctx_t *ctx,
         uint8_t *out_sig_p,
         const uint8_t *msg) {
-    shash96(out_sig_p, &ctx->prf_input2);
-
-    if (ctx->bits == 0) {
-        ctx->bits += 8;
-        if (NtoHL(ctx->prf_input1.adrs.otshash.chain) < WOTS_LEN1) {
-            ctx->total = msg[ctx->in++];
-        } else {
-            ctx->total = ctx->csum;
-            ctx->bits += 4;
-        }
-    }
-
-    ctx->bits -= 4;
-    const uint8_t basew_i = (uint8_t) ((ctx->total >> ctx->bits) & 0x0Fu);
-    wotsp_gen_chain_mem(out_sig_p, &ctx->prf_input1, 0, basew_i);
-    ctx->csum += (0x0Fu - basew_i);
+    SPAN("wotsp_sign_step");
+    wotsp_sign_chain(ctx, out_sig_p, msg, ctx->prf_input2.seed_gen.cdr);
     BE_inc(&ctx->prf_input1.adrs.otshash.chain);
     ctx->prf_input2.seed_gen.cdr++;
 }
@@ -97,10 +101,193 @@ void wotsp_sign(
     // This function splits wots signature in two steps
     // and allows for incremental signing
     wots_sign_ctx_t ctx;
-    wotsp_sign_init_ctx(&ctx, pub_seed, sk, index);
+    wotsp_sign_init_ctx(&ctx, pub_seed, sk, index, msg);
 
     while (!wotsp_sign_ready(&ctx)) {
         uint8_t *p = out_sig + WOTS_N * ctx.prf_input2.seed_gen.cdr;
         wotsp_sign_step(&ctx, p, msg);
     }
 }
+
+#if !defined(LEDGER_SPECIFIC) && !defined(XMSS_PORTABLE)
+#include <pthread.h>
+#include "sha256_mb.h"
+
+#define WOTS_GROUPS ((WOTS_LEN + SHA256_MB_LANES - 1) / SHA256_MB_LANES)
+#define WOTS_MAX_THREADS WOTS_GROUPS
+
+typedef struct {
+    uint8_t *out_sig;
+    const uint8_t *basew;
+    const uint8_t *chains;          // sorted by decreasing digit
+    const uint8_t *pub_seed;
+    const uint8_t *sk;
+    uint16_t index;
+    uint8_t hash_func;              // the caller's selection, shash_func is per thread
+    uint8_t groups[WOTS_GROUPS];
+    uint8_t num_groups;
+} wotsp_shard_t;
+
+// Signs up to SHA256_MB_LANES chains. Chains are sorted by decreasing digit so
+// the lanes that are still active at any step are always the first ones
+static void wotsp_sign_group(const wotsp_shard_t *shard, const uint8_t *chains, uint8_t count) {
+    SPAN("wotsp_sign_group");
+    if (shash_func != SHASH_FUNC_SHA2_256) {
+        // There is no multi-buffer SHAKE, chains are processed one by one
+        for (uint8_t l = 0; l < count; l++) {
+            shash_input_t prf_input;
+            PRF_init(&prf_input, SHASH_TYPE_PRF);
+            MEMCPY(prf_input.key, shard->sk, WOTS_N);
+            prf_input.seed_gen.cdr = chains[l];
+
+            uint8_t *p = shard->out_sig + WOTS_N * chains[l];
+            shash96(p, &prf_input);
+
+            PRF_init(&prf_input, SHASH_TYPE_PRF);
+            MEMCPY(prf_input.key, shard->pub_seed, WOTS_N);
+            prf_input.adrs.otshash.OTS = HtoNL(shard->index);
+            prf_input.adrs.otshash.chain = HtoNL(chains[l]);
+            wotsp_gen_chain_mem(p, &prf_input, 0, shard->basew[chains[l]]);
+        }
+        return;
+    }
+
+    shash_input_t prf_in[SHA256_MB_LANES];
+    shash_input_t f_in[SHA256_MB_LANES];
+    uint8_t *outs[SHA256_MB_LANES] = {NULL};
+    const uint8_t *ins[SHA256_MB_LANES] = {NULL};
+
+    // Chain seeds
+    for (uint8_t l = 0; l < count; l++) {
+        PRF_init(&prf_in[l], SHASH_TYPE_PRF);
+        MEMCPY(prf_in[l].key, shard->sk, WOTS_N);
+        prf_in[l].seed_gen.cdr = chains[l];
+        ins[l] = prf_in[l].raw;
+        outs[l] = shard->out_sig + WOTS_N * chains[l];
+    }
+    sha256_mb(outs, ins, 96, count);
+
+    for (uint8_t l = 0; l < count; l++) {
+        PRF_init(&prf_in[l], SHASH_TYPE_PRF);
+        MEMCPY(prf_in[l].key, shard->pub_seed, WOTS_N);
+        prf_in[l].adrs.otshash.OTS = HtoNL(shard->index);
+        prf_in[l].adrs.otshash.chain = HtoNL(chains[l]);
+        PRF_init(&f_in[l], SHASH_TYPE_F);
+    }
+
+    // Each step is hash_f for all active lanes
+    for (uint8_t step = 0;; step++) {
+        uint8_t active = 0;
+        while (active < count && shard->basew[chains[active]] > step) {
+            active++;
+        }
+        if (active == 0) {
+            break;
+        }
+
+        for (uint8_t l = 0; l < active; l++) {
+            prf_in[l].adrs.otshash.hash = HtoNL(step);
+            prf_in[l].adrs.keyAndMask = 0;
+            ins[l] = prf_in[l].raw;
+            outs[l] = f_in[l].key;
+        }
+        sha256_mb(outs, ins, 96, active);
+
+        for (uint8_t l = 0; l < active; l++) {
+            prf_in[l].adrs.keyAndMask = HtoNL(1u);
+            outs[l] = f_in[l].F.mask;
+        }
+        sha256_mb(outs, ins, 96, active);
+
+        for (uint8_t l = 0; l < active; l++) {
+            uint8_t *p = shard->out_sig + WOTS_N * chains[l];
+            memxor(f_in[l].F.mask, p, WOTS_N);
+            ins[l] = f_in[l].raw;
+            outs[l] = p;
+        }
+        sha256_mb(outs, ins, 96, active);
+    }
+}
+
+static void *wotsp_sign_shard(void *arg) {
+    SPAN("wotsp_sign_shard");
+    const wotsp_shard_t *shard = (const wotsp_shard_t *) arg;
+    shash_select(shard->hash_func);
+
+    for (uint8_t i = 0; i < shard->num_groups; i++) {
+        const uint8_t first = shard->groups[i] * SHA256_MB_LANES;
+        const uint8_t count = (uint8_t) (WOTS_LEN - first < SHA256_MB_LANES ? WOTS_LEN - first : SHA256_MB_LANES);
+        wotsp_sign_group(shard, shard->chains + first, count);
+    }
+    return NULL;
+}
+
+void wotsp_sign_mt(uint8_t *out_sig,
+                   const uint8_t *msg,
+                   const uint8_t *pub_seed,
+                   const uint8_t *sk,
+                   uint16_t index,
+                   uint8_t num_threads) {
+    uint8_t basew[WOTS_LEN];
+    wotsp_basew(basew, msg);
+
+    // Sort chains by decreasing length so groups of lanes have similar work
+    uint8_t chains[WOTS_LEN];
+    for (uint8_t i = 0; i < WOTS_LEN; i++) {
+        uint8_t j = i;
+        for (; j > 0 && basew[chains[j - 1]] < basew[i]; j--) {
+            chains[j] = chains[j - 1];
+        }
+        chains[j] = i;
+    }
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > WOTS_MAX_THREADS) {
+        num_threads = WOTS_MAX_THREADS;
+    }
+
+    wotsp_shard_t shards[WOTS_MAX_THREADS];
+    uint16_t load[WOTS_MAX_THREADS];
+    for (uint8_t t = 0; t < num_threads; t++) {
+        shards[t].out_sig = out_sig;
+        shards[t].basew = basew;
+        shards[t].chains = chains;
+        shards[t].pub_seed = pub_seed;
+        shards[t].sk = sk;
+        shards[t].index = index;
+        shards[t].hash_func = shash_func;
+        shards[t].num_groups = 0;
+        load[t] = 0;
+    }
+
+    // Groups come in decreasing cost, give each one to the least loaded thread
+    for (uint8_t g = 0; g < WOTS_GROUPS; g++) {
+        uint8_t t_min = 0;
+        for (uint8_t t = 1; t < num_threads; t++) {
+            if (load[t] < load[t_min]) {
+                t_min = t;
+            }
+        }
+        shards[t_min].groups[shards[t_min].num_groups++] = g;
+        load[t_min] += 1u + basew[chains[g * SHA256_MB_LANES]];
+    }
+
+    pthread_t threads[WOTS_MAX_THREADS];
+    uint8_t started[WOTS_MAX_THREADS] = {0};
+    for (uint8_t t = 1; t < num_threads; t++) {
+        started[t] = pthread_create(&threads[t], NULL, wotsp_sign_shard, &shards[t]) == 0;
+        if (!started[t]) {
+            // run it here if the thread could not be started
+            wotsp_sign_shard(&shards[t]);
+        }
+    }
+    wotsp_sign_shard(&shards[0]);
+    for (uint8_t t = 1; t < num_threads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+}
+#endif
@@ -16,10 +16,7 @@ extern "C" {
 
 #pragma pack(push, 1)
 typedef struct {
-    uint32_t csum;
-    uint32_t total;
-    uint32_t in;
-    uint8_t bits;
+    uint16_t csum;
     shash_input_t prf_input1;
     shash_input_t prf_input2;
 } wots_sign_ctx_t;
@@ -27,6 +24,26 @@ typedef struct {
 
 __Z_INLINE void BE_inc(uint32_t *val) { *val = NtoHL(HtoNL(*val) + 1); }
 
+// Checksum of the message digits, its three base-w digits sign the last WOTS_LEN2 chains
+__Z_INLINE uint16_t wotsp_csum(const uint8_t *msg) {
+    uint16_t csum = 0;
+    for (uint8_t i = 0; i < WOTS_LEN1 / 2; i++) {
+        csum += (0x0Fu - (msg[i] >> 4u)) + (0x0Fu - (msg[i] & 0x0Fu));
+    }
+    return csum;
+}
+
+// Base-w digit of any chain, so chains can be signed in any order
+__Z_INLINE uint8_t wotsp_basew_digit(const uint8_t *msg, uint16_t csum, uint8_t chain) {
+    if (chain < WOTS_LEN1) {
+        const uint8_t b = msg[chain >> 1u];
+        return (chain & 1u) ? (b & 0x0Fu) : (b >> 4u);
+    }
+    return (uint8_t) ((csum >> (4u * (WOTS_LEN - 1u - chain))) & 0x0Fu);
+}
+
+void wotsp_basew(uint8_t basew[WOTS_LEN], const uint8_t *msg);
+
 void wotsp_expand_seed(NV_VOL NV_CONST uint8_t *pk, const uint8_t *seed);
 
 void wotsp_gen_chain(NV_VOL NV_CONST uint8_t *in_out, shash_input_t *prf_input, uint8_t start, int8_t count);
@@ -36,7 +53,10 @@ void wotsp_gen_pk(NV_VOL NV_CONST uint8_t *pk, uint8_t *sk, NV_VOL const uint8_t
 void wotsp_sign_init_ctx(wots_sign_ctx_t *ctx,
                          NV_VOL const uint8_t *pub_seed,
                          NV_VOL const uint8_t *sk,
-                         uint16_t index);
+                         uint16_t index,
+                         const uint8_t *msg);
+
+void wotsp_sign_chain(wots_sign_ctx_t *ctx, uint8_t *out_sig_p, const uint8_t *msg, uint8_t chain);
 
 void wotsp_sign_step(wots_sign_ctx_t *ctx, uint8_t *out_sig_p, const uint8_t *msg);
 
@@ -50,6 +70,17 @@ void wotsp_sign(uint8_t *out_sig,
                 NV_VOL const uint8_t *sk,
                 uint16_t index);
 
+#if !defined(LEDGER_SPECIFIC) && !defined(XMSS_PORTABLE)
+// Host only: chains are sorted by length, hashed in multi-buffer lanes
+// and sharded over num_threads threads
+void wotsp_sign_mt(uint8_t *out_sig,
+                   const uint8_t *msg,
+                   const uint8_t *pub_seed,
+                   const uint8_t *sk,
+                   uint16_t index,
+                   uint8_t num_threads);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
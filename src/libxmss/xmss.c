@@ -1,6 +1,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file LICENSE or http://www.opensource.org/licenses/mit-license.php.
 #include "xmss.h"
+#include "spans.h"
 
 #define BUF_MAX_IDX 34      // split point between ram and nvram
 
@@ -14,6 +15,7 @@ void xmss_ltree_gen(NV_VOL NV_CONST uint8_t *leaf,
                     NV_VOL NV_CONST uint8_t *tmp_wotspk,
                     NV_VOL const uint8_t *pub_seed,
                     uint16_t index) {
+    SPAN("xmss_ltree_gen");
     uint8_t mem_wotspk[BUF_MAX_IDX * WOTS_N];
     MEMCPY(mem_wotspk, (void *) tmp_wotspk, BUF_MAX_IDX * WOTS_N);
 
@@ -60,6 +62,7 @@ void xmss_treehash(uint8_t *root_out,
                    NV_VOL const uint8_t *nodes,
                    NV_VOL const uint8_t *pub_seed,
                    const uint16_t leaf_index) {
+    SPAN("xmss_treehash");
     hashh_t h_in;
     uint8_t stack[XMSS_STK_SIZE];
     uint16_t stack_levels[XMSS_STK_LEVELS];
@@ -119,6 +122,7 @@ void xmss_randombits(NV_VOL NV_CONST uint8_t *random_bits,
 }
 
 void xmss_get_seed_i(uint8_t *seed, NV_VOL const xmss_sk_t *sk, uint16_t idx) {
+    SPAN("xmss_get_seed_i");
     shash_input_t prf_in;
     PRF_init(&prf_in, SHASH_TYPE_PRF);
     MEMCPY(prf_in.key, (void *) sk->seed, WOTS_N);
@@ -127,8 +131,10 @@ void xmss_get_seed_i(uint8_t *seed, NV_VOL const xmss_sk_t *sk, uint16_t idx) {
 }
 
 void xmss_gen_keys_1_get_seeds(NV_VOL NV_CONST xmss_sk_t *sk,
-                               const uint8_t *sk_seed) {
+                               const uint8_t *sk_seed,
+                               uint8_t hash_func) {
     SET_NV(&(sk->index), uint32_t, 0);
+    SET_NV(&(sk->hash_func), uint8_t, hash_func);
     xmss_randombits(sk->seeds.raw, sk_seed);
 }
 
@@ -136,6 +142,9 @@ void xmss_gen_keys_2_get_nodes(NV_VOL NV_CONST uint8_t *wots_buffer,
                                NV_VOL NV_CONST uint8_t *xmss_node,
                                NV_VOL NV_CONST xmss_sk_t *sk,
                                uint16_t idx) {
+    SPAN("keygen_leaf");
+    shash_select(sk->hash_func);
+
     uint8_t seed[WOTS_N];
     xmss_get_seed_i(seed, (void *) sk, idx);
     wotsp_gen_pk(wots_buffer, seed, sk->pub_seed, idx);
@@ -144,6 +153,8 @@ void xmss_gen_keys_2_get_nodes(NV_VOL NV_CONST uint8_t *wots_buffer,
 
 void xmss_gen_keys_3_get_root(NV_VOL const uint8_t *xmss_nodes,
                               NV_VOL NV_CONST xmss_sk_t *sk) {
+    shash_select(sk->hash_func);
+
     uint8_t root[WOTS_N];
     uint8_t authpath[(XMSS_H + 1) * WOTS_N];
     xmss_treehash(root, authpath, xmss_nodes, sk->pub_seed, 0);
@@ -151,8 +162,9 @@ void xmss_gen_keys_3_get_root(NV_VOL const uint8_t *xmss_nodes,
 }
 
 void xmss_gen_keys(xmss_sk_t *sk,
-                   const uint8_t *sk_seed) {
-    xmss_gen_keys_1_get_seeds(sk, sk_seed);
+                   const uint8_t *sk_seed,
+                   uint8_t hash_func) {
+    xmss_gen_keys_1_get_seeds(sk, sk_seed, hash_func);
 
     uint8_t xmss_nodes[XMSS_NODES_BUFSIZE];
     for (uint16_t idx = 0; idx < XMSS_NUM_NODES; idx++) {
@@ -171,6 +183,9 @@ void xmss_digest(xmss_digest_t *digest,
                  const uint8_t msg[32],
                  NV_VOL const xmss_sk_t *sk,
                  const uint16_t index) {
+    SPAN("xmss_digest");
+    shash_select(sk->hash_func);
+
     // get randomness
     shash_input_t prf_in;
     PRF_init(&prf_in, SHASH_TYPE_PRF);
@@ -194,6 +209,9 @@ void xmss_sign(xmss_signature_t *sig,
                NV_VOL const xmss_sk_t *sk,
                const uint8_t xmss_nodes[XMSS_NODES_BUFSIZE],
                const uint16_t index) {
+    SPAN("xmss_sign");
+    shash_select(sk->hash_func);
+
     // Get message digest
     xmss_digest_t msg_digest;
     xmss_digest(&msg_digest, msg, sk, index);
@@ -222,11 +240,49 @@ void xmss_sign(xmss_signature_t *sig,
                index);
 }
 
+#if !defined(LEDGER_SPECIFIC) && !defined(XMSS_PORTABLE)
+void xmss_sign_mt(xmss_signature_t *sig,
+                  const uint8_t msg[32],
+                  const xmss_sk_t *sk,
+                  const uint8_t xmss_nodes[XMSS_NODES_BUFSIZE],
+                  const uint16_t index,
+                  uint8_t num_threads) {
+    SPAN("xmss_sign_mt");
+    shash_select(sk->hash_func);
+
+    xmss_digest_t msg_digest;
+    xmss_digest(&msg_digest, msg, sk, index);
+
+    sig->index = NtoHL(index);
+    MEMCPY(sig->randomness, msg_digest.randomness, 32);
+
+    uint8_t dummy_root[32];
+    xmss_treehash(
+            dummy_root,
+            sig->auth_path,
+            xmss_nodes,
+            sk->pub_seed,
+            index);
+
+    uint8_t seed_i[32];
+    xmss_get_seed_i(seed_i, sk, index);
+
+    wotsp_sign_mt(sig->wots_sig,
+                  msg_digest.hash,
+                  sk->pub_seed,
+                  seed_i,
+                  index,
+                  num_threads);
+}
+#endif
+
 void xmss_sign_incremental_init(xmss_sig_ctx_t *ctx,
                                 const uint8_t msg[32],
                                 NV_VOL const xmss_sk_t *sk,
                                 uint8_t xmss_nodes[XMSS_NODES_BUFSIZE],
                                 const uint16_t index) {
+    shash_select(sk->hash_func);
+
     ctx->sig_chunk_idx = 0;
     ctx->written = 0;
     xmss_digest(&ctx->msg_digest, msg, sk, index);
@@ -239,13 +295,15 @@ void xmss_sign_incremental_init(xmss_sig_ctx_t *ctx,
             &ctx->wots_ctx,
             sk->pub_seed,
             seed_i,
-            index);
+            index,
+            ctx->msg_digest.hash);
 }
 
 bool xmss_sign_incremental(xmss_sig_ctx_t *ctx,
                            uint8_t *out,
                            NV_VOL const xmss_sk_t *sk,
                            const uint16_t index) {
+    shash_select(sk->hash_func);
     ctx->written = 0;
 
     if (ctx->sig_chunk_idx > 9) {
@@ -287,6 +345,7 @@ bool xmss_sign_incremental_last(xmss_sig_ctx_t *ctx,
                                 uint8_t *out,
                                 NV_VOL const xmss_sk_t *sk,
                                 const uint16_t index) {
+    shash_select(sk->hash_func);
     ctx->written = 0;
 
     if (ctx->sig_chunk_idx != 10) {
@@ -33,7 +33,8 @@ void xmss_randombits(NV_VOL NV_CONST uint8_t *random_bits,
 void xmss_get_seed_i(uint8_t *seed, NV_VOL const xmss_sk_t *sk, uint16_t idx);
 
 void xmss_gen_keys_1_get_seeds(NV_VOL NV_CONST xmss_sk_t *sk,
-                               const uint8_t *sk_seed
+                               const uint8_t *sk_seed,
+                               uint8_t hash_func
 );
 
 void xmss_gen_keys_2_get_nodes(NV_VOL NV_CONST uint8_t *wots_buffer,
@@ -44,7 +45,7 @@ void xmss_gen_keys_2_get_nodes(NV_VOL NV_CONST uint8_t *wots_buffer,
 void xmss_gen_keys_3_get_root(NV_VOL const uint8_t *xmss_nodes,
                               NV_VOL NV_CONST  xmss_sk_t *sk);
 
-void xmss_gen_keys(xmss_sk_t *sk, const uint8_t *sk_seed);
+void xmss_gen_keys(xmss_sk_t *sk, const uint8_t *sk_seed, uint8_t hash_func);
 
 void xmss_digest(xmss_digest_t *digest,
                  const uint8_t msg[32],
@@ -57,6 +58,16 @@ void xmss_sign(xmss_signature_t *sig,
                const uint8_t xmss_nodes[XMSS_NODES_BUFSIZE],
                uint16_t index);
 
+#if !defined(LEDGER_SPECIFIC) && !defined(XMSS_PORTABLE)
+// Same as xmss_sign, WOTS+ chains are spread over num_threads threads
+void xmss_sign_mt(xmss_signature_t *sig,
+                  const uint8_t msg[32],
+                  const xmss_sk_t *sk,
+                  const uint8_t xmss_nodes[XMSS_NODES_BUFSIZE],
+                  uint16_t index,
+                  uint8_t num_threads);
+#endif
+
 void xmss_sign_incremental_init(xmss_sig_ctx_t *ctx,
                                 const uint8_t msg[32],
                                 NV_VOL const xmss_sk_t *sk,
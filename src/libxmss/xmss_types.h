@@ -10,13 +10,14 @@ extern "C" {
 
 #pragma pack(push, 1)
 typedef union {
-  uint8_t raw[132];
+  uint8_t raw[XMSS_SKSIZE];
   struct {
     uint32_t index;
     uint8_t seed[32];
     uint8_t prf_seed[32];
     uint8_t pub_seed[32];
     uint8_t root[32];
+    uint8_t hash_func;
   };
   struct {
     uint32_t _padding;
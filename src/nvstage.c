@@ -0,0 +1,127 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include "nvstage.h"
+#include "zxmacros.h"
+#include "apdu_codes.h"
+#include "storage.h"
+#include "app_main.h"
+
+nvstage_journal_t NV_CONST
+N_nvstage_impl NV_ALIGN;
+
+#define N_nvstage (*(NV_VOL nvstage_journal_t *)PIC(&N_nvstage_impl))
+
+#define NVSTAGE_BASE ((uint8_t *) &N_appdata)
+
+// The pages are staged in ctx, which is shared, the count stays outside
+#define stage ctx.nvstage
+static uint8_t stage_count;
+
+// The last page is only partially used by app_data_t
+__Z_INLINE uint16_t nvstage_page_len(uint8_t index) {
+    const uint16_t start = (uint16_t) index * NVSTAGE_PAGE_SIZE;
+    return sizeof(app_data_t) - start < NVSTAGE_PAGE_SIZE ? sizeof(app_data_t) - start : NVSTAGE_PAGE_SIZE;
+}
+
+__Z_INLINE void nvstage_apply(uint8_t index, const void *page) {
+    MEMCPY_NV(NVSTAGE_BASE + index * NVSTAGE_PAGE_SIZE, (void *) page, nvstage_page_len(index));
+}
+
+static uint8_t *nvstage_page(uint8_t index) {
+    for (uint8_t i = 0; i < stage_count; i++) {
+        if (stage.index[i] == index) {
+            return stage.page[i];
+        }
+    }
+
+    if (stage_count == 0) {
+        // A streamed tx, chained request or signature in ctx is dropped
+        app_ctx_reset();
+    }
+
+    if (stage_count == NVSTAGE_MAX_PAGES) {
+        // Larger groups could not be committed atomically, NVSTAGE_MAX_PAGES is too small
+        stage_count = 0;
+        THROW(APDU_CODE_EXECUTION_ERROR);
+    }
+
+    const uint8_t i = stage_count++;
+    stage.index[i] = index;
+    MEMCPY(stage.page[i], NVSTAGE_BASE + index * NVSTAGE_PAGE_SIZE, nvstage_page_len(index));
+    return stage.page[i];
+}
+
+void nvstage_recover() {
+    stage_count = 0;
+
+    const uint8_t count = N_nvstage.count;
+    if (count == 0 || count > NVSTAGE_MAX_PAGES) {
+        return;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        nvstage_apply(N_nvstage.index[i], (const void *) N_nvstage.page[i]);
+    }
+    SET_NV(&N_nvstage.count, uint8_t, 0);
+}
+
+void nvstage_write(volatile void *dst, const void *src, uint16_t len) {
+    const uint8_t *p = (const uint8_t *) dst;
+    if (p < NVSTAGE_BASE || p + len > NVSTAGE_BASE + sizeof(app_data_t)) {
+        stage_count = 0;
+        THROW(APDU_CODE_EXECUTION_ERROR);
+    }
+
+    uint16_t offset = (uint16_t) (p - NVSTAGE_BASE);
+    const uint8_t *s = src;
+    while (len > 0) {
+        const uint8_t index = offset / NVSTAGE_PAGE_SIZE;
+        const uint16_t in_page = offset % NVSTAGE_PAGE_SIZE;
+        const uint16_t n = NVSTAGE_PAGE_SIZE - in_page < len ? NVSTAGE_PAGE_SIZE - in_page : len;
+
+        MEMCPY(nvstage_page(index) + in_page, s, n);
+        offset += n;
+        s += n;
+        len -= n;
+    }
+}
+
+void nvstage_commit() {
+    if (stage_count == 0) {
+        return;
+    }
+
+    if (stage_count == 1) {
+        // A single page program is atomic already
+        nvstage_apply(stage.index[0], stage.page[0]);
+        stage_count = 0;
+        return;
+    }
+
+    // Journal the pages, then set the marker in a single write
+    for (uint8_t i = 0; i < stage_count; i++) {
+        MEMCPY_NV((void *) N_nvstage.page[i], stage.page[i], NVSTAGE_PAGE_SIZE);
+    }
+    uint8_t marker[1 + NVSTAGE_MAX_PAGES];
+    marker[0] = stage_count;
+    MEMCPY(marker + 1, stage.index, NVSTAGE_MAX_PAGES);
+    MEMCPY_NV((void *) &N_nvstage.count, marker, sizeof(marker));
+
+    for (uint8_t i = 0; i < stage_count; i++) {
+        nvstage_apply(stage.index[i], stage.page[i]);
+    }
+    SET_NV(&N_nvstage.count, uint8_t, 0);
+    stage_count = 0;
+}
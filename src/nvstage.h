@@ -0,0 +1,70 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "zxmacros.h"
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Small N_appdata updates are staged in RAM and written on nvstage_commit(), one
+// program per page. Commits touching several pages go through a journal so a reset
+// leaves either the old or the new state, never a mix.
+#define NVSTAGE_PAGE_SIZE   64      // NV_ALIGN
+
+/// N_appdata pages holding the fields FIRST to LAST
+#define NVSTAGE_SPAN(FIRST, LAST) \
+    ((offsetof(app_data_t, LAST) + sizeof(((app_data_t *) 0)->LAST) - 1) / NVSTAGE_PAGE_SIZE - \
+     offsetof(app_data_t, FIRST) / NVSTAGE_PAGE_SIZE + 1)
+
+// Largest group, written by seed_verify. The other groups are checked in storage.c
+#define NVSTAGE_MAX_PAGES \
+    (NVSTAGE_SPAN(seed_mode_known, seed_mode_known) + NVSTAGE_SPAN(seed_hash_2, seed_mode_last))
+
+#pragma pack(push, 1)
+typedef struct {
+    uint8_t page[NVSTAGE_MAX_PAGES][NVSTAGE_PAGE_SIZE];
+    // commit marker, in a page of its own
+    uint8_t count;                                  // pages to apply, 0 when there is nothing to do
+    uint8_t index[NVSTAGE_MAX_PAGES];               // N_appdata pages
+} nvstage_journal_t;
+#pragma pack(pop)
+
+// Staged pages, kept in the ctx union between the first nvstage_write() and nvstage_commit()
+typedef struct {
+    uint8_t index[NVSTAGE_MAX_PAGES];
+    uint8_t page[NVSTAGE_MAX_PAGES][NVSTAGE_PAGE_SIZE];
+} nvstage_t;
+
+extern NV_CONST nvstage_journal_t N_nvstage_impl NV_ALIGN;
+
+/// Finishes a commit interrupted by a reset. Call before reading N_appdata.
+void nvstage_recover();
+
+/// Stages a write to N_appdata. Reads still return the old values until nvstage_commit().
+/// The first write of a group takes over ctx, anything held there must be read before.
+/// Throws when the group touches more than NVSTAGE_MAX_PAGES pages.
+void nvstage_write(volatile void *dst, const void *src, uint16_t len);
+
+/// Writes every staged page
+void nvstage_commit();
+
+#ifdef __cplusplus
+}
+#endif
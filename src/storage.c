@@ -16,59 +16,95 @@
 #include "storage.h"
 #include "actions.h"
 #include "libxmss/shash.h"
+#include "nvstage.h"
 
 app_data_t NV_CONST
 N_appdata_impl NV_ALIGN;
 
+// Every group committed at once must fit in the stage, nvstage_write throws otherwise
+_Static_assert(NVSTAGE_SPAN(initialized, seed_mode_known) + NVSTAGE_SPAN(seed_hash_1, seed_hash_1)
+               <= NVSTAGE_MAX_PAGES, "app_data_init group");
+_Static_assert(NVSTAGE_SPAN(tree[0], tree[0]) <= NVSTAGE_MAX_PAGES, "tree 0 key and mode group");
+_Static_assert(NVSTAGE_SPAN(tree[1], tree[1]) <= NVSTAGE_MAX_PAGES, "tree 1 key and mode group");
+_Static_assert(NVSTAGE_SPAN(tree[2], tree[2]) <= NVSTAGE_MAX_PAGES, "tree 2 key and mode group");
+_Static_assert(NVSTAGE_SPAN(tree[3], tree[3]) <= NVSTAGE_MAX_PAGES, "tree 3 key and mode group");
+
 uint8_t seed_mode;
+static uint8_t seed_verified;
 
 void app_data_init() {
     uint8_t seed[48];
     uint8_t seed_hash[32];
 
-    seed_mode = SEED_MODE_1;
-    if (N_appdata.initialized){
-        // get seeds and try to match with current ones
-        get_seed(seed, 0);
-        __sha256(seed_hash, seed, 48);
-        if (memcmp(seed_hash, N_appdata.seed_hash_1, 32) != 0 ){
-            // If main seed hash does not match,
-            // try alternative seed?
-            seed_mode = SEED_MODE_2;
-            if (!N_appdata.seed_mode_known) {
-                // store alternative seed hash
-                MEMCPY_NV(N_appdata.seed_hash_2, seed_hash, 32);
-                SET_NV(&N_appdata.seed_mode_known, uint8_t, 1);
-            } else {
-                // Check the alternative seed matches
-                if (memcmp(seed_hash, N_appdata.seed_hash_2, 32) != 0 ){
-                    // go into error mode
-                    seed_mode = SEED_MODE_ERR;
-                }
-            }
-        }
+    nvstage_recover();
 
-        // show an error in the screen
+    seed_verified = 0;
+    if (N_appdata.initialized){
+        // checked later by seed_verify
+        seed_mode = N_appdata.seed_mode_last < SEED_MODE_ERR ? N_appdata.seed_mode_last : SEED_MODE_1;
         return;
     }
 
     // Mark as initialized + tree index = 0 + trees_used
     // get starting seed, hash and store
+    seed_mode = SEED_MODE_1;
     get_seed(seed, 0);
     __sha256(seed_hash, seed, 48);
-    MEMCPY_NV(N_appdata.seed_hash_1, seed_hash, 32);
+    nvstage_write(N_appdata.seed_hash_1, seed_hash, 32);
 
     uint8_t tmp[] = {1, 0, 0};
-    MEMCPY_NV(&N_appdata.initialized, tmp, sizeof(tmp));
+    nvstage_write(&N_appdata.initialized, tmp, sizeof(tmp));
+    nvstage_commit();
+    seed_verified = 1;
+}
+
+uint8_t seed_verify() {
+    uint8_t seed[48];
+    uint8_t seed_hash[32];
+
+    if (seed_verified) {
+        return 0;
+    }
+    const uint8_t presumed = seed_mode;
+
+    // get seeds and try to match with current ones
+    seed_mode = SEED_MODE_1;
+    get_seed(seed, 0);
+    __sha256(seed_hash, seed, 48);
+    if (memcmp(seed_hash, N_appdata.seed_hash_1, 32) != 0 ){
+        // If main seed hash does not match,
+        // try alternative seed?
+        seed_mode = SEED_MODE_2;
+        if (!N_appdata.seed_mode_known) {
+            // store alternative seed hash
+            const uint8_t known = 1;
+            nvstage_write(N_appdata.seed_hash_2, seed_hash, 32);
+            nvstage_write(&N_appdata.seed_mode_known, &known, 1);
+        } else {
+            // Check the alternative seed matches
+            if (memcmp(seed_hash, N_appdata.seed_hash_2, 32) != 0 ){
+                // go into error mode, the error screen is shown
+                seed_mode = SEED_MODE_ERR;
+            }
+        }
+    }
+
+    if (seed_mode != SEED_MODE_ERR && seed_mode != N_appdata.seed_mode_last) {
+        nvstage_write(&N_appdata.seed_mode_last, &seed_mode, 1);
+    }
+    nvstage_commit();
+
+    seed_verified = 1;
+    return seed_mode != presumed;
 }
 
 void app_set_tree(uint8_t tree_index) {
-    SET_NV(&N_appdata.tree_idx, uint8_t, tree_index);
+    nvstage_write(&N_appdata.tree_idx, &tree_index, 1);
 }
 
 void app_set_mode_index(uint8_t mode, uint16_t xmss_index) {
     xmss_tree_t tmp;
     tmp.mode = mode;
     tmp.xmss_index = xmss_index;
-    nvm_write((void *) &APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
+    nvstage_write(&APP_CURTREE.raw, &tmp.raw, sizeof(tmp.raw));
 }
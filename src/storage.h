@@ -47,6 +47,9 @@ typedef struct {
     // Tracking alternatives
     uint8_t seed_hash_1[32];
     uint8_t seed_hash_2[32];
+
+    // seed_mode of the last session, used until the seed has been checked
+    uint8_t seed_mode_last;
 } app_data_t;
 #pragma pack(pop)
 
@@ -64,8 +67,15 @@ extern NV_CONST app_data_t N_appdata_impl NV_ALIGN;
 #define XMSS_CUR_NODES (N_XMSS_DATA.trees[APP_TREE_IDX].xmss_nodes)
 #define XMSS_CUR_SK (N_XMSS_DATA.trees[APP_TREE_IDX].sk)
 
+/// Loads the stored state. seed_mode is taken from the last session, the seed itself
+/// is only checked by seed_verify, so the UI does not wait for the derivation
 void app_data_init();
 
+/// Derives the seed and matches it with the stored hashes, once per session.
+/// Returns 1 when seed_mode is not the one the session started with.
+uint8_t seed_verify();
+
+// Both are staged, see nvstage_commit
 void app_set_tree(uint8_t tree_index);
 
 void app_set_mode_index(uint8_t mode, uint16_t xmss_index);
@@ -15,16 +15,19 @@
 *  limitations under the License.
 ********************************************************************************/
 #include <string.h>
+#include <stddef.h>
 #include "ux.h"
 #include "os_io_seproxyhal.h"
 #include "view.h"
 #include "app_main.h"
 #include "apdu_codes.h"
 #include "storage.h"
+#include "nvstage.h"
 #include "view_templates.h"
 #include "app_types.h"
 
 #include "actions.h"
+#include "libxmss/nvram.h"
 
 #define REVIEW_DATA_AVAILABLE 1
 #define REVIEW_NO_MORE_DATA   0
@@ -38,6 +41,8 @@ void view_sign_internal_show();
 
 void view_sign_internal_show();
 
+static void review_build();
+
 void h_tree_init(unsigned int _) {
     actions_tree_init();
     view_update_state();
@@ -45,11 +50,34 @@ void h_tree_init(unsigned int _) {
 }
 
 void h_tree_switch(unsigned int _) {
-    app_set_tree((APP_TREE_IDX +1) % 2);
+    app_switch_tree();
     view_update_state();
     view_idle_show();
 }
 
+void h_switch_tree_accept() {
+    app_switch_tree();
+    view_update_state();
+    view_idle_show();
+    UX_WAIT();
+
+    // Reply with the state of the new tree, as INS_GETSTATE
+    G_io_apdu_buffer[0] = APP_CURTREE_MODE;
+    G_io_apdu_buffer[1] = APP_CURTREE_XMSSIDX >> 8;
+    G_io_apdu_buffer[2] = APP_CURTREE_XMSSIDX & 0xFF;
+    set_code(G_io_apdu_buffer, 3, APDU_CODE_OK);
+    io_exchange(CHANNEL_APDU | IO_RETURN_AFTER_TX, 5);
+}
+
+void h_switch_tree_reject() {
+    view_update_state();
+    view_idle_show();
+    UX_WAIT();
+
+    set_code(G_io_apdu_buffer, 0, APDU_CODE_COMMAND_NOT_ALLOWED);
+    io_exchange(CHANNEL_APDU | IO_RETURN_AFTER_TX, 2);
+}
+
 void h_setidx_accept() {
     // Accept changing the index
     app_setidx();
@@ -160,6 +188,17 @@ UX_FLOW(
     &ux_set_index_flow_3_step
 );
 
+UX_STEP_NOCB(ux_switch_tree_flow_1_step, bn, { viewdata.key, viewdata.value, });
+UX_STEP_VALID(ux_switch_tree_flow_2_step, pbb, h_switch_tree_accept(), { &C_icon_validate_14, "Accept", "Switch" });
+UX_STEP_VALID(ux_switch_tree_flow_3_step, pbb, h_switch_tree_reject(), { &C_icon_crossmark, "Reject", "Switch" });
+
+UX_FLOW(
+    ux_switch_tree_flow,
+    &ux_switch_tree_flow_1_step,
+    &ux_switch_tree_flow_2_step,
+    &ux_switch_tree_flow_3_step
+);
+
 UX_STEP_NOCB(ux_addr_flow_1_step, bnnn_paging, { .title = viewdata.key, .text = viewdata.value, });
 UX_STEP_VALID(ux_addr_flow_2_step, pb, h_back(), { &C_icon_validate_14, "Back"});
 
@@ -243,6 +282,18 @@ const ux_flow_step_t *const ux_sign_flow[] = {
   FLOW_END_STEP,
 };
 
+// Streamed tx, more packets follow the one being reviewed
+UX_STEP_VALID(ux_sign_part_flow_3_step, pbb, h_sign_accept(0), { &C_icon_validate_14, "Accept", "Continue" });
+const ux_flow_step_t *const ux_sign_part_flow[] = {
+  &ux_sign_flow_1_step,
+  &ux_sign_flow_2_start_step,
+  &ux_sign_flow_2_step,
+  &ux_sign_flow_2_end_step,
+  &ux_sign_part_flow_3_step,
+  &ux_sign_flow_4_step,
+  FLOW_END_STEP,
+};
+
 #else
 
 #define UIID_STATUS        UIID_LABEL+1
@@ -284,6 +335,14 @@ const ux_menu_entry_t menu_sign[] = {
         UX_MENU_END
 };
 
+// Streamed tx, more packets follow the one being reviewed
+const ux_menu_entry_t menu_sign_part[] = {
+        {NULL, h_review, 0, NULL, "View transaction", NULL, 0, 0},
+        {NULL, h_sign_accept, 0, NULL, "Accept, continue", NULL, 0, 0},
+        {NULL, h_sign_reject, 0, &C_icon_back, "Reject", NULL, 60, 40},
+        UX_MENU_END
+};
+
 static const bagl_element_t view_review[] = {
         UI_BACKGROUND_LEFT_RIGHT_ICONS,
         UI_LabelLine(UIID_LABEL + 0, 0, 8, UI_SCREEN_WIDTH, UI_11PX, UI_WHITE, UI_BLACK, viewdata.title),
@@ -300,6 +359,15 @@ static const bagl_element_t view_setidx[] = {
         UI_LabelLineScrolling(UIID_LABELSCROLL, 6, 30, 112, UI_11PX, UI_WHITE, UI_BLACK, viewdata.value),
 };
 
+static const bagl_element_t view_switch_tree[] = {
+        UI_FillRectangle(0, 0, 0, UI_SCREEN_WIDTH, UI_SCREEN_HEIGHT, 0x000000, 0xFFFFFF),
+        UI_Icon(0, 0, 0, 7, 7, BAGL_GLYPH_ICON_CROSS),
+        UI_Icon(0, 128 - 7, 0, 7, 7, BAGL_GLYPH_ICON_CHECK),
+        UI_LabelLine(UIID_LABEL + 0, 0, 8, UI_SCREEN_WIDTH, UI_11PX, UI_WHITE, UI_BLACK, viewdata.title),
+        UI_LabelLine(UIID_LABEL + 0, 0, 19, UI_SCREEN_WIDTH, UI_11PX, UI_WHITE, UI_BLACK, viewdata.key),
+        UI_LabelLineScrolling(UIID_LABELSCROLL, 6, 30, 112, UI_11PX, UI_WHITE, UI_BLACK, viewdata.value),
+};
+
 static const bagl_element_t view_address[] = {
         UI_FillRectangle(0, 0, 0, UI_SCREEN_WIDTH, UI_SCREEN_HEIGHT, 0x000000, 0xFFFFFF),
         UI_Icon(0, 128 - 7, 0, 7, 7, BAGL_GLYPH_ICON_CHECK),
@@ -356,6 +424,23 @@ static unsigned int view_setidx_button(unsigned int button_mask, unsigned int bu
     return 0;
 }
 
+static unsigned int view_switch_tree_button(unsigned int button_mask, unsigned int button_mask_counter) {
+    switch (button_mask) {
+        // Press both left and right buttons to quit
+        case BUTTON_EVT_RELEASED | BUTTON_LEFT | BUTTON_RIGHT:
+            break;
+        case BUTTON_EVT_RELEASED | BUTTON_LEFT:
+            // Press left to progress to cancel
+            h_switch_tree_reject();
+            break;
+        case BUTTON_EVT_RELEASED | BUTTON_RIGHT:
+            // Press right to progress to accept
+            h_switch_tree_accept();
+            break;
+    }
+    return 0;
+}
+
 static unsigned int view_address_button(unsigned int button_mask, unsigned int button_mask_counter) {
     switch (button_mask) {
         case BUTTON_EVT_RELEASED | BUTTON_LEFT | BUTTON_RIGHT:
@@ -432,6 +517,7 @@ void view_idle_show(void) {
 }
 
 void view_sign_show() {
+    review_build();
 #if defined(TARGET_NANOS)
     viewdata.idx = 0;
     view_update_review();
@@ -442,8 +528,9 @@ void view_sign_show() {
 }
 
 void view_sign_internal_show(void) {
+    const uint8_t last = qrltx_stream_done(&ctx.qrltx_stream);
 #if defined(TARGET_NANOS)
-    UX_MENU_DISPLAY(0, menu_sign, NULL);
+    UX_MENU_DISPLAY(0, last ? menu_sign : menu_sign_part, NULL);
 #elif defined(TARGET_NANOX) || defined(TARGET_NANOS2)
     viewdata.idx = -1;
     if(G_ux.stack_count == 0) {
@@ -451,7 +538,7 @@ void view_sign_internal_show(void) {
     }
     review_state.inside = 0;
     review_state.no_more_data = 0;
-    ux_flow_init(0, ux_sign_flow, NULL);
+    ux_flow_init(0, last ? ux_sign_flow : ux_sign_part_flow, NULL);
 #endif
 }
 
@@ -476,11 +563,26 @@ void view_setidx_show() {
 #endif
 }
 
+void view_switch_tree_show() {
+    strcpy(viewdata.title, "WARNING!");
+    strcpy(viewdata.key, "Switch Tree");
+    print_status("To Tree%d", ((APP_TREE_IDX + 1) % 2) + 1);
+
+#if defined(TARGET_NANOS)
+    UX_DISPLAY(view_switch_tree, view_prepro);
+#elif defined(TARGET_NANOX) || defined(TARGET_NANOS2)
+    if(G_ux.stack_count == 0) {
+        ux_stack_push();
+    }
+    ux_flow_init(0, ux_switch_tree_flow, NULL);
+#endif
+}
+
 void view_address_show() {
     // See https://docs.theqrl.org/developers/address/#format-sha256_2x
     // Add Ledger Nano S wallet address descriptor
     unsigned char desc[3];
-    desc[0] = 0; // XMSS, SHA2-256
+    desc[0] = XMSS_CUR_SK.hash_func; // XMSS, hash function
     desc[1] = 4; // Height 8
     desc[2] = 0; // SHA256_X
 
@@ -566,183 +668,276 @@ void view_update_state() {
     }
 }
 
-// returns 1 while there is still data to show
-int8_t view_update_review() {
-#define PTR_DIST(p2, p1) ((char *)p2) - ((char *)p1)
-
-    uint8_t elem_idx = 0;
-
-    switch (ctx.qrltx.type) {
-
-        case QRLTX_TX: {
-            strcpy(viewdata.title, "TRANSFER");
-
-            switch (viewdata.idx) {
-                case 0: {
-                    strcpy(viewdata.key, "Source Addr");
-                    viewdata.value[0] = 'Q';
-                    ARRTOHEX(viewdata.value + 1, ctx.qrltx.tx.master.address);
-                    break;
-                }
-                case 1: {
-                    strcpy(viewdata.key, "Fee (QRL)");
-                    AMOUNT_TO_STR(viewdata.value,
-                                  ctx.qrltx.tx.master.amount,
-                                  QUANTA_DECIMALS);
-                    break;
-                }
-                default: {
-                    elem_idx = (viewdata.idx - 2) >> 1;
-                    if (elem_idx >= QRLTX_SUBITEM_MAX) return REVIEW_NO_MORE_DATA;
-                    if (elem_idx >= ctx.qrltx.subitem_count) return REVIEW_NO_MORE_DATA;
-
-                    qrltx_addr_block *dst = &ctx.qrltx.tx.dst[elem_idx];
-
-                    if (viewdata.idx % 2 == 0) {
-                        print_key("Dst %d", elem_idx);
-                        viewdata.value[0] = 'Q';
-                        ARRTOHEX(viewdata.value + 1, dst->address);
-                    } else {
-                        print_key("Amount %d (QRL)", elem_idx);
-                        AMOUNT_TO_STR(viewdata.value, dst->amount, QUANTA_DECIMALS);
-                    }
-                    break;
-                }
-            }
-            break;
-        }
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+#define REVIEW_FMT_ADDRESS      0
+#define REVIEW_FMT_AMOUNT       1
+#define REVIEW_FMT_TOKEN_AMOUNT 2
+#define REVIEW_FMT_HEX          3
+
+typedef struct {
+    const char *key;            // item fields get the item number as argument
+    uint8_t offset;             // from qrltx_t for fixed fields, from the item for item fields
+    uint8_t size;
+    uint8_t format;
+} review_field_t;
+
+typedef struct {
+    uint8_t type;
+    const char *title;
+    const review_field_t *fields;
+    uint8_t num_fields;
+    const review_field_t *item_fields;
+    uint8_t num_item_fields;
+    const char *blob_key;       // items are raw bytes shown as hex pages
+} review_schema_t;
+
+#define REVIEW_FIELD(KEY, MEMBER, FORMAT) \
+    { KEY, offsetof(qrltx_t, MEMBER), sizeof(((qrltx_t *) 0)->MEMBER), FORMAT }
+#define REVIEW_ITEM_FIELD(KEY, ITEM_TYPE, MEMBER, FORMAT) \
+    { KEY, offsetof(ITEM_TYPE, MEMBER), sizeof(((ITEM_TYPE *) 0)->MEMBER), FORMAT }
+#define REVIEW_ARRAY(A) A, sizeof(A) / sizeof(A[0])
+
+static const review_field_t review_master[] = {
+        REVIEW_FIELD("Source Addr", tx.master.address, REVIEW_FMT_ADDRESS),
+        REVIEW_FIELD("Fee (QRL)", tx.master.amount, REVIEW_FMT_AMOUNT),
+};
+
+static const review_field_t review_dst[] = {
+        REVIEW_ITEM_FIELD("Dst %d", qrltx_addr_block, address, REVIEW_FMT_ADDRESS),
+        REVIEW_ITEM_FIELD("Amount %d (QRL)", qrltx_addr_block, amount, REVIEW_FMT_AMOUNT),
+};
+
 #ifdef TXTOKEN_ENABLED
-        case QRLTX_TXTOKEN: {
-            strcpy(viewdata.title, "TRANSFER TOKEN");
-
-            switch (viewdata.idx) {
-                case 0: {
-                    strcpy(viewdata.key, "Source Addr");
-                    viewdata.value[0] = 'Q';
-                    ARRTOHEX(viewdata.value + 1, ctx.qrltx.txtoken.master.address);
-                    break;
-                }
-                case 1: {
-                    strcpy(viewdata.key, "Fee (QRL)");
-                    AMOUNT_TO_STR(viewdata.value,
-                                  ctx.qrltx.txtoken.master.amount,
-                                  QUANTA_DECIMALS);
-                    break;
-                }
-                case 2: {
-                    strcpy(viewdata.key, "Token Hash");
-                    ARRTOHEX(viewdata.value, ctx.qrltx.txtoken.token_hash);
-                    break;
-                }
-                default: {
-                    elem_idx = (viewdata.idx - 3) >> 2;
-                    if (elem_idx >= QRLTX_SUBITEM_MAX) return REVIEW_NO_MORE_DATA;
-                    if (elem_idx >= ctx.qrltx.subitem_count) return REVIEW_NO_MORE_DATA;
-
-                    qrltx_addr_block *dst = &ctx.qrltx.txtoken.dst[elem_idx];
-
-                    if (view_idx % 2 == 0) {
-                        print_key("Dst %d", elem_idx);
-                        viewdata.value[0] = 'Q';
-                        ARRTOHEX(viewdata.value + 1, dst->address);
-                    } else {
-                        print_key("Amount %d (QRL)", elem_idx);
-                        // TODO: Decide what to do with token decimals
-                        AMOUNT_TO_STR(viewdata.value, dst->amount, 0);
-                    }
-                    break;
-                }
-            }
-            break;
-        }
+static const review_field_t review_txtoken[] = {
+        REVIEW_FIELD("Source Addr", txtoken.master.address, REVIEW_FMT_ADDRESS),
+        REVIEW_FIELD("Fee (QRL)", txtoken.master.amount, REVIEW_FMT_AMOUNT),
+        REVIEW_FIELD("Token Hash", txtoken.token_hash, REVIEW_FMT_HEX),
+};
+
+static const review_field_t review_token_dst[] = {
+        REVIEW_ITEM_FIELD("Dst %d", qrltx_addr_block, address, REVIEW_FMT_ADDRESS),
+        // TODO: Decide what to do with token decimals
+        REVIEW_ITEM_FIELD("Amount %d (QRL)", qrltx_addr_block, amount, REVIEW_FMT_TOKEN_AMOUNT),
+};
 #endif
+
 #ifdef SLAVE_ENABLED
-        case QRLTX_SLAVE: {
-            strcpy(viewdata.title, "CREATE SLAVE");
-
-            switch (view_idx) {
-                case 0: {
-                    strcpy(viewdata.key, "Master Addr");
-                    viewdata.value[0] = 'Q';
-                    ARRTOHEX(viewdata.value + 1, ctx.qrltx.slave.master.address);
-                    break;
-                }
-                case 1: {
-                    strcpy(viewdata.key, "Fee (QRL)");
-                    AMOUNT_TO_STR(viewdata.value,
-                                  ctx.qrltx.slave.master.amount,
-                                  QUANTA_DECIMALS);
-                    break;
-                }
-                default: {
-                    elem_idx = (view_idx - 2) >> 1;
-                    if (elem_idx >= QRLTX_SUBITEM_MAX) EXIT_VIEW();
-                    if (elem_idx >= ctx.qrltx.subitem_count) EXIT_VIEW();
-
-                    if (view_idx % 2 == 0) {
-                        print_key("Slave PK %d", elem_idx);
-                        ARRTOHEX(viewdata.value, ctx.qrltx.slave.slaves[elem_idx].pk);
-                    } else {
-                        print_key("Access Type %d", elem_idx);
-                        ARRTOHEX(viewdata.value, ctx.qrltx.slave.slaves[elem_idx].access);
-                    }
-                    break;
-                }
-            }
-            break;
-        }
+static const review_field_t review_slave_master[] = {
+        REVIEW_FIELD("Master Addr", slave.master.address, REVIEW_FMT_ADDRESS),
+        REVIEW_FIELD("Fee (QRL)", slave.master.amount, REVIEW_FMT_AMOUNT),
+};
+
+static const review_field_t review_slaves[] = {
+        REVIEW_ITEM_FIELD("Slave PK %d", qrltx_slave_block, pk, REVIEW_FMT_HEX),
+        REVIEW_ITEM_FIELD("Access Type %d", qrltx_slave_block, access, REVIEW_FMT_HEX),
+};
 #endif
-        case QRLTX_MESSAGE: {
-            strcpy(viewdata.title, "MESSAGE");
-
-            switch (viewdata.idx) {
-                case 0: {
-                    strcpy(viewdata.key, "Source Addr");
-                    viewdata.value[0] = 'Q';
-                    ARRTOHEX(viewdata.value + 1,
-                             ctx.qrltx.msg.master.address);
-                    break;
-                }
-                case 1: {
-                    strcpy(viewdata.key, "Fee (QRL)");
-                    AMOUNT_TO_STR(viewdata.value,
-                                  ctx.qrltx.msg.master.amount,
-                                  QUANTA_DECIMALS);
-                    break;
-                }
-                case 2: {
-                    uint8_t numchars = ctx.qrltx.subitem_count;
-
-                    if (numchars <= MAX_CHARS_HEXMESSAGE) {
-                        print_key("Message");
-                    } else {
-                        numchars = MAX_CHARS_HEXMESSAGE;
-                        print_key("Message [1/2]");
-                    }
-                    array_to_hexstr(viewdata.value,
-                                    ctx.qrltx.msg.message,
-                                    numchars);
-                    break;
-                }
-                case 3: {
-                    if (ctx.qrltx.subitem_count <= MAX_CHARS_HEXMESSAGE) {
-                        return REVIEW_NO_MORE_DATA;
-                    }
-                    print_key("Message [2/2]");
-                    array_to_hexstr(viewdata.value,
-                                    ctx.qrltx.msg.message + MAX_CHARS_HEXMESSAGE,
-                                    ctx.qrltx.subitem_count - MAX_CHARS_HEXMESSAGE);
-                    break;
-                }
-                default: {
-                    return REVIEW_NO_MORE_DATA;
-                }
-            }
-            break;
+
+static const review_schema_t review_schemas[] = {
+        {QRLTX_TX, "TRANSFER", REVIEW_ARRAY(review_master), REVIEW_ARRAY(review_dst), NULL},
+#ifdef TXTOKEN_ENABLED
+        {QRLTX_TXTOKEN, "TRANSFER TOKEN", REVIEW_ARRAY(review_txtoken), REVIEW_ARRAY(review_token_dst), NULL},
+#endif
+#ifdef SLAVE_ENABLED
+        {QRLTX_SLAVE, "CREATE SLAVE", REVIEW_ARRAY(review_slave_master), REVIEW_ARRAY(review_slaves), NULL},
+#endif
+        {QRLTX_MESSAGE, "MESSAGE", REVIEW_ARRAY(review_master), NULL, 0, "Message"},
+};
+
+static const review_schema_t *review_get_schema(uint8_t type) {
+    for (uint8_t i = 0; i < sizeof(review_schemas) / sizeof(review_schemas[0]); i++) {
+        if (review_schemas[i].type == type) {
+            return &review_schemas[i];
         }
+    }
+    return NULL;
+}
+
+static void review_render(const review_field_t *field, const uint8_t *p, uint8_t item) {
+    print_key((const char *) PIC(field->key), item);
+
+    switch (field->format) {
+        case REVIEW_FMT_ADDRESS:
+            viewdata.value[0] = 'Q';
+            array_to_hexstr(viewdata.value + 1, p, field->size);
+            break;
+        case REVIEW_FMT_AMOUNT:
+            AMOUNT_TO_STR(viewdata.value, p, QUANTA_DECIMALS);
+            break;
+        case REVIEW_FMT_TOKEN_AMOUNT:
+            AMOUNT_TO_STR(viewdata.value, p, 0);
+            break;
         default:
-            return REVIEW_NO_MORE_DATA;
+            array_to_hexstr(viewdata.value, p, field->size);
+            break;
+    }
+}
+
+// Every page of the packet under review, laid out once when it is parsed
+#define REVIEW_MAX_PAGES        9       // token transfer: 3 fields, then 2 per item
+#define REVIEW_PAGE_BLOB        0xFF
+
+// Pages of a schema with a full packet of items
+#define REVIEW_PAGES(FIELDS, ITEM_FIELDS) \
+    (sizeof(FIELDS) / sizeof(FIELDS[0]) + QRLTX_SUBITEM_MAX * (sizeof(ITEM_FIELDS) / sizeof(ITEM_FIELDS[0])))
+#define REVIEW_BLOB_PAGES(FIELDS, SIZE) \
+    (sizeof(FIELDS) / sizeof(FIELDS[0]) + ((SIZE) + MAX_CHARS_HEXMESSAGE - 1) / MAX_CHARS_HEXMESSAGE)
+
+_Static_assert(REVIEW_PAGES(review_master, review_dst) <= REVIEW_MAX_PAGES, "transfer review");
+#ifdef TXTOKEN_ENABLED
+_Static_assert(REVIEW_PAGES(review_txtoken, review_token_dst) <= REVIEW_MAX_PAGES, "token transfer review");
+#endif
+#ifdef SLAVE_ENABLED
+_Static_assert(REVIEW_PAGES(review_slave_master, review_slaves) <= REVIEW_MAX_PAGES, "slave review");
+#endif
+_Static_assert(REVIEW_BLOB_PAGES(review_master, QRLTX_MESSAGE_SUBITEM_MAX) <= REVIEW_MAX_PAGES, "message review");
+
+// The Nano S renders every page again, its RAM is kept for the page table
+#if defined(TARGET_NANOX) || defined(TARGET_NANOS2)
+#define REVIEW_CACHE_SIZE       4
+// Longest value: 'Q' and a hex address, or a page of hex message
+#define REVIEW_CACHE_VALUE      (2 * MAX_CHARS_HEXMESSAGE + 1)
+#endif
+
+typedef struct {
+    uint8_t field;              // index in fields then item_fields, or REVIEW_PAGE_BLOB
+    uint8_t item;               // item number in the key, or the blob page
+    uint8_t size;
+    uint8_t offset;             // from qrltx_t
+} review_page_t;
+
+#ifdef REVIEW_CACHE_SIZE
+typedef struct {
+    int8_t idx;                 // -1 when empty
+    char key[MAX_CHARS_PER_KEY_LINE];
+    char value[REVIEW_CACHE_VALUE];
+} review_cached_t;
+#endif
+
+typedef struct {
+    const review_schema_t *schema;
+    uint8_t num_pages;
+    uint8_t blob_pages;
+    review_page_t pages[REVIEW_MAX_PAGES];
+#ifdef REVIEW_CACHE_SIZE
+    uint8_t cache_next;
+    review_cached_t cache[REVIEW_CACHE_SIZE];
+#endif
+} review_table_t;
+
+static review_table_t review_table;
+
+static void review_add_page(uint8_t field, uint8_t item, uint8_t size, uint8_t offset) {
+    if (review_table.num_pages == REVIEW_MAX_PAGES) {
+        // A page left out would not be reviewed, the schema asserts above should prevent it
+        review_table.schema = NULL;
+        THROW(APDU_CODE_EXECUTION_ERROR);
+    }
+    review_page_t *page = &review_table.pages[review_table.num_pages++];
+    page->field = field;
+    page->item = item;
+    page->size = size;
+    page->offset = offset;
+}
+
+static void review_build() {
+    MEMSET(&review_table, 0, sizeof(review_table));
+#ifdef REVIEW_CACHE_SIZE
+    for (uint8_t i = 0; i < REVIEW_CACHE_SIZE; i++) {
+        review_table.cache[i].idx = -1;
     }
+#endif
+
+    const review_schema_t *review = review_get_schema(ctx.qrltx.type);
+    const qrltx_schema_t *schema = get_qrltx_schema(ctx.qrltx.type);
+    if (review == NULL || schema == NULL) {
+        return;
+    }
+    review_table.schema = review;
+
+    const review_field_t *fields = (const review_field_t *) PIC(review->fields);
+    for (uint8_t i = 0; i < review->num_fields; i++) {
+        review_add_page(i, 0, fields[i].size, fields[i].offset);
+    }
+
+    const uint8_t items = qrltx_stream_items(&ctx.qrltx_stream);
+    if (review->blob_key != NULL) {
+        review_table.blob_pages = (items + MAX_CHARS_HEXMESSAGE - 1) / MAX_CHARS_HEXMESSAGE;
+        for (uint8_t page = 0; page < review_table.blob_pages; page++) {
+            const uint16_t offset = (uint16_t) page * MAX_CHARS_HEXMESSAGE;
+            const uint8_t numchars = items - offset < MAX_CHARS_HEXMESSAGE ? items - offset : MAX_CHARS_HEXMESSAGE;
+            review_add_page(REVIEW_PAGE_BLOB, page, numchars, schema->items_offset + offset);
+        }
+        return;
+    }
+
+    const review_field_t *item_fields = (const review_field_t *) PIC(review->item_fields);
+    for (uint8_t elem_idx = 0; elem_idx < items; elem_idx++) {
+        for (uint8_t i = 0; i < review->num_item_fields; i++) {
+            review_add_page(review->num_fields + i,
+                            ctx.qrltx_stream.item_base + elem_idx,
+                            item_fields[i].size,
+                            schema->items_offset + elem_idx * schema->item_size + item_fields[i].offset);
+        }
+    }
+}
+
+static void review_render_page(const review_page_t *page) {
+    const review_schema_t *review = review_table.schema;
+    const uint8_t *p = (const uint8_t *) &ctx.qrltx + page->offset;
+
+    if (page->field == REVIEW_PAGE_BLOB) {
+        if (review_table.blob_pages == 1) {
+            print_key("%s", (const char *) PIC(review->blob_key));
+        } else {
+            print_key("%s [%d/%d]", (const char *) PIC(review->blob_key), page->item + 1, review_table.blob_pages);
+        }
+        array_to_hexstr(viewdata.value, p, page->size);
+        return;
+    }
+
+    const review_field_t *field;
+    if (page->field < review->num_fields) {
+        field = (const review_field_t *) PIC(review->fields) + page->field;
+    } else {
+        field = (const review_field_t *) PIC(review->item_fields) + page->field - review->num_fields;
+    }
+    review_render(field, p, page->item);
+}
+
+// returns 1 while there is still data to show
+int8_t view_update_review() {
+    if (review_table.schema == NULL || viewdata.idx < 0 || viewdata.idx >= review_table.num_pages) {
+        return REVIEW_NO_MORE_DATA;
+    }
+
+    strcpy(viewdata.title, (const char *) PIC(review_table.schema->title));
+
+#ifdef REVIEW_CACHE_SIZE
+    for (uint8_t i = 0; i < REVIEW_CACHE_SIZE; i++) {
+        const review_cached_t *cached = &review_table.cache[i];
+        if (cached->idx == viewdata.idx) {
+            strcpy(viewdata.key, cached->key);
+            strcpy(viewdata.value, cached->value);
+            return REVIEW_DATA_AVAILABLE;
+        }
+    }
+
+#endif
+
+    review_render_page(&review_table.pages[viewdata.idx]);
+
+#ifdef REVIEW_CACHE_SIZE
+    if (strlen(viewdata.value) < sizeof(review_table.cache[0].value)) {
+        review_cached_t *cached = &review_table.cache[review_table.cache_next];
+        review_table.cache_next = (review_table.cache_next + 1) % REVIEW_CACHE_SIZE;
+        cached->idx = viewdata.idx;
+        strcpy(cached->key, viewdata.key);
+        strcpy(cached->value, viewdata.value);
+    }
+#endif
 
     return REVIEW_DATA_AVAILABLE;
 }
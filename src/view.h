@@ -43,6 +43,7 @@ void view_idle_show(void);
 void view_sign_show();
 void view_review_show();
 void view_setidx_show();
+void view_switch_tree_show();
 void view_address_show();
 
 #define print_key(...) snprintf(viewdata.key, sizeof(viewdata.key), __VA_ARGS__);
@@ -15,6 +15,11 @@
 ********************************************************************************/
 #include <gmock/gmock.h>
 #include <zxmacros.h>
+#include <utf8.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
 
 namespace {
     TEST(ASCIIFY, pure) {
@@ -116,4 +121,116 @@ namespace {
         EXPECT_STREQ(want, data);
     }
 
+
+    // asciify_ext as it was before the ASCII fast path
+    size_t reference_asciify_ext(const char *utf8_in, char *ascii_only_out) {
+        void *p = (void *) utf8_in;
+        char *q = ascii_only_out;
+
+        while (*((char *) p) && utf8valid(p) == 0) {
+            utf8_int32_t tmp_codepoint = 0;
+            p = utf8codepoint(p, &tmp_codepoint);
+            *q = (tmp_codepoint >= 32 && tmp_codepoint <= 0x7F) ? tmp_codepoint : '.';
+            q++;
+        }
+
+        *q = 0;
+        return q - ascii_only_out;
+    }
+
+    std::string random_text(std::mt19937 &rng, size_t len, int invalid_percent) {
+        const char *pieces[] = {"a", "Z", " ", "~", "\x7f", "\x05", "\n", "ñ", "哈", "😀", "\xc3", "\x80", "\xc0\xaf"};
+        std::string s;
+        while (s.size() < len) {
+            const uint32_t r = rng() % 100;
+            if (r < 70) {
+                s += (char) (32 + rng() % 95);
+            } else if ((int) (r - 70) < invalid_percent) {
+                s += pieces[10 + rng() % 3];
+            } else {
+                s += pieces[rng() % 10];
+            }
+        }
+        return s;
+    }
+
+    TEST(ASCIIFY, fast_path_matches_reference) {
+        std::mt19937 rng(5);
+        std::vector<char> in(600);
+        std::vector<char> have(600);
+        std::vector<char> want(600);
+
+        for (int round = 0; round < 3000; round++) {
+            const std::string text = random_text(rng, rng() % 200, round % 2 == 0 ? 0 : 2);
+            // Every offset within a block, the fast path aligns its loads
+            const size_t offset = round % 17;
+            memcpy(in.data() + offset, text.c_str(), text.size() + 1);
+
+            const size_t want_len = reference_asciify_ext(in.data() + offset, want.data());
+            const size_t have_len = asciify_ext(in.data() + offset, have.data());
+            ASSERT_EQ(want_len, have_len) << text;
+            ASSERT_STREQ(want.data(), have.data()) << text;
+
+            ASSERT_EQ(want_len, asciify(in.data() + offset));
+            ASSERT_STREQ(want.data(), in.data() + offset) << text;
+        }
+    }
+
+    TEST(ASCIIFY, long_runs) {
+        std::string text(300, 'x');
+        text[100] = '\t';
+        text += "ñ";
+        text += std::string(100, 'y');
+        text[250] = 0x7F;
+
+        char have[512];
+        char want[512];
+        ASSERT_EQ(reference_asciify_ext(text.c_str(), want), asciify_ext(text.c_str(), have));
+        EXPECT_STREQ(want, have);
+        EXPECT_EQ('.', have[100]);
+        EXPECT_EQ('.', have[300]);
+    }
+
+    TEST(ASCIIFY, invalid_after_ascii) {
+        char input[] = "0123456789abcdefghijklmnopqrstuvwxyz\x80tail";
+        char have[64];
+        memset(have, 'x', sizeof(have));
+
+        EXPECT_EQ(0, asciify_ext(input, have));
+        EXPECT_STREQ("", have);
+    }
+
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(ASCIIFY, DISABLED_benchmark) {
+        std::mt19937 rng(6);
+        std::string ascii;
+        while (ascii.size() < 1024) {
+            ascii += (char) (32 + rng() % 95);
+        }
+        std::string mixed = random_text(rng, 1024, 0);
+
+        std::vector<char> out(2048);
+        const size_t rounds = 20;
+        const std::string *inputs[] = {&ascii, &mixed};
+        const char *names[] = {"ascii", "mixed"};
+
+        for (int k = 0; k < 2; k++) {
+            const std::string &text = *inputs[k];
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < rounds; r++) {
+                reference_asciify_ext(text.c_str(), out.data());
+            }
+            const double t_ref = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < rounds * 100; r++) {
+                asciify_ext(text.c_str(), out.data());
+            }
+            const double t_fast = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 100;
+
+            const double mb = (double) (text.size() * rounds) / 1e6;
+            std::cout << names[k] << " reference " << mb / t_ref << " MB/s, fast path " << mb / t_fast << " MB/s" << std::endl;
+        }
+    }
 }
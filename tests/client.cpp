@@ -0,0 +1,262 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "qrl/client.h"
+#include "qrl/sim_transport.h"
+#include "sim.h"
+
+namespace {
+    const uint16_t SW_EXECUTION_ERROR = 0x6400;
+
+    typedef std::vector<uint8_t> Bytes;
+
+    // Transfer with one destination, as in sim/traces/sign.trace
+    std::vector<qrl::Apdu> transfer() {
+        Bytes tx(2 + 2 * 47, 0);
+        tx[0] = 0;                              // QRLTX_TX
+        tx[1] = 1;
+        memset(&tx[2], 0x01, 39);
+        tx[2 + 39 + 7] = 5;                     // fee
+        memset(&tx[2 + 47], 0x02, 39);
+        tx[2 + 47 + 39 + 6] = 1;                // amount
+        return qrl::encode_sign(tx.data(), tx.size());
+    }
+
+    // The in-process app behind a window of commands, as TcpTransport
+    // pipelines them. Each command runs once its reply is received, and
+    // replies can be changed on the way back.
+    class WindowedSim : public qrl::Transport {
+    public:
+        explicit WindowedSim(size_t window) : window_(window) {}
+
+        void send(const uint8_t *cmd, size_t cmd_len) override {
+            if (pending_.size() == window_) {
+                throw qrl::TransportError("window full");
+            }
+            pending_.emplace_back(cmd, cmd + cmd_len);
+            sent.push_back(pending_.back());
+            max_seen = std::max(max_seen, pending_.size());
+        }
+
+        size_t receive(uint8_t *resp, size_t resp_cap) override {
+            if (pending_.empty()) {
+                throw qrl::TransportError("no command in flight");
+            }
+            const Bytes cmd = pending_.front();
+            pending_.pop_front();
+
+            uint8_t reply[qrl::REPLY_MAX_SIZE];
+            size_t len = sim_.exchange(cmd.data(), cmd.size(), reply, sizeof(reply));
+            if (tamper) {
+                tamper(cmd, reply, len);
+            }
+            if (len > resp_cap) {
+                throw qrl::TransportError("reply too long");
+            }
+            memcpy(resp, reply, len);
+            return len;
+        }
+
+        size_t max_in_flight() const override { return window_; }
+
+        size_t in_flight() const { return pending_.size(); }
+
+        size_t count(uint8_t ins) const {
+            return std::count_if(sent.begin(), sent.end(), [ins](const Bytes &c) { return c[1] == ins; });
+        }
+
+        std::function<void(const Bytes &cmd, uint8_t *reply, size_t &len)> tamper;
+        std::vector<Bytes> sent;
+        size_t max_seen = 0;
+
+    private:
+        const size_t window_;
+        qrl::SimTransport sim_;
+        std::deque<Bytes> pending_;
+    };
+
+    // Replaces the reply to the n-th INS_SIGN_NEXT (from 0) with a bare status word
+    std::function<void(const Bytes &, uint8_t *, size_t &)> fail_chunk(size_t n, uint16_t sw) {
+        std::shared_ptr<size_t> seen = std::make_shared<size_t>(0);
+        return [seen, n, sw](const Bytes &cmd, uint8_t *reply, size_t &len) {
+            if (cmd[1] != qrl::INS_SIGN_NEXT || (*seen)++ != n) {
+                return;
+            }
+            reply[0] = static_cast<uint8_t>(sw >> 8);
+            reply[1] = static_cast<uint8_t>(sw);
+            len = 2;
+        };
+    }
+
+    class CLIENT : public ::testing::Test {
+    protected:
+        static void SetUpTestCase() {
+            sim_init(nullptr);
+            sim_ux_select("Init Tree");
+            image = sim_snapshot_take();
+
+            // Reference signature, the index is the same in every test
+            qrl::SimTransport sim;
+            qrl::Client client(sim);
+            pk = client.public_key();
+            client.sign(transfer(), expected);
+            sim_snapshot_restore(image);
+        }
+
+        static void TearDownTestCase() {
+            sim_snapshot_free(image);
+        }
+
+        void SetUp() override {
+            sim_snapshot_restore(image);
+        }
+
+        static sim_snapshot_t *image;
+        static qrl::PublicKey pk;
+        static qrl::Signature expected;
+    };
+
+    sim_snapshot_t *CLIENT::image;
+    qrl::PublicKey CLIENT::pk;
+    qrl::Signature CLIENT::expected;
+
+    TEST_F(CLIENT, sign_pipelines_the_chunks) {
+        for (size_t window : {1u, 4u, 16u}) {
+            SCOPED_TRACE(window);
+            sim_snapshot_restore(image);
+            WindowedSim transport(window);
+            qrl::Client client(transport);
+
+            qrl::Signature sig;
+            memset(&sig, 0xEE, sizeof(sig));
+            client.sign(transfer(), sig);
+
+            EXPECT_EQ(0, memcmp(expected.bytes, sig.bytes, qrl::SIG_SIZE));
+            EXPECT_EQ(qrl::SIG_CHUNKS, transport.count(qrl::INS_SIGN_NEXT));
+            EXPECT_EQ(std::min(window, qrl::SIG_CHUNKS), transport.max_seen);
+            EXPECT_EQ(0u, transport.in_flight());
+
+            const qrl::State state = client.get_state();
+            EXPECT_EQ(qrl::APPMODE_READY, state.mode);
+            EXPECT_EQ(1, state.index);
+        }
+    }
+
+    TEST_F(CLIENT, error_mid_window_drains_the_chunks_in_flight) {
+        WindowedSim transport(4);
+        transport.tamper = fail_chunk(2, SW_EXECUTION_ERROR);
+        qrl::Client client(transport);
+
+        qrl::Signature sig;
+        try {
+            client.sign(transfer(), sig);
+            FAIL() << "the failed chunk was not reported";
+        } catch (const qrl::DeviceError &e) {
+            EXPECT_EQ(SW_EXECUTION_ERROR, e.sw());
+        }
+
+        // Chunks 0 to 2 each refilled the window before their status word was
+        // read, nothing is sent once the error is seen
+        EXPECT_EQ(4u + 3u, transport.count(qrl::INS_SIGN_NEXT));
+        EXPECT_EQ(0u, transport.in_flight());
+        EXPECT_EQ(0, memcmp(expected.bytes, sig.bytes, qrl::SIG_CHUNK_SIZE[0] + qrl::SIG_CHUNK_SIZE[1]));
+
+        // The next reply is the one to the next command
+        transport.tamper = nullptr;
+        const qrl::State state = client.get_state();
+        EXPECT_EQ(qrl::APPMODE_READY, state.mode);
+        EXPECT_EQ(1, state.index);
+        EXPECT_EQ(pk, client.public_key());
+    }
+
+    TEST_F(CLIENT, bad_chunk_size_drains_the_chunks_in_flight) {
+        WindowedSim transport(16);
+        transport.tamper = [](const Bytes &cmd, uint8_t *reply, size_t &len) {
+            // Drops one byte of the first chunk
+            if (cmd[1] == qrl::INS_SIGN_NEXT && len == qrl::SIG_CHUNK_SIZE[0] + 2) {
+                reply[len - 3] = reply[len - 2];
+                reply[len - 2] = reply[len - 1];
+                len--;
+            }
+        };
+        qrl::Client client(transport);
+
+        qrl::Signature sig;
+        EXPECT_THROW(client.sign(transfer(), sig), qrl::TransportError);
+        EXPECT_EQ(qrl::SIG_CHUNKS, transport.count(qrl::INS_SIGN_NEXT));
+        EXPECT_EQ(0u, transport.in_flight());
+
+        transport.tamper = nullptr;
+        EXPECT_EQ(1, client.get_state().index);
+    }
+
+    TEST_F(CLIENT, get_trees_reads_every_page) {
+        WindowedSim transport(1);
+        qrl::Client client(transport);
+
+        const qrl::Trees trees = client.get_trees();
+        // 4 records do not fit in one page
+        EXPECT_EQ(1u, transport.count(qrl::INS_GET_TREES));
+        ASSERT_EQ(1u, transport.count(qrl::INS_NEXT_PAGE));
+        EXPECT_EQ(2, transport.sent.back()[2]);
+
+        EXPECT_EQ(0, trees.current);
+        ASSERT_EQ(4u, trees.trees.size());
+        EXPECT_EQ(qrl::APPMODE_READY, trees.trees[0].state.mode);
+        EXPECT_EQ(0, trees.trees[0].state.index);
+        EXPECT_EQ(pk, trees.trees[0].pk);
+        for (size_t i = 1; i < trees.trees.size(); i++) {
+            EXPECT_EQ(qrl::APPMODE_NOT_INITIALIZED, trees.trees[i].state.mode);
+            EXPECT_EQ(qrl::PublicKey(), trees.trees[i].pk);
+        }
+    }
+
+    TEST_F(CLIENT, get_trees_rejects_pages_out_of_order) {
+        for (uint8_t page : {1, 3}) {
+            SCOPED_TRACE(page);
+            WindowedSim transport(1);
+            transport.tamper = [page](const Bytes &cmd, uint8_t *reply, size_t &len) {
+                if (cmd[1] == qrl::INS_NEXT_PAGE && len > qrl::CHAIN_PAGE_HEADER) {
+                    reply[0] = page;
+                }
+            };
+            qrl::Client client(transport);
+            EXPECT_THROW(client.get_trees(), qrl::TransportError);
+        }
+    }
+
+    TEST_F(CLIENT, get_trees_rejects_a_short_record) {
+        WindowedSim transport(1);
+        transport.tamper = [](const Bytes &cmd, uint8_t *reply, size_t &len) {
+            // The last page loses a byte, the page count still says it is complete
+            if (cmd[1] == qrl::INS_NEXT_PAGE) {
+                reply[len - 3] = reply[len - 2];
+                reply[len - 2] = reply[len - 1];
+                len--;
+            }
+        };
+        qrl::Client client(transport);
+        EXPECT_THROW(client.get_trees(), qrl::TransportError);
+    }
+}
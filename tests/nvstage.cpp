@@ -0,0 +1,106 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+#include <vector>
+
+#include "app_types.h"
+#include "nvstage.h"
+#include "storage.h"
+#include "sim.h"
+
+extern "C" app_ctx_t ctx;
+
+namespace {
+    const uint16_t SW_EXECUTION_ERROR = 0x6400;
+
+    // Status word thrown by nvstage_write, 0 when it returns
+    uint16_t stage(volatile void *dst, const void *src, uint16_t len) {
+        volatile uint16_t sw = 0;
+        BEGIN_TRY
+        {
+            TRY
+            {
+                nvstage_write(dst, src, len);
+            }
+            CATCH_OTHER(e)
+            {
+                sw = e;
+            }
+            FINALLY
+            {
+            }
+        }
+        END_TRY;
+        return sw;
+    }
+
+    std::vector<uint8_t> app_data() {
+        const uint8_t *p = (const uint8_t *) &N_appdata;
+        return std::vector<uint8_t>(p, p + sizeof(app_data_t));
+    }
+
+    TEST(NVSTAGE, largest_group_fits) {
+        sim_init(nullptr);
+        EXPECT_EQ(3u, NVSTAGE_MAX_PAGES);
+
+        const uint8_t known = 1;
+        const uint8_t last = SEED_MODE_2;
+        uint8_t hash[32];
+        memset(hash, 0x5A, sizeof(hash));
+
+        ASSERT_EQ(0, stage(N_appdata.seed_hash_2, hash, sizeof(hash)));
+        ASSERT_EQ(0, stage(&N_appdata.seed_mode_known, &known, 1));
+        ASSERT_EQ(0, stage(&N_appdata.seed_mode_last, &last, 1));
+        EXPECT_EQ(0, N_appdata.seed_mode_known);
+
+        nvstage_commit();
+        EXPECT_EQ(known, N_appdata.seed_mode_known);
+        EXPECT_EQ(last, N_appdata.seed_mode_last);
+        EXPECT_EQ(0, memcmp((const void *) N_appdata.seed_hash_2, hash, sizeof(hash)));
+    }
+
+    TEST(NVSTAGE, group_larger_than_the_stage_throws) {
+        sim_init(nullptr);
+        const std::vector<uint8_t> before = app_data();
+        volatile uint8_t *base = (volatile uint8_t *) &N_appdata;
+
+        const uint8_t value = 0xAB;
+        for (uint16_t page = 0; page < NVSTAGE_MAX_PAGES; page++) {
+            ASSERT_EQ(0, stage(base + page * NVSTAGE_PAGE_SIZE + 10, &value, 1));
+        }
+        EXPECT_EQ(SW_EXECUTION_ERROR, stage(base + NVSTAGE_MAX_PAGES * NVSTAGE_PAGE_SIZE + 10, &value, 1));
+
+        // the group is dropped, nothing was written
+        nvstage_commit();
+        EXPECT_EQ(before, app_data());
+    }
+
+    TEST(NVSTAGE, group_drops_the_streamed_tx) {
+        sim_init(nullptr);
+        qrltx_stream_init(&ctx.qrltx_stream);
+        ctx.qrltx_stream.size = 100;
+        ctx.qrltx_stream.offset = 100;
+        ASSERT_TRUE(qrltx_stream_done(&ctx.qrltx_stream));
+
+        const uint8_t tree_idx = 1;
+        ASSERT_EQ(0, stage(&N_appdata.tree_idx, &tree_idx, 1));
+        nvstage_commit();
+
+        EXPECT_EQ(tree_idx, N_appdata.tree_idx);
+        EXPECT_FALSE(qrltx_stream_done(&ctx.qrltx_stream));
+        EXPECT_EQ(0, ctx.qrltx_stream.size);
+    }
+}
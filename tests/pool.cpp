@@ -0,0 +1,302 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "qrl/pool.h"
+#include "qrl/sim_transport.h"
+#include "sim.h"
+
+// The simulator has a single device per process, every device of the pool is
+// a forked simulator served on its own port, as qrl_sim --listen does. Trees
+// start near the end (INS_SETIDX takes an index below 256) so the pool runs
+// them out with a few signatures.
+
+namespace {
+    const uint16_t SW_OK = 0x9000;
+
+    // Transfer with one destination, as in sim/traces/sign.trace
+    std::vector<qrl::Apdu> transfer() {
+        std::vector<uint8_t> tx(2 + 2 * 47, 0);
+        tx[0] = 0;                              // QRLTX_TX
+        tx[1] = 1;
+        memset(&tx[2], 0x01, 39);
+        tx[2 + 39 + 7] = 5;                     // fee
+        memset(&tx[2 + 47], 0x02, 39);
+        tx[2 + 47 + 39 + 6] = 1;                // amount
+        return qrl::encode_sign(tx.data(), tx.size());
+    }
+
+    uint16_t signature_index(const qrl::Signature &sig) {
+        return static_cast<uint16_t>(sig.bytes[2] << 8 | sig.bytes[3]);
+    }
+
+    uint16_t sim_apdu(uint8_t ins, const std::vector<uint8_t> &data) {
+        std::vector<uint8_t> cmd = {qrl::CLA, ins, 0, 0, static_cast<uint8_t>(data.size())};
+        cmd.insert(cmd.end(), data.begin(), data.end());
+        uint8_t resp[qrl::REPLY_MAX_SIZE];
+        uint16_t resp_len = 0;
+        return sim_exchange(cmd.data(), static_cast<uint16_t>(cmd.size()), resp, &resp_len);
+    }
+
+    // Port the kernel hands out, free again once the probe is closed
+    uint16_t free_port() {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0 ||
+            getsockname(fd, (sockaddr *) &addr, &len) != 0) {
+            throw std::runtime_error("no free port");
+        }
+        close(fd);
+        return ntohs(addr.sin_port);
+    }
+
+    class ForkedDevice {
+    public:
+        ForkedDevice(const sim_snapshot_t *image, uint8_t index, bool approve) {
+            sim_snapshot_restore(image);
+            EXPECT_EQ(SW_OK, sim_apdu(qrl::INS_SETIDX, {index}));
+
+            const uint16_t port = free_port();
+            sim_set_approve(approve ? 1 : 0);
+            pid_ = sim_fork();
+            if (pid_ == 0) {
+                sim_serve_tcp(port);
+                _exit(1);
+            }
+            sim_set_approve(1);
+
+            // The child may not be listening yet
+            for (int attempt = 0; transport_ == nullptr; attempt++) {
+                try {
+                    transport_.reset(new qrl::TcpTransport("127.0.0.1", port));
+                } catch (const qrl::TransportError &) {
+                    if (attempt == 200) {
+                        throw;
+                    }
+                    usleep(10000);
+                }
+            }
+        }
+
+        ~ForkedDevice() {
+            transport_.reset();
+            kill(pid_, SIGKILL);
+            waitpid(pid_, nullptr, 0);
+        }
+
+        qrl::Transport *transport() { return transport_.get(); }
+
+    private:
+        int pid_;
+        std::unique_ptr<qrl::TcpTransport> transport_;
+    };
+
+    class POOL : public ::testing::Test {
+    protected:
+        // Keygen runs once, every device starts from these images
+        static void SetUpTestCase() {
+            sim_init(nullptr);
+            sim_ux_select("Init Tree");
+            qrl::SimTransport sim;
+            qrl::Client client(sim);
+            pk[0] = client.public_key();
+            one_tree = sim_snapshot_take();
+
+            client.switch_tree();
+            sim_ux_select("Init Tree");
+            pk[1] = client.public_key();
+            client.switch_tree();
+            two_trees = sim_snapshot_take();
+        }
+
+        static void TearDownTestCase() {
+            sim_snapshot_free(one_tree);
+            sim_snapshot_free(two_trees);
+        }
+
+        void add(const sim_snapshot_t *image, uint8_t index, bool approve = true) {
+            devices.emplace_back(new ForkedDevice(image, index, approve));
+            transports.push_back(devices.back()->transport());
+        }
+
+        // Signs and waits, the next request sees the device idle again
+        qrl::PoolResult sign(qrl::Pool &pool) {
+            qrl::Signature sig;
+            const qrl::PoolResult r = pool.sign(packets, &sig).get();
+            EXPECT_EQ(r.index, signature_index(sig));
+            return r;
+        }
+
+        static sim_snapshot_t *one_tree;
+        static sim_snapshot_t *two_trees;
+        static qrl::PublicKey pk[2];
+
+        const std::vector<qrl::Apdu> packets = transfer();
+        std::vector<std::unique_ptr<ForkedDevice>> devices;
+        std::vector<qrl::Transport *> transports;
+    };
+
+    sim_snapshot_t *POOL::one_tree;
+    sim_snapshot_t *POOL::two_trees;
+    qrl::PublicKey POOL::pk[2];
+
+    TEST_F(POOL, requests_go_to_the_device_with_the_most_signatures_left) {
+        add(two_trees, 250);
+        add(two_trees, 240);
+        add(two_trees, 253);
+        qrl::Pool pool(transports, 0);
+        pool.wait_idle();
+        EXPECT_EQ(6u + 16u + 3u + 3u * 256u, pool.capacity());
+
+        for (uint16_t i = 0; i < 10; i++) {
+            const qrl::PoolResult r = sign(pool);
+            EXPECT_EQ(1u, r.device);
+            EXPECT_EQ(240 + i, r.index);
+            EXPECT_EQ(pk[0], r.pk);
+        }
+
+        // Device 0 and 1 both have 6 left now, then they take turns
+        qrl::PoolResult r = sign(pool);
+        EXPECT_EQ(0u, r.device);
+        EXPECT_EQ(250, r.index);
+        r = sign(pool);
+        EXPECT_EQ(1u, r.device);
+        EXPECT_EQ(250, r.index);
+
+        const std::vector<qrl::DeviceStatus> status = pool.status();
+        EXPECT_EQ(1u, status[0].signatures);
+        EXPECT_EQ(11u, status[1].signatures);
+        EXPECT_EQ(0u, status[2].signatures);
+        for (const qrl::DeviceStatus &s : status) {
+            EXPECT_EQ(0u, s.rollovers);
+        }
+    }
+
+    TEST_F(POOL, idle_device_rolls_over_ahead_of_time) {
+        add(two_trees, 250);
+        add(two_trees, 200);
+        qrl::Pool pool(transports, 8);
+        pool.wait_idle();
+
+        std::vector<qrl::DeviceStatus> status = pool.status();
+        EXPECT_EQ(1u, status[0].rollovers);
+        EXPECT_EQ(0, status[0].current.index);
+        ASSERT_TRUE(status[0].other_known);
+        EXPECT_EQ(250, status[0].other.index);
+        EXPECT_EQ(0u, status[1].rollovers);
+        EXPECT_EQ(200, status[1].current.index);
+
+        // The fresh tree has the most signatures left
+        const qrl::PoolResult r = sign(pool);
+        EXPECT_EQ(0u, r.device);
+        EXPECT_EQ(0, r.index);
+        EXPECT_EQ(pk[1], r.pk);
+    }
+
+    TEST_F(POOL, refused_rollover_is_not_asked_again) {
+        // Device 0 rejects everything shown to its user
+        add(two_trees, 250, false);
+        add(two_trees, 200);
+        qrl::Pool pool(transports, 8);
+        pool.wait_idle();
+
+        std::vector<qrl::DeviceStatus> status = pool.status();
+        EXPECT_TRUE(status[0].rollover_refused);
+        EXPECT_EQ(0u, status[0].rollovers);
+        EXPECT_EQ(250, status[0].current.index);
+        EXPECT_EQ(6u + 56u + 256u + 256u, pool.capacity());
+
+        for (uint16_t i = 0; i < 3; i++) {
+            const qrl::PoolResult r = sign(pool);
+            EXPECT_EQ(1u, r.device);
+            EXPECT_EQ(200 + i, r.index);
+        }
+
+        // Still idle and below the threshold, the switch is not shown again
+        pool.wait_idle();
+        status = pool.status();
+        EXPECT_TRUE(status[0].rollover_refused);
+        EXPECT_EQ(0u, status[0].rollovers);
+        EXPECT_EQ(0u, status[0].signatures);
+        EXPECT_EQ(3u, status[1].signatures);
+        EXPECT_EQ(0u, status[1].rollovers);
+    }
+
+    TEST_F(POOL, queued_requests_fail_once_every_tree_is_spent) {
+        // The other trees were never generated, there is nothing to roll over to
+        add(one_tree, 255);
+        add(one_tree, 255);
+        qrl::Pool pool(transports, 16);
+        pool.wait_idle();
+        EXPECT_EQ(2u, pool.capacity());
+
+        qrl::Signature sigs[3];
+        std::vector<std::future<qrl::PoolResult>> done;
+        for (qrl::Signature &sig : sigs) {
+            done.push_back(pool.sign(packets, &sig));
+        }
+
+        const qrl::PoolResult r0 = done[0].get();
+        const qrl::PoolResult r1 = done[1].get();
+        EXPECT_NE(r0.device, r1.device);
+        EXPECT_EQ(255, r0.index);
+        EXPECT_EQ(255, r1.index);
+        EXPECT_THROW(done[2].get(), std::runtime_error);
+
+        EXPECT_EQ(0u, pool.capacity());
+        qrl::Signature sig;
+        EXPECT_THROW(pool.sign(packets, &sig).get(), std::runtime_error);
+
+        for (const qrl::DeviceStatus &s : pool.status()) {
+            EXPECT_EQ(1u, s.signatures);
+            EXPECT_EQ(0u, s.rollovers);
+        }
+    }
+
+    TEST_F(POOL, destructor_drains_the_queue) {
+        add(two_trees, 100);
+
+        qrl::Signature sigs[5];
+        std::vector<std::future<qrl::PoolResult>> done;
+        {
+            qrl::Pool pool(transports, 0);
+            for (qrl::Signature &sig : sigs) {
+                done.push_back(pool.sign(packets, &sig));
+            }
+        }
+
+        for (uint16_t i = 0; i < 5; i++) {
+            ASSERT_EQ(std::future_status::ready, done[i].wait_for(std::chrono::seconds(0)));
+            const qrl::PoolResult r = done[i].get();
+            EXPECT_EQ(0u, r.device);
+            EXPECT_EQ(100 + i, r.index);
+            EXPECT_EQ(r.index, signature_index(sigs[i]));
+        }
+    }
+}
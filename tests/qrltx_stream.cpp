@@ -0,0 +1,191 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+#include <cstddef>
+#include <vector>
+
+#include "app_types.h"
+#include "qrl_types.h"
+#include "sim.h"
+
+extern "C" app_ctx_t ctx;
+
+namespace {
+    const uint16_t SW_OK = 0x9000;
+    const uint16_t SW_DATA_INVALID = 0x6984;
+    const uint16_t SW_NOT_ALLOWED = 0x6986;
+
+    const uint8_t CLA = 0x77;
+    const uint8_t INS_SIGN = 0x04;
+    const uint8_t INS_SIGN_NEXT = 0x05;
+
+    // Transfer from 0x01.. with a fee of 5 to count destinations 0x02.., 0x03..
+    std::vector<uint8_t> transfer(uint8_t count) {
+        qrltx_t tx;
+        memset(&tx, 0, sizeof(tx));
+        tx.type = QRLTX_TX;
+        tx.subitem_count = count;
+        memset(tx.tx.master.address, 0x01, sizeof(tx.tx.master.address));
+        tx.tx.master.amount[7] = 5;
+        for (uint8_t i = 0; i < count; i++) {
+            memset(tx.tx.dst[i].address, 0x02 + i, sizeof(tx.tx.dst[i].address));
+            tx.tx.dst[i].amount[4] = 0x3B;
+            tx.tx.dst[i].amount[7] = i;
+        }
+
+        const uint8_t *p = (const uint8_t *) &tx;
+        return std::vector<uint8_t>(p, p + get_qrltx_size(&tx));
+    }
+
+    const size_t header_size = offsetof(qrltx_t, tx.dst);
+
+    TEST(QRLTX_STREAM, any_split_hashes_as_whole) {
+        const std::vector<uint8_t> whole = transfer(3);
+
+        qrltx_t expected_tx;
+        memcpy(&expected_tx, whole.data(), whole.size());
+        uint8_t expected[32];
+        ASSERT_EQ(0, get_qrltx_hash(&expected_tx, expected));
+
+        for (size_t split = 1; split < whole.size(); split++) {
+            SCOPED_TRACE(split);
+            qrltx_t tx;
+            qrltx_stream_t s;
+            qrltx_stream_init(&s);
+
+            ASSERT_EQ(0, qrltx_stream_append(&tx, &s, whole.data(), (uint16_t) split));
+            EXPECT_EQ(split >= header_size, qrltx_stream_header_done(&s));
+            EXPECT_FALSE(qrltx_stream_done(&s));
+
+            ASSERT_EQ(0, qrltx_stream_append(&tx, &s, whole.data() + split, (uint16_t) (whole.size() - split)));
+            ASSERT_TRUE(qrltx_stream_header_done(&s));
+            ASSERT_TRUE(qrltx_stream_done(&s));
+            EXPECT_EQ(0, memcmp(expected, s.hash, sizeof(expected)));
+            EXPECT_EQ(0, memcmp(&expected_tx, &tx, header_size));
+        }
+    }
+
+    // cx_hash and the schema pointer fault on unaligned words on the device
+    TEST(QRLTX_STREAM, stream_state_is_aligned) {
+        EXPECT_EQ(0u, (uintptr_t) &ctx.qrltx_stream.sha % alignof(sha256_ctx_t));
+        EXPECT_EQ(0u, (uintptr_t) &ctx.qrltx_stream.schema % alignof(const qrltx_schema_t *));
+    }
+
+    class QRLTX_SIGN : public ::testing::Test {
+    protected:
+        static sim_snapshot_t *keys;
+
+        static void SetUpTestCase() {
+            sim_init(nullptr);
+            ASSERT_TRUE(sim_ux_select("Init Tree"));
+            keys = sim_snapshot_take();
+        }
+
+        static void TearDownTestCase() {
+            sim_snapshot_free(keys);
+            keys = nullptr;
+        }
+
+        void SetUp() override {
+            sim_snapshot_restore(keys);
+            sim_set_approve(1);
+        }
+
+        uint16_t exchange(uint8_t ins, uint8_t p1, uint8_t p2, const uint8_t *data, size_t len,
+                          std::vector<uint8_t> *resp = nullptr) {
+            std::vector<uint8_t> apdu = {CLA, ins, p1, p2, (uint8_t) len};
+            apdu.insert(apdu.end(), data, data + len);
+
+            uint8_t out[260];
+            uint16_t out_len = 0;
+            const uint16_t sw = sim_exchange(apdu.data(), (uint16_t) apdu.size(), out, &out_len);
+            if (resp != nullptr && out_len >= 2) {
+                resp->insert(resp->end(), out, out + out_len - 2);
+            }
+            return sw;
+        }
+
+        // Signature of the tx sent in packets split at the given offsets
+        std::vector<uint8_t> sign(const std::vector<uint8_t> &tx, const std::vector<size_t> &splits) {
+            std::vector<size_t> bounds = {0};
+            bounds.insert(bounds.end(), splits.begin(), splits.end());
+            bounds.push_back(tx.size());
+            const uint8_t count = splits.empty() ? 0 : (uint8_t) (bounds.size() - 1);
+
+            for (size_t i = 0; i + 1 < bounds.size(); i++) {
+                const uint8_t index = count == 0 ? 0 : (uint8_t) (i + 1);
+                EXPECT_EQ(SW_OK, exchange(INS_SIGN, index, count, tx.data() + bounds[i], bounds[i + 1] - bounds[i]));
+            }
+
+            std::vector<uint8_t> sig;
+            for (int chunk = 0; chunk < 11; chunk++) {
+                EXPECT_EQ(SW_OK, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0, &sig));
+            }
+            return sig;
+        }
+    };
+
+    sim_snapshot_t *QRLTX_SIGN::keys = nullptr;
+
+    TEST_F(QRLTX_SIGN, first_packet_must_hold_the_header) {
+        const std::vector<uint8_t> tx = transfer(2);
+
+        // ends inside the fee, the review would show zeros
+        EXPECT_EQ(SW_DATA_INVALID, exchange(INS_SIGN, 1, 2, tx.data(), header_size - 3));
+        EXPECT_EQ(SW_DATA_INVALID, exchange(INS_SIGN, 2, 2, tx.data() + header_size - 3, tx.size() - header_size + 3));
+
+        // only the type and the item count
+        EXPECT_EQ(SW_DATA_INVALID, exchange(INS_SIGN, 1, 2, tx.data(), 2));
+    }
+
+    // INS_SIGN_NEXT would read a ctx that mixes the stream with a spent leaf
+    TEST_F(QRLTX_SIGN, sign_next_needs_a_signature_in_progress) {
+        const std::vector<uint8_t> tx = transfer(2);
+
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+
+        // partial packet approved, then rejected
+        EXPECT_EQ(SW_OK, exchange(INS_SIGN, 1, 2, tx.data(), header_size));
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+        sim_set_approve(0);
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN, 1, 2, tx.data(), header_size));
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+        sim_set_approve(1);
+
+        // a signature is read partly, then a new tx overlays it
+        EXPECT_EQ(SW_OK, exchange(INS_SIGN, 0, 0, tx.data(), tx.size()));
+        EXPECT_EQ(SW_OK, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+        EXPECT_EQ(SW_OK, exchange(INS_SIGN, 1, 2, tx.data(), header_size));
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+
+        // and none is left after the last chunk
+        sign(tx, {});
+        EXPECT_EQ(SW_NOT_ALLOWED, exchange(INS_SIGN_NEXT, 0, 0, nullptr, 0));
+    }
+
+    TEST_F(QRLTX_SIGN, split_inside_an_item_signs_as_one_packet) {
+        const std::vector<uint8_t> tx = transfer(3);
+        const std::vector<uint8_t> expected = sign(tx, {});
+        ASSERT_EQ(4u + 32u + 67u * 32u + 8u * 32u, expected.size());
+
+        SetUp();
+        EXPECT_EQ(expected, sign(tx, {header_size + 20}));
+
+        // header alone in the first packet, then an item split across the next two
+        SetUp();
+        EXPECT_EQ(expected, sign(tx, {header_size, header_size + 47 + 11}));
+    }
+}
@@ -0,0 +1,155 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <vector>
+
+#include "qrl/txbuild.h"
+#include "qrl_types.h"
+#include "sha256_mb.h"
+
+// The types enabled are the ones in the app's schema table, as built with
+// TXBUILD_TXTOKEN / TXBUILD_SLAVE
+
+namespace {
+    const uint8_t TYPES[] = {qrl::TX_TRANSFER, qrl::TX_TOKEN, qrl::TX_SLAVE, qrl::TX_MESSAGE};
+
+    // Items accepted by the app, 0 for a disabled type
+    uint8_t item_max(uint8_t type) {
+        const qrltx_schema_t *schema = get_qrltx_schema(type);
+        return schema != nullptr ? schema->item_max : 0;
+    }
+
+    // Adds a tx of the given type and item count, the content depends on seed
+    size_t add(qrl::TxArena &arena, uint8_t type, size_t items, uint8_t seed) {
+        uint8_t master[qrl::TX_ADDRESS_SIZE];
+        uint8_t token_hash[qrl::TX_TOKEN_HASH_SIZE];
+        std::vector<qrl::TxDest> dst(items + 1);
+        std::vector<qrl::TxSlave> slaves(items + 1);
+        std::vector<uint8_t> message(items + 1);
+
+        memset(master, seed, sizeof(master));
+        memset(token_hash, seed ^ 0x5A, sizeof(token_hash));
+        for (size_t i = 0; i < items; i++) {
+            memset(dst[i].address, static_cast<int>(seed + i + 1), qrl::TX_ADDRESS_SIZE);
+            dst[i].amount = 1000000000ull * (seed + i + 1);
+            memset(slaves[i].pk, static_cast<int>(seed + i + 1), qrl::TX_SLAVE_PK_SIZE);
+            slaves[i].access = i;
+            message[i] = static_cast<uint8_t>('a' + (seed + i) % 26);
+        }
+
+        const uint64_t fee = 5 + seed;
+        switch (type) {
+            case qrl::TX_TRANSFER:
+                return arena.add_transfer(master, fee, dst.data(), items);
+            case qrl::TX_TOKEN:
+                return arena.add_token(master, fee, token_hash, dst.data(), items);
+            case qrl::TX_SLAVE:
+                return arena.add_slave(master, fee, slaves.data(), items);
+            default:
+                return arena.add_message(master, fee, message.data(), items);
+        }
+    }
+
+    void expect_app_hashes(const qrl::TxArena &arena) {
+        std::vector<uint8_t> hashes(arena.size() * qrl::TX_HASH_SIZE);
+        arena.hash(hashes.data());
+
+        for (size_t i = 0; i < arena.size(); i++) {
+            qrltx_t tx;
+            memset(&tx, 0, sizeof(tx));
+            memcpy(&tx, arena.tx(i), arena.tx_size(i));
+            ASSERT_EQ(static_cast<int16_t>(arena.tx_size(i)), get_qrltx_size(&tx)) << "tx " << i;
+
+            uint8_t expected[qrl::TX_HASH_SIZE];
+            ASSERT_EQ(0, get_qrltx_hash(&tx, expected));
+            EXPECT_EQ(0, memcmp(expected, &hashes[i * qrl::TX_HASH_SIZE], sizeof(expected)))
+                                << "tx " << i << ", type " << int(tx.type) << ", " << int(tx.subitem_count) << " items";
+        }
+    }
+
+    TEST(TXBUILD, hash_matches_the_app_for_every_type_and_length) {
+        // 1 to 17 txs per hashed length, so most lengths leave a partial set of lanes
+        const size_t max_copies = 2 * SHA256_MB_LANES + 1;
+        const size_t max_txs = 4 * QRLTX_MESSAGE_SUBITEM_MAX * max_copies;
+        qrl::TxArena arena(max_txs, max_txs * sizeof(qrltx_t));
+
+        size_t types = 0;
+        for (uint8_t type : TYPES) {
+            types += item_max(type) > 0;
+        }
+        ASSERT_GE(types, 2u);
+
+        // Lengths are interleaved, several lane sets fill up at the same time
+        for (uint8_t copy = 0; copy < max_copies; copy++) {
+            for (uint8_t type : TYPES) {
+                for (size_t items = 1; items <= item_max(type); items++) {
+                    if (copy < 1 + (items * 3 + type * 5) % max_copies) {
+                        add(arena, type, items, copy);
+                    }
+                }
+            }
+        }
+
+        expect_app_hashes(arena);
+    }
+
+    TEST(TXBUILD, hash_handles_fewer_txs_than_lanes) {
+        for (size_t count = 1; count <= SHA256_MB_LANES + 1; count++) {
+            SCOPED_TRACE(count);
+            qrl::TxArena arena(count, count * sizeof(qrltx_t));
+            for (size_t i = 0; i < count; i++) {
+                add(arena, qrl::TX_TRANSFER, 1, static_cast<uint8_t>(i));
+            }
+            expect_app_hashes(arena);
+        }
+    }
+
+    TEST(TXBUILD, add_rejects_item_counts_the_app_refuses) {
+        qrl::TxArena arena(4, 4 * sizeof(qrltx_t));
+
+        for (uint8_t type : TYPES) {
+            SCOPED_TRACE(int(type));
+            const uint8_t max = item_max(type);
+            if (max == 0) {
+                // Disabled in this build, as in the app
+                EXPECT_THROW(add(arena, type, 1, 0), qrl::TxError);
+                continue;
+            }
+
+            for (size_t items : {size_t(0), size_t(max) + 1, size_t(UINT8_MAX) + 1}) {
+                SCOPED_TRACE(items);
+                qrltx_t tx;
+                memset(&tx, 0, sizeof(tx));
+                tx.type = type;
+                tx.subitem_count = static_cast<uint8_t>(items);
+                EXPECT_LT(get_qrltx_size(&tx), 0);
+                EXPECT_THROW(add(arena, type, items, 0), qrl::TxError);
+            }
+            EXPECT_EQ(0u, arena.size());
+        }
+
+        // Nothing was kept from the rejected txs
+        for (uint8_t type : TYPES) {
+            if (item_max(type) > 0) {
+                const size_t index = arena.size();
+                EXPECT_EQ(index, add(arena, type, item_max(type), 1));
+            }
+        }
+        expect_app_hashes(arena);
+    }
+}
@@ -0,0 +1,278 @@
+/*******************************************************************************
+*   (c) 2019 ZondaX GmbH
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+********************************************************************************/
+#include <gmock/gmock.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xmss.h"
+
+namespace {
+    // Known answers from tests/xmss_kat.py, an independent hashlib implementation
+    struct xmss_kat_t {
+        uint8_t hash_func;
+        const char *f;
+        const char *h;
+        const char *root;
+        const char *sig_sha256;
+    };
+
+    const xmss_kat_t kats[] = {
+            {SHASH_FUNC_SHA2_256,
+                    "823a7caafa16b10f3910c9688875b6e5bb1bbe081ec7faebc1580bd5e0ecdafb",
+                    "18d722663b3c34889e577931a117e49b9de3fdbaae360b43faace0d7c122348d",
+                    "291921c541729f59069a179b6a8fc5d346a77e35b5edc1a37dfc4c1e0164cd37",
+                    "2dd6d5d49eaa19cd884c1a0e57d649845281010a43c676fb202c03f7ac32f23d"},
+            {SHASH_FUNC_SHAKE128,
+                    "0522228513b29406cacb3655b99e8e432fcd1fcdafbcb6a802656d61ca3a4a5b",
+                    "052f0b0b024f5b5b8ecb18eaa605da3c2f617798c0aae5cba62182972b30f052",
+                    "1119b2b41050ff7f5c3b04f02e15f2b72ad55a7bc0d48e7af94a943fa474bb1b",
+                    "2e5a9d71c49dbebf97737ad62327bd47b7bb28c96674e71818e1601d29f3ed64"},
+            {SHASH_FUNC_SHAKE256,
+                    "98d3f88e9c64f0c29b8cf9c49df6cb3f8819475955ea0b3b5c81bb7405f8a324",
+                    "c62caeb65b7be84214586bdbffa00ede28536a315aa957ca900b924f832b840d",
+                    "eb30832d820b2a7d9ac1384d2778cd505985f3452d401ce3ca6bc7b7c860f751",
+                    "a3d98e94ec415cbdd41a86561a7230c6af5eddbd7fefb6b26d0ddea79f53a65d"},
+    };
+
+    // Inputs shared with tests/xmss_kat.py
+    const uint16_t kat_index = 5;
+
+    void kat_bytes(uint8_t *out, size_t len, uint8_t first) {
+        for (size_t i = 0; i < len; i++) {
+            out[i] = (uint8_t) (first + i);
+        }
+    }
+
+    std::string to_hex(const uint8_t *data, size_t len) {
+        static const char digits[] = "0123456789abcdef";
+        std::string s;
+        for (size_t i = 0; i < len; i++) {
+            s += digits[data[i] >> 4];
+            s += digits[data[i] & 0x0F];
+        }
+        return s;
+    }
+
+    struct xmss_tree_keys_t {
+        xmss_sk_t sk;
+        uint8_t nodes[XMSS_NODES_BUFSIZE];
+    };
+
+    // Key generation takes a while for SHAKE, every tree is generated once
+    const xmss_tree_keys_t &kat_tree(uint8_t hash_func) {
+        static std::map<uint8_t, std::unique_ptr<xmss_tree_keys_t>> trees;
+        std::unique_ptr<xmss_tree_keys_t> &t = trees[hash_func];
+        if (!t) {
+            t.reset(new xmss_tree_keys_t());
+            uint8_t sk_seed[48];
+            kat_bytes(sk_seed, sizeof(sk_seed), 0x00);
+
+            std::vector<uint8_t> wots_buffer(WOTS_LEN * WOTS_N);
+            xmss_gen_keys_1_get_seeds(&t->sk, sk_seed, hash_func);
+            for (uint16_t idx = 0; idx < XMSS_NUM_NODES; idx++) {
+                xmss_gen_keys_2_get_nodes(wots_buffer.data(), t->nodes + idx * WOTS_N, &t->sk, idx);
+            }
+            xmss_gen_keys_3_get_root(t->nodes, &t->sk);
+        }
+        return *t;
+    }
+
+    TEST(XMSS, hash_f_kat) {
+        for (const auto &kat : kats) {
+            SCOPED_TRACE(kat.hash_func);
+            shash_select(kat.hash_func);
+
+            shash_input_t in;
+            PRF_init(&in, SHASH_TYPE_PRF);
+            kat_bytes(in.key, WOTS_N, 0x80);
+            in.adrs.otshash.OTS = HtoNL(7u);
+            in.adrs.otshash.chain = HtoNL(3u);
+            in.adrs.otshash.hash = HtoNL(2u);
+
+            uint8_t x[WOTS_N];
+            kat_bytes(x, sizeof(x), 0x40);
+            hash_f(x, &in);
+            EXPECT_EQ(kat.f, to_hex(x, sizeof(x)));
+        }
+    }
+
+    TEST(XMSS, shash_h_kat) {
+        for (const auto &kat : kats) {
+            SCOPED_TRACE(kat.hash_func);
+            shash_select(kat.hash_func);
+
+            hashh_t h_in;
+            memset(h_in.raw, 0, sizeof(h_in.raw));
+            kat_bytes(h_in.basic.key, WOTS_N, 0x80);
+            h_in.basic.adrs.type = HtoNL(SHASH_TYPE_HASH);
+            h_in.basic.adrs.trees.height = HtoNL(1u);
+            h_in.basic.adrs.trees.index = HtoNL(4u);
+
+            uint8_t in[2 * WOTS_N];
+            uint8_t out[WOTS_N];
+            kat_bytes(in, sizeof(in), 0x40);
+            shash_h(out, in, &h_in);
+            EXPECT_EQ(kat.h, to_hex(out, sizeof(out)));
+        }
+    }
+
+    TEST(XMSS, sign_kat) {
+        for (const auto &kat : kats) {
+            SCOPED_TRACE(kat.hash_func);
+            const xmss_tree_keys_t &t = kat_tree(kat.hash_func);
+            EXPECT_EQ(kat.root, to_hex(t.sk.root, sizeof(t.sk.root)));
+
+            uint8_t msg[32];
+            kat_bytes(msg, sizeof(msg), 0x20);
+
+            xmss_signature_t sig;
+            xmss_sign(&sig, msg, &t.sk, t.nodes, kat_index);
+
+            uint8_t digest[32];
+            __sha256(digest, sig.raw, sizeof(sig.raw));
+            EXPECT_EQ(kat.sig_sha256, to_hex(digest, sizeof(digest)));
+        }
+    }
+
+    TEST(XMSS, hash_selection_is_per_thread) {
+        // Trees are generated up front, kat_tree is not thread safe
+        for (const auto &kat : kats) {
+            kat_tree(kat.hash_func);
+        }
+
+        // Each thread hashes with its own function while the others switch theirs
+        std::vector<int> mismatches(sizeof(kats) / sizeof(kats[0]), 0);
+        std::vector<std::thread> threads;
+        for (size_t k = 0; k < mismatches.size(); k++) {
+            threads.emplace_back([k, &mismatches] {
+                const xmss_kat_t &kat = kats[k];
+                const xmss_tree_keys_t &t = kat_tree(kat.hash_func);
+                uint8_t msg[32];
+                kat_bytes(msg, sizeof(msg), 0x20);
+
+                for (int round = 0; round < 20; round++) {
+                    shash_select(kat.hash_func);
+                    shash_input_t in;
+                    PRF_init(&in, SHASH_TYPE_PRF);
+                    kat_bytes(in.key, WOTS_N, 0x80);
+                    in.adrs.otshash.OTS = HtoNL(7u);
+                    in.adrs.otshash.chain = HtoNL(3u);
+                    in.adrs.otshash.hash = HtoNL(2u);
+
+                    uint8_t x[WOTS_N];
+                    kat_bytes(x, sizeof(x), 0x40);
+                    hash_f(x, &in);
+                    mismatches[k] += kat.f != to_hex(x, sizeof(x));
+
+                    xmss_signature_t sig;
+                    xmss_sign_mt(&sig, msg, &t.sk, t.nodes, kat_index, 4);
+                    uint8_t digest[32];
+                    __sha256(digest, sig.raw, sizeof(sig.raw));
+                    mismatches[k] += kat.sig_sha256 != to_hex(digest, sizeof(digest));
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        for (size_t k = 0; k < mismatches.size(); k++) {
+            EXPECT_EQ(0, mismatches[k]) << "hash function " << (int) kats[k].hash_func;
+        }
+    }
+
+    TEST(XMSS, sign_mt_matches_sign) {
+        const uint16_t indexes[] = {0, kat_index, XMSS_NUM_NODES - 1};
+
+        for (const auto &kat : kats) {
+            const xmss_tree_keys_t &t = kat_tree(kat.hash_func);
+
+            for (uint16_t index : indexes) {
+                uint8_t msg[32];
+                kat_bytes(msg, sizeof(msg), (uint8_t) (0x20 + index));
+
+                xmss_signature_t expected;
+                xmss_sign(&expected, msg, &t.sk, t.nodes, index);
+
+                // 0 and more threads than chain groups are clamped
+                for (uint8_t threads = 0; threads <= 12; threads++) {
+                    SCOPED_TRACE(testing::Message() << "hash " << (int) kat.hash_func
+                                                    << " index " << index << " threads " << (int) threads);
+                    xmss_signature_t sig;
+                    memset(sig.raw, 0xA5, sizeof(sig.raw));
+                    xmss_sign_mt(&sig, msg, &t.sk, t.nodes, index, threads);
+                    ASSERT_EQ(0, memcmp(expected.raw, sig.raw, sizeof(sig.raw)));
+                }
+            }
+        }
+    }
+
+    // WOTS+ is the part xmss_sign_mt spreads over threads, treehash and the digest stay serial.
+    // Timing only, run with --gtest_also_run_disabled_tests
+    TEST(XMSS, DISABLED_sign_mt_benchmark) {
+        const int rounds = 50;
+        uint8_t msg[32];
+        kat_bytes(msg, sizeof(msg), 0x20);
+
+        for (const auto &kat : kats) {
+            const xmss_tree_keys_t &t = kat_tree(kat.hash_func);
+            shash_select(kat.hash_func);
+
+            uint8_t seed_i[WOTS_N];
+            xmss_get_seed_i(seed_i, &t.sk, kat_index);
+            uint8_t wots_sig[WOTS_SIGSIZE];
+            xmss_signature_t sig;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < rounds; i++) {
+                wotsp_sign(wots_sig, msg, t.sk.pub_seed, seed_i, kat_index);
+            }
+            const double t_wots = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < rounds; i++) {
+                xmss_sign(&sig, msg, &t.sk, t.nodes, kat_index);
+            }
+            const double t_sign = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << "hash " << (int) kat.hash_func << std::endl;
+            std::cout << "  wotsp_sign          " << (size_t) (t_wots * 1e6 / rounds) << " us" << std::endl;
+            std::cout << "  xmss_sign           " << (size_t) (t_sign * 1e6 / rounds) << " us" << std::endl;
+
+            for (uint8_t threads = 1; threads <= 8; threads *= 2) {
+                start = std::chrono::steady_clock::now();
+                for (int i = 0; i < rounds; i++) {
+                    wotsp_sign_mt(wots_sig, msg, t.sk.pub_seed, seed_i, kat_index, threads);
+                }
+                const double t_wots_mt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                start = std::chrono::steady_clock::now();
+                for (int i = 0; i < rounds; i++) {
+                    xmss_sign_mt(&sig, msg, &t.sk, t.nodes, kat_index, threads);
+                }
+                const double t_mt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                std::cout << "  wotsp_sign_mt(" << (int) threads << ")    " << (size_t) (t_wots_mt * 1e6 / rounds) << " us"
+                          << ", xmss_sign_mt(" << (int) threads << ") " << (size_t) (t_mt * 1e6 / rounds) << " us"
+                          << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# *******************************************************************************
+# *   (c) 2019 ZondaX GmbH
+# *
+# *  Licensed under the Apache License, Version 2.0 (the "License");
+# *  you may not use this file except in compliance with the License.
+# *  You may obtain a copy of the License at
+# *
+# *      http://www.apache.org/licenses/LICENSE-2.0
+# *
+# *  Unless required by applicable law or agreed to in writing, software
+# *  distributed under the License is distributed on an "AS IS" BASIS,
+# *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# *  See the License for the specific language governing permissions and
+# *  limitations under the License.
+# ********************************************************************************
+"""Known answers for tests/xmss.cpp.
+
+QRL's XMSS (as in qrllib / go-qrllib) written from the spec on top of hashlib,
+without any code from src/libxmss:
+
+  xmss_kat.py > kat.txt
+
+Prints F, H and a full key generation and signature for every hash function of
+the address descriptor.
+"""
+
+import hashlib
+import struct
+
+N = 32
+W = 16
+LEN1 = 64
+LEN2 = 3
+LEN = LEN1 + LEN2
+HEIGHT = 8
+
+SHA2_256 = 0
+SHAKE128 = 1
+SHAKE256 = 2
+
+TYPE_F = 0
+TYPE_H = 1
+TYPE_HASH = 2
+TYPE_PRF = 3
+
+ADRS_OTS = 0
+ADRS_LTREE = 1
+ADRS_TREE = 2
+
+# Inputs shared with tests/xmss.cpp
+KAT_SK_SEED = bytes(range(48))
+KAT_MSG = bytes(range(0x20, 0x40))
+KAT_INDEX = 5
+KAT_IN = bytes(range(0x40, 0x80))
+KAT_PUB_SEED = bytes(range(0x80, 0xA0))
+
+
+def core_hash(func, data):
+    if func == SHA2_256:
+        return hashlib.sha256(data).digest()
+    if func == SHAKE128:
+        return hashlib.shake_128(data).digest(N)
+    return hashlib.shake_256(data).digest(N)
+
+
+def to_byte(x, n=N):
+    return x.to_bytes(n, 'big')
+
+
+def xor(a, b):
+    return bytes(x ^ y for x, y in zip(a, b))
+
+
+def adrs(type_, a=0, b=0, c=0, key_and_mask=0):
+    # layer and tree are always 0, a/b/c are OTS/chain/hash or ltree/height/index
+    return struct.pack('>IQIIIII', 0, 0, type_, a, b, c, key_and_mask)
+
+
+def prf(func, key, m):
+    return core_hash(func, to_byte(TYPE_PRF) + key + m)
+
+
+def hash_f(func, x, pub_seed, a):
+    key = prf(func, pub_seed, a[:28] + to_byte(0, 4))
+    mask = prf(func, pub_seed, a[:28] + to_byte(1, 4))
+    return core_hash(func, to_byte(TYPE_F) + key + xor(mask, x))
+
+
+def hash_h(func, left, right, pub_seed, a):
+    key = prf(func, pub_seed, a[:28] + to_byte(0, 4))
+    bm1 = prf(func, pub_seed, a[:28] + to_byte(1, 4))
+    bm2 = prf(func, pub_seed, a[:28] + to_byte(2, 4))
+    return core_hash(func, to_byte(TYPE_H) + key + xor(bm1, left) + xor(bm2, right))
+
+
+def chain(func, x, start, steps, pub_seed, ots, i):
+    for j in range(start, start + steps):
+        x = hash_f(func, x, pub_seed, adrs(ADRS_OTS, ots, i, j))
+    return x
+
+
+def wots_sk(func, seed):
+    return [prf(func, seed, to_byte(i)) for i in range(LEN)]
+
+
+def base_w(msg):
+    digits = []
+    for b in msg:
+        digits += [b >> 4, b & 15]
+    csum = sum(W - 1 - d for d in digits)
+    csum_bytes = (csum << 4).to_bytes(2, 'big')
+    for b in csum_bytes:
+        digits += [b >> 4, b & 15]
+    return digits[:LEN]
+
+
+def ltree(func, pk, pub_seed, index):
+    nodes = list(pk)
+    height = 0
+    while len(nodes) > 1:
+        nxt = [hash_h(func, nodes[2 * i], nodes[2 * i + 1], pub_seed, adrs(ADRS_LTREE, index, height, i))
+               for i in range(len(nodes) // 2)]
+        if len(nodes) % 2:
+            nxt.append(nodes[-1])
+        nodes = nxt
+        height += 1
+    return nodes[0]
+
+
+class Xmss:
+    def __init__(self, func, sk_seed):
+        self.func = func
+        seeds = hashlib.shake_256(sk_seed).digest(3 * N)
+        self.seed, self.prf_seed, self.pub_seed = seeds[:N], seeds[N:2 * N], seeds[2 * N:]
+
+        self.leaves = [self.leaf(i) for i in range(1 << HEIGHT)]
+        self.levels = [self.leaves]
+        for h in range(HEIGHT):
+            lower = self.levels[-1]
+            self.levels.append([hash_h(func, lower[2 * i], lower[2 * i + 1], self.pub_seed, adrs(ADRS_TREE, 0, h, i))
+                                for i in range(len(lower) // 2)])
+        self.root = self.levels[-1][0]
+
+    def seed_i(self, index):
+        return prf(self.func, self.seed, adrs(ADRS_OTS, index))
+
+    def leaf(self, index):
+        pk = [chain(self.func, s, 0, W - 1, self.pub_seed, index, i)
+              for i, s in enumerate(wots_sk(self.func, self.seed_i(index)))]
+        return ltree(self.func, pk, self.pub_seed, index)
+
+    def sign(self, msg, index):
+        r = prf(self.func, self.prf_seed, to_byte(index))
+        digest = core_hash(self.func, to_byte(TYPE_HASH) + r + self.root + to_byte(index) + msg)
+
+        sig = struct.pack('>I', index) + r
+        for i, (s, d) in enumerate(zip(wots_sk(self.func, self.seed_i(index)), base_w(digest))):
+            sig += chain(self.func, s, 0, d, self.pub_seed, index, i)
+        for h in range(HEIGHT):
+            sig += self.levels[h][(index >> h) ^ 1]
+        return sig
+
+
+def main():
+    names = {SHA2_256: 'SHA2_256', SHAKE128: 'SHAKE128', SHAKE256: 'SHAKE256'}
+    for func in (SHA2_256, SHAKE128, SHAKE256):
+        f = hash_f(func, KAT_IN[:N], KAT_PUB_SEED, adrs(ADRS_OTS, 7, 3, 2))
+        h = hash_h(func, KAT_IN[:N], KAT_IN[N:], KAT_PUB_SEED, adrs(ADRS_TREE, 0, 1, 4))
+        x = Xmss(func, KAT_SK_SEED)
+        sig = x.sign(KAT_MSG, KAT_INDEX)
+        print(names[func])
+        print('  f    ', f.hex())
+        print('  h    ', h.hex())
+        print('  root ', x.root.hex())
+        print('  sig  ', hashlib.sha256(sig).hexdigest())
+
+
+if __name__ == '__main__':
+    main()